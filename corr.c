@@ -0,0 +1,428 @@
+#include "corr.h"
+
+#include <string.h>
+
+#include "xmem.h"
+
+// slots of the timer wheel, the timeout spans half of them
+#define CORR_WHEEL_SLOTS (256)
+#define CORR_NONE (0xffffffffu)
+
+/*********************************histogram*********************************/
+
+static int corr_log2(unsigned long long _value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(_value);
+#else
+    int bit = 0;
+    int shift = 32;
+    while (shift > 0) {
+        if (_value >> shift) {
+            _value >>= shift;
+            bit += shift;
+        }
+        shift >>= 1;
+    }
+    return bit;
+#endif
+}
+
+// values under 2^CORR_HIST_BITS have a bucket each, the others
+// are bucketed by their exponent and their top bits
+static size_t corr_bucket(unsigned long long _value) {
+    if (_value < (1ull << CORR_HIST_BITS)) {
+        return (size_t) _value;
+    }
+    int exp = corr_log2(_value);
+    if (exp >= CORR_HIST_RANGE) {
+        return CORR_HIST_SIZE - 1;
+    }
+    unsigned long long top = _value >> (exp - CORR_HIST_BITS);
+    return ((size_t) (exp - CORR_HIST_BITS + 1) << CORR_HIST_BITS) +
+           (size_t) (top - (1ull << CORR_HIST_BITS));
+}
+
+// largest value of a bucket
+static unsigned long long corr_bucket_max(size_t _bucket) {
+    if (_bucket < (1u << CORR_HIST_BITS)) {
+        return _bucket;
+    }
+    int shift = (int) (_bucket >> CORR_HIST_BITS) - 1;
+    unsigned long long top = (_bucket & ((1u << CORR_HIST_BITS) - 1)) +
+                             (1ull << CORR_HIST_BITS);
+    return ((top + 1) << shift) - 1;
+}
+
+void corr_histogram_record(
+        corr_histogram_t *_hist, unsigned long long _value) {
+    if (_hist->count == 0 || _value < _hist->min) {
+        _hist->min = _value;
+    }
+    if (_value > _hist->max) {
+        _hist->max = _value;
+    }
+    _hist->count++;
+    _hist->sum += _value;
+    _hist->buckets[corr_bucket(_value)]++;
+}
+
+unsigned long long corr_histogram_quantile(
+        const corr_histogram_t *_hist, double _quantile) {
+    if (_hist == NULL || _hist->count == 0) {
+        return 0;
+    }
+    if (_quantile < 0.0) {
+        _quantile = 0.0;
+    } else if (_quantile > 1.0) {
+        _quantile = 1.0;
+    }
+    // rank of the value, from 1
+    unsigned long long rank = (unsigned long long)
+            (_quantile * (double) _hist->count + 0.5);
+    if (rank == 0) {
+        rank = 1;
+    }
+    unsigned long long seen = 0;
+    size_t idx = 0;
+    while (idx < CORR_HIST_SIZE) {
+        seen += _hist->buckets[idx];
+        if (seen >= rank) {
+            break;
+        }
+        idx++;
+    }
+    unsigned long long value = corr_bucket_max(idx);
+    if (value > _hist->max) {
+        value = _hist->max;
+    }
+    if (value < _hist->min) {
+        value = _hist->min;
+    }
+    return value;
+}
+
+/*********************************corr_t*********************************/
+
+// an outstanding request, linked in a hash chain and a wheel slot
+typedef struct corr_entry_t {
+    unsigned long long assoc;
+    unsigned long long stamp;
+    unsigned long long deadline;
+    unsigned int invoke;
+    unsigned int service;
+    unsigned int chain; // next of the hash chain, or of the free list
+    unsigned int prev; // neighbours in the wheel slot
+    unsigned int next;
+    unsigned int slot;
+} corr_entry_t;
+
+typedef struct corr_t {
+    corr_entry_t *entries;
+    size_t capacity;
+    size_t count;
+    unsigned int free; // head of the free entries
+    unsigned int *buckets; // heads of the hash chains
+    size_t mask; // buckets - 1
+    unsigned long long timeout;
+    unsigned long long tick; // nanoseconds of a wheel slot
+    unsigned long long current; // next tick to expire
+    int started;
+    unsigned int slots[CORR_WHEEL_SLOTS];
+    corr_stats_t stats[CORR_SERVICE_COUNT];
+} corr_t;
+
+corr_t *corr_create(const corr_option_t *_option) {
+    size_t capacity = CORR_OUTSTANDING_DEFAULT;
+    unsigned long long timeout = CORR_TIMEOUT_DEFAULT;
+    if (_option != NULL && _option->outstanding != 0) {
+        capacity = _option->outstanding;
+    }
+    if (_option != NULL && _option->timeout != 0) {
+        timeout = _option->timeout;
+    }
+    if (capacity >= CORR_NONE) {
+        capacity = CORR_NONE - 1;
+    }
+    corr_t *corr = (corr_t *) xmem_alloc(sizeof(corr_t));
+    if (corr == NULL) {
+        return NULL;
+    }
+    memset(corr, 0, sizeof(corr_t));
+    // at least as many chains as entries
+    size_t buckets = 1;
+    while (buckets < capacity) {
+        buckets <<= 1;
+    }
+    corr->entries = (corr_entry_t *)
+            xmem_alloc(capacity * sizeof(corr_entry_t));
+    corr->buckets = (unsigned int *)
+            xmem_alloc(buckets * sizeof(unsigned int));
+    if (corr->entries == NULL || corr->buckets == NULL) {
+        corr_destroy(corr);
+        return NULL;
+    }
+    memset(corr->buckets, 0xff, buckets * sizeof(unsigned int));
+    memset(corr->slots, 0xff, sizeof(corr->slots));
+    size_t idx = 0;
+    while (idx < capacity) {
+        corr->entries[idx].chain = (unsigned int) (idx + 1);
+        idx++;
+    }
+    corr->entries[capacity - 1].chain = CORR_NONE;
+    corr->capacity = capacity;
+    corr->mask = buckets - 1;
+    corr->timeout = timeout;
+    corr->tick = timeout / (CORR_WHEEL_SLOTS / 2);
+    if (corr->tick == 0) {
+        corr->tick = 1;
+    }
+    return corr;
+}
+
+void corr_destroy(corr_t *_corr) {
+    if (_corr == NULL) {
+        return;
+    }
+    xmem_free(_corr->entries);
+    xmem_free(_corr->buckets);
+    xmem_free(_corr);
+}
+
+int corr_service(int _tag) {
+    switch (_tag) {
+        case 0xa4:
+            return CORR_SERVICE_READ;
+        case 0xa5:
+            return CORR_SERVICE_WRITE;
+        case 0xa1:
+            return CORR_SERVICE_NAMES;
+        case 0xa6:
+            return CORR_SERVICE_VARATTR;
+        case 0x4d:
+            return CORR_SERVICE_FILEDIR;
+        case 0x48:
+            return CORR_SERVICE_FOPEN;
+        case 0x49:
+            return CORR_SERVICE_FREAD;
+        case 0x4a:
+            return CORR_SERVICE_FCLOSE;
+        default:
+            return CORR_SERVICE_OTHER;
+    }
+}
+
+const char *corr_service_name(int _service) {
+    static const char *g_names[CORR_SERVICE_COUNT] = {
+            "read", "write", "getNameList", "getVariableAccessAttributes",
+            "fileDirectory", "fileOpen", "fileRead", "fileClose", "other",
+    };
+    if (_service < 0 || _service >= CORR_SERVICE_COUNT) {
+        return "unknown";
+    }
+    return g_names[_service];
+}
+
+static size_t corr_hash(unsigned long long _assoc, unsigned int _invoke) {
+    unsigned long long hash = _assoc ^ ((unsigned long long) _invoke << 1);
+    hash ^= hash >> 33;
+    hash *= 0xff51afd7ed558ccdull;
+    hash ^= hash >> 33;
+    return (size_t) hash;
+}
+
+// the chain link pointing at the request, or at the end of the chain
+static unsigned int *corr_find(
+        corr_t *_corr, unsigned long long _assoc,
+        unsigned int _invoke) {
+    unsigned int *link =
+            &_corr->buckets[corr_hash(_assoc, _invoke) & _corr->mask];
+    while (*link != CORR_NONE) {
+        corr_entry_t *entry = &_corr->entries[*link];
+        if (entry->assoc == _assoc && entry->invoke == _invoke) {
+            break;
+        }
+        link = &entry->chain;
+    }
+    return link;
+}
+
+static void corr_unlink(corr_t *_corr, unsigned int _idx) {
+    corr_entry_t *entry = &_corr->entries[_idx];
+    if (entry->prev != CORR_NONE) {
+        _corr->entries[entry->prev].next = entry->next;
+    } else {
+        _corr->slots[entry->slot] = entry->next;
+    }
+    if (entry->next != CORR_NONE) {
+        _corr->entries[entry->next].prev = entry->prev;
+    }
+}
+
+// remove the request its chain link points at and free its entry
+static void corr_remove(corr_t *_corr, unsigned int *_link) {
+    unsigned int idx = *_link;
+    corr_entry_t *entry = &_corr->entries[idx];
+    (*_link) = entry->chain;
+    corr_unlink(_corr, idx);
+    entry->chain = _corr->free;
+    _corr->free = idx;
+    _corr->count--;
+}
+
+static void corr_start(corr_t *_corr, unsigned long long _now) {
+    if (!_corr->started) {
+        _corr->current = _now / _corr->tick;
+        _corr->started = 1;
+    }
+}
+
+int corr_request(
+        corr_t *_corr, unsigned long long _assoc,
+        unsigned int _invoke, int _tag,
+        unsigned long long _now) {
+    if (_corr == NULL) {
+        return CORR_ERR_NULL;
+    }
+    int service = corr_service(_tag);
+    corr_stats_t *stats = &_corr->stats[service];
+    unsigned int *link = corr_find(_corr, _assoc, _invoke);
+    if (*link != CORR_NONE) {
+        _corr->stats[_corr->entries[*link].service].timeouts++;
+        corr_remove(_corr, link);
+    }
+    stats->requests++;
+    if (_corr->free == CORR_NONE) {
+        stats->dropped++;
+        return CORR_ERR_FULL;
+    }
+    corr_start(_corr, _now);
+    unsigned int idx = _corr->free;
+    corr_entry_t *entry = &_corr->entries[idx];
+    _corr->free = entry->chain;
+    entry->assoc = _assoc;
+    entry->invoke = _invoke;
+    entry->service = (unsigned int) service;
+    entry->stamp = _now;
+    entry->deadline = _now + _corr->timeout;
+    entry->chain = CORR_NONE;
+    (*link) = idx;
+    // a request older than the wheel waits in the next slot expired
+    unsigned long long tick = entry->deadline / _corr->tick;
+    if (tick < _corr->current) {
+        tick = _corr->current;
+    }
+    entry->slot = (unsigned int) (tick % CORR_WHEEL_SLOTS);
+    entry->prev = CORR_NONE;
+    entry->next = _corr->slots[entry->slot];
+    if (entry->next != CORR_NONE) {
+        _corr->entries[entry->next].prev = idx;
+    }
+    _corr->slots[entry->slot] = idx;
+    _corr->count++;
+    return 0;
+}
+
+int corr_response(
+        corr_t *_corr, unsigned long long _assoc,
+        unsigned int _invoke, int _error,
+        unsigned long long _now) {
+    if (_corr == NULL) {
+        return CORR_ERR_NULL;
+    }
+    unsigned int *link = corr_find(_corr, _assoc, _invoke);
+    if (*link == CORR_NONE) {
+        _corr->stats[CORR_SERVICE_OTHER].unmatched++;
+        return CORR_ERR_UNMATCHED;
+    }
+    corr_entry_t *entry = &_corr->entries[*link];
+    int service = (int) entry->service;
+    corr_stats_t *stats = &_corr->stats[service];
+    stats->responses++;
+    if (_error) {
+        stats->errors++;
+    }
+    // captures of several interfaces may go back in time
+    unsigned long long latency = 0;
+    if (_now > entry->stamp) {
+        latency = _now - entry->stamp;
+    }
+    corr_histogram_record(&stats->latency, latency);
+    corr_remove(_corr, link);
+    return service;
+}
+
+int corr_expire(corr_t *_corr, unsigned long long _now) {
+    if (_corr == NULL) {
+        return CORR_ERR_NULL;
+    }
+    corr_start(_corr, _now);
+    // the slots of the elapsed ticks, each slot once at most
+    unsigned long long end = _now / _corr->tick;
+    if (end > _corr->current + CORR_WHEEL_SLOTS) {
+        _corr->current = end - CORR_WHEEL_SLOTS;
+    }
+    int expired = 0;
+    while (_corr->current < end) {
+        unsigned int slot =
+                (unsigned int) (_corr->current % CORR_WHEEL_SLOTS);
+        unsigned int idx = _corr->slots[slot];
+        while (idx != CORR_NONE) {
+            corr_entry_t *entry = &_corr->entries[idx];
+            unsigned int next = entry->next;
+            if (entry->deadline <= _now) {
+                _corr->stats[entry->service].timeouts++;
+                corr_remove(_corr, corr_find(
+                        _corr, entry->assoc, entry->invoke));
+                expired++;
+            }
+            idx = next;
+        }
+        _corr->current++;
+    }
+    return expired;
+}
+
+size_t corr_outstanding(const corr_t *_corr) {
+    return _corr == NULL ? 0 : _corr->count;
+}
+
+const corr_stats_t *corr_stats(const corr_t *_corr, int _service) {
+    if (_corr == NULL || _service < 0 || _service >= CORR_SERVICE_COUNT) {
+        return NULL;
+    }
+    return &_corr->stats[_service];
+}
+
+void corr_merge(corr_t *_dest, const corr_t *_src) {
+    if (_dest == NULL || _src == NULL) {
+        return;
+    }
+    int service = 0;
+    while (service < CORR_SERVICE_COUNT) {
+        corr_stats_t *dest = &_dest->stats[service];
+        const corr_stats_t *src = &_src->stats[service];
+        dest->requests += src->requests;
+        dest->responses += src->responses;
+        dest->errors += src->errors;
+        dest->timeouts += src->timeouts;
+        dest->unmatched += src->unmatched;
+        dest->dropped += src->dropped;
+        corr_histogram_t *hist = &dest->latency;
+        if (src->latency.count > 0) {
+            if (hist->count == 0 || src->latency.min < hist->min) {
+                hist->min = src->latency.min;
+            }
+            if (src->latency.max > hist->max) {
+                hist->max = src->latency.max;
+            }
+            hist->count += src->latency.count;
+            hist->sum += src->latency.sum;
+            size_t idx = 0;
+            while (idx < CORR_HIST_SIZE) {
+                hist->buckets[idx] += src->latency.buckets[idx];
+                idx++;
+            }
+        }
+        service++;
+    }
+}
@@ -0,0 +1,121 @@
+#ifndef MMS_CORR_H
+#define MMS_CORR_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#define CORR_ERR_NULL (-1)
+#define CORR_ERR_MEMALLOC (-2)
+// every slot of the outstanding requests is taken
+#define CORR_ERR_FULL (-3)
+// no outstanding request has the invoke id
+#define CORR_ERR_UNMATCHED (-4)
+
+// services with statistics of their own
+#define CORR_SERVICE_READ (0)
+#define CORR_SERVICE_WRITE (1)
+#define CORR_SERVICE_NAMES (2) // GetNameList
+#define CORR_SERVICE_VARATTR (3) // GetVariableAccessAttributes
+#define CORR_SERVICE_FILEDIR (4)
+#define CORR_SERVICE_FOPEN (5)
+#define CORR_SERVICE_FREAD (6)
+#define CORR_SERVICE_FCLOSE (7)
+#define CORR_SERVICE_OTHER (8)
+#define CORR_SERVICE_COUNT (9)
+
+// outstanding requests and nanoseconds before a request times out
+#define CORR_OUTSTANDING_DEFAULT (65536)
+#define CORR_TIMEOUT_DEFAULT (30000000000ull)
+
+// a power of two is split in 2^CORR_HIST_BITS buckets, a recorded
+// latency is off by less than 1/16. latencies of 2^CORR_HIST_RANGE
+// nanoseconds (about 78 hours) and more share the last bucket
+#define CORR_HIST_BITS (4)
+#define CORR_HIST_RANGE (48)
+#define CORR_HIST_SIZE ((CORR_HIST_RANGE - CORR_HIST_BITS + 1) << CORR_HIST_BITS)
+
+// log-bucketed latencies in nanoseconds
+typedef struct corr_histogram_t {
+    unsigned long long count;
+    unsigned long long min;
+    unsigned long long max;
+    unsigned long long sum;
+    unsigned long long buckets[CORR_HIST_SIZE];
+} corr_histogram_t;
+
+void corr_histogram_record(
+        corr_histogram_t *_hist, unsigned long long _value);
+
+// the latency under which _quantile (0 to 1) of the
+// recorded ones fall, 0 for an empty histogram
+unsigned long long corr_histogram_quantile(
+        const corr_histogram_t *_hist, double _quantile);
+
+// counters of a service
+typedef struct corr_stats_t {
+    unsigned long long requests;
+    unsigned long long responses; // matched, confirmed errors included
+    unsigned long long errors; // confirmed errors
+    unsigned long long timeouts;
+    unsigned long long unmatched; // responses without a request
+    unsigned long long dropped; // requests not tracked, the table is full
+    corr_histogram_t latency;
+} corr_stats_t;
+
+// options of a correlator, 0 selects the default
+typedef struct corr_option_t {
+    size_t outstanding;
+    unsigned long long timeout;
+} corr_option_t;
+
+// pairs the confirmed requests of associations with their responses.
+// the outstanding requests live in a fixed pool, inserting, matching
+// and expiring one does not allocate
+typedef struct corr_t corr_t;
+
+corr_t *corr_create(const corr_option_t *_option);
+
+void corr_destroy(corr_t *_corr);
+
+// CORR_SERVICE_* of a confirmed service tag (mms_header_t.service)
+int corr_service(int _tag);
+
+const char *corr_service_name(int _service);
+
+// track a request of service tag _tag sent at _now (ns) on the
+// association _assoc, an identifier chosen by the caller which is
+// the same for the response. a request reusing the invoke id of an
+// outstanding one replaces it, the client gave up on the earlier
+// one and it counts as timed out. return 0 or the error
+int corr_request(
+        corr_t *_corr, unsigned long long _assoc,
+        unsigned int _invoke, int _tag,
+        unsigned long long _now);
+
+// match a response, or a confirmed error when _error is set, and
+// record its latency. return the CORR_SERVICE_* of the request or
+// CORR_ERR_UNMATCHED
+int corr_response(
+        corr_t *_corr, unsigned long long _assoc,
+        unsigned int _invoke, int _error,
+        unsigned long long _now);
+
+// time out the requests older than the timeout at _now,
+// return how many timed out
+int corr_expire(corr_t *_corr, unsigned long long _now);
+
+size_t corr_outstanding(const corr_t *_corr);
+
+const corr_stats_t *corr_stats(const corr_t *_corr, int _service);
+
+// add the statistics of _src to _dest
+void corr_merge(corr_t *_dest, const corr_t *_src);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // !MMS_CORR_H
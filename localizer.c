@@ -7,6 +7,7 @@
 #include "localizer.h"
 #include "node.h"
 #include "xlist.h"
+#include "xmem.h"
 
 /*****************************str_pair_t*****************************/
 
@@ -18,7 +19,7 @@ typedef struct str_pair_t {
 } str_pair_t;
 
 static int pair_destroy(node_t *_node) {
-    free(_node);
+    xmem_free(_node);
     return 0;
 }
 
@@ -32,7 +33,7 @@ static node_t *pair_create(
     if (_source == NULL || _target == NULL) {
         return NULL;
     }
-    str_pair_t *pair = (str_pair_t *) malloc(sizeof(str_pair_t));
+    str_pair_t *pair = (str_pair_t *) xmem_alloc(sizeof(str_pair_t));
     memset(pair, 0, sizeof(str_pair_t));
     pair->parent.op = &nodeop;
     pair->length = strlen(_source);
@@ -52,7 +53,7 @@ trans_t g_locale = {0, NULL};
 
 // translate core
 static const char *translate(
-        trans_t *_trans, const char *_source) {
+        const trans_t *_trans, const char *_source) {
     const char *target = "";
     if (_source == NULL) {
         return target;
@@ -62,11 +63,13 @@ static const char *translate(
         return target;
     }
     size_t length = strlen(_source);
-    str_pair_t *pair = (str_pair_t *) xlist_begin(_trans->pairs);
+    xlist_iter_t iter;
+    xlist_iter_init(&iter, _trans->pairs);
+    const str_pair_t *pair = (const str_pair_t *) xlist_iter_next(&iter);
     while (pair != NULL) {
         if (pair->length == length &&
             0 == strcmp(pair->source, _source)) {
-            pair = (str_pair_t *) xlist_next(_trans->pairs);
+            pair = (const str_pair_t *) xlist_iter_next(&iter);
             continue;
         }
         target = pair->target;
@@ -98,7 +101,7 @@ static void gen_chinese_cn(trans_t *_trans) {
     append_pair(_trans, "message parsing error:{error:%s, position:%u}", "报文解析错误:{错误:%s, 位置:%u}");
     append_pair(_trans, "fileAttr:{size:%u, UTC_stamp:%04d-%02d-%02d %02d:%02d:%02d}",
                 "文件属性:{大小:%u, UTC时间戳:%04d-%02d-%02d %02d:%02d:%02d}");
-    append_pair(_trans, "fileOpenRequest:{path:%s, position:%u}", "文件打开请求:{路径:%s, 位置:%u}");
+    append_pair(_trans, "fileOpenRequest:{path:%.*s, position:%u}", "文件打开请求:{路径:%.*s, 位置:%u}");
     append_pair(_trans, "fileOpenResponse:{fileHandle:%u, ", "文件打开响应:{文件句柄:%u, ");
     append_pair(_trans, "fileReadRequest:{fileHandle:%u}", "文件读取请求:{文件句柄:%u}");
     append_pair(_trans, "fileReadResponse:{size:%u", "文件读取响应:{大小：%u");
@@ -109,11 +112,11 @@ static void gen_chinese_cn(trans_t *_trans) {
     append_pair(_trans, "fileCloseResponse:{success}", "文件关闭响应:{成功}");
     append_pair(_trans, "fileCloseResponse:{failed}", "文件关闭响应:{失败}");
     append_pair(_trans, "fileDirRequest:{", "文件目录请求:{");
-    append_pair(_trans, "pathSpec:{path:%s}", "指定路径:{路径:%s}");
+    append_pair(_trans, "pathSpec:{path:%.*s}", "指定路径:{路径:%.*s}");
     append_pair(_trans, "", "");
-    append_pair(_trans, "directoryEntry:{path:%s, ", "目录项:{路径:%s, ");
+    append_pair(_trans, "directoryEntry:{path:%.*s, ", "目录项:{路径:%.*s, ");
     append_pair(_trans, "", "");
-    append_pair(_trans, "varSpec:{%s/%s}", "指定变量:{%s/%s}");
+    append_pair(_trans, "varSpec:{%.*s/%.*s}", "指定变量:{%.*s/%.*s}");
     append_pair(_trans, "", "");
     append_pair(_trans, "", "");
     append_pair(_trans, "", "");
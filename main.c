@@ -1,69 +1,1028 @@
+#include <signal.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#if defined(_WIN32)
+#include <process.h>
+#define getpid _getpid
+#else
+#include <unistd.h>
+#endif
+#include "corr.h"
+#include "node.h"
+#include "osi.h"
 #include "parser.h"
+#include "pcap.h"
+#include "ring.h"
+#include "tcp.h"
+#include "xhex.h"
+#include "xmap.h"
+#include "xthread.h"
 
-static int make_msg(unsigned char *buffer, int length) {
-    if (buffer == NULL || length <= 0) {
+#define OUTPUT_SIZE (10240)
+
+// read the next non-empty line into a growing buffer,
+// return its length or -1 at the end of file
+static int read_line(FILE *_file, char **_line, size_t *_size) {
+    int ch = fgetc(_file);
+    while (ch == ' ' || ch == '\t' ||
+           ch == '\r' || ch == '\n') {
+        ch = fgetc(_file);
+    }
+    if (ch == EOF) {
+        return -1;
+    }
+    size_t length = 0;
+    while (ch != EOF && ch != '\n') {
+        if (length + 1 >= (*_size)) {
+            size_t size = (*_size) * 2 + 256;
+            char *line = (char *) realloc(*_line, size);
+            if (line == NULL) {
+                return -1;
+            }
+            (*_line) = line;
+            (*_size) = size;
+        }
+        (*_line)[length++] = (char) ch;
+        ch = fgetc(_file);
+    }
+    while (length > 0 && (*_line)[length - 1] == '\r') {
+        length--;
+    }
+    (*_line)[length] = 0;
+    return (int) length;
+}
+
+// decode the line in place and render it into _output,
+// comments are copied. return the output length
+static int decode_line(
+        char *_line, int _length,
+        char *_output, size_t _size) {
+    if (_line[0] == '#') {
+        int length = snprintf(_output, _size, "%s", _line);
+        if (length >= (int) _size) {
+            length = (int) _size - 1;
+        }
+        return length;
+    }
+    unsigned char *buffer = (unsigned char *) _line;
+    size_t written = 0;
+    if (xhex_decode(_line, (size_t) _length, buffer, &written) < 0 ||
+        written == 0) {
         return 0;
     }
-    int writ = 0;
-    int read = 0;
-    while (read < length) {
-        unsigned char tmp_val = buffer[read];
-        if ('0' <= tmp_val && '9' >= tmp_val) {
-            tmp_val = tmp_val - '0';
-        } else if ('a' <= tmp_val && 'f' >= tmp_val) {
-            tmp_val = tmp_val - 'a' + 10;
-        } else if ('A' <= tmp_val && 'F' >= tmp_val) {
-            tmp_val = tmp_val - 'A' + 10;
-        } else {
+    // strings of the service borrow from the line,
+    // so render into a buffer of its own
+    service_t *service = mms_parse_ex(
+            buffer, written,
+            MMS_PARSE_ARENA | MMS_PARSE_BORROW |
+            MMS_PARSE_COMPACT);
+    int length = mms_tostring(service, _output, _size);
+    mms_destroy(service);
+    return length;
+}
+
+static int decode_file(FILE *_file) {
+    char *output = (char *) malloc(OUTPUT_SIZE);
+    if (output == NULL) {
+        return -1;
+    }
+    char *line = NULL;
+    size_t size = 0;
+    int length = read_line(_file, &line, &size);
+    while (length >= 0) {
+        length = decode_line(line, length, output, OUTPUT_SIZE);
+        if (length > 0) {
+            printf("%s\n", output);
+        }
+        length = read_line(_file, &line, &size);
+    }
+    free(line);
+    free(output);
+    node_pool_trim();
+    return 0;
+}
+
+/*********************************pipeline*********************************/
+
+// a line of the capture travelling through the pipeline
+typedef struct job_t {
+    char *line;
+    size_t size;
+    int length;
+    char *output;
+    int outlen;
+    int done;
+} job_t;
+
+// the reader fills the ring in input order, workers decode
+// any filled slot and the writer prints the slots in order
+typedef struct pipeline_t {
+    FILE *file;
+    job_t *jobs;
+    unsigned int slots;
+    unsigned long long read; // lines read
+    unsigned long long work; // lines taken by workers
+    unsigned long long writ; // lines printed
+    int eof;
+    xmutex_t *mutex;
+    xcond_t *filled; // workers wait for lines
+    xcond_t *decoded; // the writer waits for results
+    xcond_t *vacant; // the reader waits for free slots
+} pipeline_t;
+
+static void reader_main(void *_pipe) {
+    pipeline_t *pipe = (pipeline_t *) _pipe;
+    while (1) {
+        xmutex_lock(pipe->mutex);
+        while (pipe->read - pipe->writ >= pipe->slots) {
+            xcond_wait(pipe->vacant, pipe->mutex);
+        }
+        job_t *job = pipe->jobs + pipe->read % pipe->slots;
+        xmutex_unlock(pipe->mutex);
+        // the slot is owned by the reader until it is published
+        int length = read_line(pipe->file, &job->line, &job->size);
+        xmutex_lock(pipe->mutex);
+        if (length < 0) {
+            pipe->eof = 1;
+            xcond_broadcast(pipe->filled);
+            xcond_signal(pipe->decoded);
+            xmutex_unlock(pipe->mutex);
+            break;
+        }
+        job->length = length;
+        job->done = 0;
+        pipe->read++;
+        xcond_signal(pipe->filled);
+        xmutex_unlock(pipe->mutex);
+    }
+}
+
+static void worker_main(void *_pipe) {
+    pipeline_t *pipe = (pipeline_t *) _pipe;
+    xmutex_lock(pipe->mutex);
+    while (1) {
+        while (pipe->work == pipe->read && !pipe->eof) {
+            xcond_wait(pipe->filled, pipe->mutex);
+        }
+        if (pipe->work == pipe->read) {
+            break;
+        }
+        job_t *job = pipe->jobs + pipe->work % pipe->slots;
+        pipe->work++;
+        xmutex_unlock(pipe->mutex);
+        job->outlen = decode_line(
+                job->line, job->length,
+                job->output, OUTPUT_SIZE);
+        xmutex_lock(pipe->mutex);
+        job->done = 1;
+        if (job == pipe->jobs + pipe->writ % pipe->slots) {
+            xcond_signal(pipe->decoded);
+        }
+    }
+    xmutex_unlock(pipe->mutex);
+    node_pool_trim();
+}
+
+static void writer_main(pipeline_t *_pipe) {
+    xmutex_lock(_pipe->mutex);
+    while (1) {
+        job_t *job = _pipe->jobs + _pipe->writ % _pipe->slots;
+        while (_pipe->writ < _pipe->read ? !job->done : !_pipe->eof) {
+            xcond_wait(_pipe->decoded, _pipe->mutex);
+        }
+        if (_pipe->writ == _pipe->read) {
+            break;
+        }
+        xmutex_unlock(_pipe->mutex);
+        if (job->outlen > 0) {
+            fwrite(job->output, 1, job->outlen, stdout);
+            fputc('\n', stdout);
+        }
+        xmutex_lock(_pipe->mutex);
+        _pipe->writ++;
+        xcond_signal(_pipe->vacant);
+    }
+    xmutex_unlock(_pipe->mutex);
+}
+
+static void pipeline_release(pipeline_t *_pipe) {
+    unsigned int idx = 0;
+    while (_pipe->jobs != NULL && idx < _pipe->slots) {
+        free(_pipe->jobs[idx].line);
+        free(_pipe->jobs[idx].output);
+        idx++;
+    }
+    free(_pipe->jobs);
+    xcond_destroy(_pipe->vacant);
+    xcond_destroy(_pipe->decoded);
+    xcond_destroy(_pipe->filled);
+    xmutex_destroy(_pipe->mutex);
+}
+
+static int decode_file_jobs(FILE *_file, unsigned int _jobs) {
+    pipeline_t pipe;
+    memset(&pipe, 0, sizeof(pipeline_t));
+    pipe.file = _file;
+    // enough slots to keep every worker busy
+    // while the writer waits for the oldest line
+    pipe.slots = _jobs * 8;
+    pipe.jobs = (job_t *) calloc(pipe.slots, sizeof(job_t));
+    pipe.mutex = xmutex_create();
+    pipe.filled = xcond_create();
+    pipe.decoded = xcond_create();
+    pipe.vacant = xcond_create();
+    int ret = -1;
+    if (pipe.jobs == NULL || pipe.mutex == NULL ||
+        pipe.filled == NULL || pipe.decoded == NULL ||
+        pipe.vacant == NULL) {
+        pipeline_release(&pipe);
+        return ret;
+    }
+    unsigned int idx = 0;
+    while (idx < pipe.slots) {
+        pipe.jobs[idx].output = (char *) malloc(OUTPUT_SIZE);
+        if (pipe.jobs[idx].output == NULL) {
+            pipeline_release(&pipe);
+            return ret;
+        }
+        idx++;
+    }
+    xthread_t **workers = (xthread_t **)
+            calloc(_jobs, sizeof(xthread_t *));
+    if (workers == NULL) {
+        pipeline_release(&pipe);
+        return ret;
+    }
+    idx = 0;
+    while (idx < _jobs) {
+        workers[idx++] = xthread_create(worker_main, &pipe);
+    }
+    xthread_t *reader = NULL;
+    // without a worker no line would ever be decoded
+    if (workers[0] != NULL) {
+        reader = xthread_create(reader_main, &pipe);
+    }
+    if (reader != NULL) {
+        writer_main(&pipe);
+        xthread_join(reader);
+        ret = 0;
+    } else {
+        // let the started workers leave
+        xmutex_lock(pipe.mutex);
+        pipe.eof = 1;
+        xcond_broadcast(pipe.filled);
+        xmutex_unlock(pipe.mutex);
+    }
+    idx = 0;
+    while (idx < _jobs) {
+        xthread_join(workers[idx++]);
+    }
+    free(workers);
+    pipeline_release(&pipe);
+    return ret;
+}
+
+/*********************************mapped*********************************/
+
+// bytes of the map a worker takes at once,
+// extended to the end of the line
+#define CHUNK_SIZE (262144)
+
+// the rendering of a line aligned chunk of the map
+typedef struct chunk_t {
+    char *output;
+    size_t used;
+    size_t size;
+    int done;
+} chunk_t;
+
+// buffers of a decoding thread: the pdu decoded from the hex
+// digits and the rendering of its service
+typedef struct scratch_t {
+    unsigned char *pdu;
+    size_t size;
+    char output[OUTPUT_SIZE];
+} scratch_t;
+
+// workers take the chunks of the map in input order and
+// the writer prints the decoded chunks in the same order
+typedef struct mapping_t {
+    const char *data;
+    size_t size;
+    size_t offset; // start of the next chunk
+    chunk_t *chunks;
+    unsigned int slots;
+    unsigned long long taken; // chunks taken by workers
+    unsigned long long writ; // chunks printed
+    xmutex_t *mutex;
+    xcond_t *decoded; // the writer waits for results
+    xcond_t *vacant; // workers wait for free slots
+} mapping_t;
+
+static int chunk_append(
+        chunk_t *_chunk,
+        const char *_data, size_t _length) {
+    if (_chunk->used + _length + 1 > _chunk->size) {
+        size_t size = _chunk->size * 2 + _length + OUTPUT_SIZE;
+        char *output = (char *) realloc(_chunk->output, size);
+        if (output == NULL) {
+            return -1;
+        }
+        _chunk->output = output;
+        _chunk->size = size;
+    }
+    memcpy(_chunk->output + _chunk->used, _data, _length);
+    _chunk->used += _length;
+    _chunk->output[_chunk->used++] = '\n';
+    return 0;
+}
+
+// decode one line of the map straight into the pdu buffer
+// and append its rendering to the chunk
+static int decode_mapped_line(
+        const char *_line, size_t _length,
+        scratch_t *_scratch, chunk_t *_chunk) {
+    if (_line[0] == '#') {
+        size_t length = _length;
+        if (length > OUTPUT_SIZE - 1) {
+            length = OUTPUT_SIZE - 1;
+        }
+        return chunk_append(_chunk, _line, length);
+    }
+    if (_length / 2 + 1 > _scratch->size) {
+        size_t size = _length / 2 + 256;
+        unsigned char *pdu = (unsigned char *) realloc(
+                _scratch->pdu, size);
+        if (pdu == NULL) {
+            return -1;
+        }
+        _scratch->pdu = pdu;
+        _scratch->size = size;
+    }
+    size_t length = 0;
+    if (xhex_decode(_line, _length, _scratch->pdu, &length) < 0 ||
+        length == 0) {
+        return 0;
+    }
+    service_t *service = mms_parse_ex(
+            _scratch->pdu, length,
+            MMS_PARSE_ARENA | MMS_PARSE_BORROW |
+            MMS_PARSE_COMPACT);
+    int outlen = mms_tostring(
+            service, _scratch->output, OUTPUT_SIZE);
+    mms_destroy(service);
+    if (outlen <= 0) {
+        return 0;
+    }
+    return chunk_append(_chunk, _scratch->output, (size_t) outlen);
+}
+
+// render the non-empty lines of _data like read_line splits them
+static int decode_chunk(
+        const char *_data, size_t _length,
+        scratch_t *_scratch, chunk_t *_chunk) {
+    const char *data = _data;
+    const char *end = _data + _length;
+    _chunk->used = 0;
+    while (data < end) {
+        if (*data == ' ' || *data == '\t' ||
+            *data == '\r' || *data == '\n') {
+            data++;
+            continue;
+        }
+        const char *eol = (const char *) memchr(data, '\n', end - data);
+        if (eol == NULL) {
+            eol = end;
+        }
+        size_t length = eol - data;
+        while (length > 0 && data[length - 1] == '\r') {
+            length--;
+        }
+        if (decode_mapped_line(data, length, _scratch, _chunk) < 0) {
+            return -1;
+        }
+        data = eol;
+    }
+    return 0;
+}
+
+// end of the chunk starting at _start: CHUNK_SIZE bytes
+// further, after the end of that line
+static size_t chunk_end(
+        const char *_data, size_t _size, size_t _start) {
+    if (_size - _start <= CHUNK_SIZE) {
+        return _size;
+    }
+    size_t end = _start + CHUNK_SIZE;
+    const char *eol = (const char *) memchr(
+            _data + end, '\n', _size - end);
+    return eol == NULL ? _size : (size_t) (eol - _data) + 1;
+}
+
+static void mapped_main(void *_map) {
+    mapping_t *map = (mapping_t *) _map;
+    scratch_t *scratch = (scratch_t *) calloc(1, sizeof(scratch_t));
+    xmutex_lock(map->mutex);
+    while (1) {
+        while (map->taken - map->writ >= map->slots &&
+               map->offset < map->size) {
+            xcond_wait(map->vacant, map->mutex);
+        }
+        if (map->offset == map->size) {
             break;
         }
-        if (read & 1) {
-            buffer[writ] += tmp_val;
-            writ++;
+        chunk_t *chunk = map->chunks + map->taken % map->slots;
+        map->taken++;
+        size_t start = map->offset;
+        map->offset = chunk_end(map->data, map->size, start);
+        size_t length = map->offset - start;
+        chunk->done = 0;
+        xmutex_unlock(map->mutex);
+        // a chunk that failed is printed as far as it got
+        if (scratch != NULL) {
+            decode_chunk(map->data + start, length, scratch, chunk);
         } else {
-            tmp_val <<= 4;
-            buffer[writ] = tmp_val;
+            chunk->used = 0;
+        }
+        xmutex_lock(map->mutex);
+        chunk->done = 1;
+        if (chunk == map->chunks + map->writ % map->slots) {
+            xcond_signal(map->decoded);
+        }
+    }
+    xmutex_unlock(map->mutex);
+    if (scratch != NULL) {
+        free(scratch->pdu);
+        free(scratch);
+    }
+    node_pool_trim();
+}
+
+static void mapped_writer(mapping_t *_map) {
+    xmutex_lock(_map->mutex);
+    while (1) {
+        chunk_t *chunk = _map->chunks + _map->writ % _map->slots;
+        while (_map->writ < _map->taken ?
+               !chunk->done : _map->offset < _map->size) {
+            xcond_wait(_map->decoded, _map->mutex);
+        }
+        if (_map->writ == _map->taken) {
+            break;
+        }
+        xmutex_unlock(_map->mutex);
+        if (chunk->used > 0) {
+            fwrite(chunk->output, 1, chunk->used, stdout);
+        }
+        xmutex_lock(_map->mutex);
+        _map->writ++;
+        xcond_broadcast(_map->vacant);
+    }
+    xmutex_unlock(_map->mutex);
+}
+
+static void mapping_release(mapping_t *_map) {
+    unsigned int idx = 0;
+    while (_map->chunks != NULL && idx < _map->slots) {
+        free(_map->chunks[idx++].output);
+    }
+    free(_map->chunks);
+    xcond_destroy(_map->vacant);
+    xcond_destroy(_map->decoded);
+    xmutex_destroy(_map->mutex);
+}
+
+// decode the mapped file with _jobs workers,
+// a single job decodes the chunks on the calling thread
+static int decode_mapped(const xmap_t *_file, unsigned int _jobs) {
+    const char *data = (const char *) xmap_data(_file);
+    size_t size = xmap_size(_file);
+    if (_jobs <= 1) {
+        scratch_t *scratch = (scratch_t *) calloc(1, sizeof(scratch_t));
+        chunk_t chunk;
+        memset(&chunk, 0, sizeof(chunk_t));
+        int ret = scratch == NULL ? -1 : 0;
+        size_t offset = 0;
+        while (ret == 0 && offset < size) {
+            size_t end = chunk_end(data, size, offset);
+            ret = decode_chunk(data + offset, end - offset, scratch, &chunk);
+            if (chunk.used > 0) {
+                fwrite(chunk.output, 1, chunk.used, stdout);
+            }
+            offset = end;
+        }
+        free(chunk.output);
+        if (scratch != NULL) {
+            free(scratch->pdu);
+            free(scratch);
+        }
+        node_pool_trim();
+        return ret;
+    }
+    mapping_t map;
+    memset(&map, 0, sizeof(mapping_t));
+    map.data = data;
+    map.size = size;
+    // enough slots to keep every worker busy
+    // while the writer waits for the oldest chunk
+    map.slots = _jobs * 4;
+    map.chunks = (chunk_t *) calloc(map.slots, sizeof(chunk_t));
+    map.mutex = xmutex_create();
+    map.decoded = xcond_create();
+    map.vacant = xcond_create();
+    if (map.chunks == NULL || map.mutex == NULL ||
+        map.decoded == NULL || map.vacant == NULL) {
+        mapping_release(&map);
+        return -1;
+    }
+    xthread_t **workers = (xthread_t **)
+            calloc(_jobs, sizeof(xthread_t *));
+    if (workers == NULL) {
+        mapping_release(&map);
+        return -1;
+    }
+    unsigned int idx = 0;
+    while (idx < _jobs) {
+        workers[idx++] = xthread_create(mapped_main, &map);
+    }
+    int ret = -1;
+    if (workers[0] != NULL) {
+        mapped_writer(&map);
+        ret = 0;
+    } else {
+        // without the writer no slot is freed, let the workers leave
+        xmutex_lock(map.mutex);
+        map.offset = map.size;
+        xcond_broadcast(map.vacant);
+        xmutex_unlock(map.mutex);
+    }
+    idx = 0;
+    while (idx < _jobs) {
+        xthread_join(workers[idx++]);
+    }
+    free(workers);
+    mapping_release(&map);
+    return ret;
+}
+
+/*********************************capture*********************************/
+
+// the flows of a capture, the requests waiting for a response
+// and the rendering of their pdus
+typedef struct capture_t {
+    tcp_table_t *table;
+    corr_t *corr;
+    char output[OUTPUT_SIZE];
+} capture_t;
+
+// a direction of a connection from or to the iso transport port
+typedef struct capture_flow_t {
+    capture_t *capture;
+    tcp_key_t key;
+    osi_stream_t *osi;
+    int lost; // bytes were lost, the next tpkt is searched
+    unsigned long long stamp; // time the bytes fed to osi were seen
+} capture_flow_t;
+
+static int address_tostring(
+        const tcp_key_t *_key, int _dst,
+        char *_dest, size_t _size) {
+    const unsigned char *addr = _dst ? _key->dst : _key->src;
+    unsigned int port = _dst ? _key->dport : _key->sport;
+    if (_key->family == 4) {
+        return snprintf(
+                _dest, _size, "%u.%u.%u.%u:%u",
+                addr[0], addr[1], addr[2], addr[3], port);
+    }
+    int idx = snprintf(_dest, _size, "[");
+    int group = 0;
+    while (group < 8 && idx > 0 && idx < (int) _size) {
+        idx += snprintf(
+                _dest + idx, _size - idx, group == 0 ? "%x" : ":%x",
+                (addr[group * 2] << 8) | addr[group * 2 + 1]);
+        group++;
+    }
+    if (idx > 0 && idx < (int) _size) {
+        idx += snprintf(_dest + idx, _size - idx, "]:%u", port);
+    }
+    return idx;
+}
+
+// the association of a flow, seen from the sender of requests:
+// a response on the reverse flow has the same identifier
+static unsigned long long capture_assoc(
+        const tcp_key_t *_key, int _reverse) {
+    const unsigned char *src = _reverse ? _key->dst : _key->src;
+    const unsigned char *dst = _reverse ? _key->src : _key->dst;
+    unsigned int sport = _reverse ? _key->dport : _key->sport;
+    unsigned int dport = _reverse ? _key->sport : _key->dport;
+    // fnv-1a
+    unsigned long long hash = 0xcbf29ce484222325ull;
+    unsigned char bytes[37];
+    memcpy(bytes, src, 16);
+    memcpy(bytes + 16, dst, 16);
+    bytes[32] = (unsigned char) (sport >> 8);
+    bytes[33] = (unsigned char) sport;
+    bytes[34] = (unsigned char) (dport >> 8);
+    bytes[35] = (unsigned char) dport;
+    bytes[36] = (unsigned char) _key->family;
+    size_t idx = 0;
+    while (idx < sizeof(bytes)) {
+        hash = (hash ^ bytes[idx++]) * 0x100000001b3ull;
+    }
+    return hash;
+}
+
+// pair the confirmed requests of a flow with the responses
+// and errors of the reverse flow
+static void capture_correlate(
+        capture_flow_t *_flow, const osi_data_t *_data) {
+    mms_header_t header;
+    if (mms_peek(_data->data, _data->length, &header) < 0) {
+        return;
+    }
+    capture_t *capture = _flow->capture;
+    unsigned long long stamp = _flow->stamp;
+    if (header.type == 0xa0) {
+        corr_request(capture->corr, capture_assoc(&_flow->key, 0),
+                     header.invoke, header.service, stamp);
+    } else if (header.type == 0xa1 || header.type == 0xa2) {
+        corr_response(capture->corr, capture_assoc(&_flow->key, 1),
+                      header.invoke, header.type == 0xa2, stamp);
+    }
+}
+
+// receives the mms and acse pdus of a flow, they point into the
+// mapping unless their tpkts were split across segments
+static void capture_pdu(void *_flow, const osi_data_t *_data) {
+    capture_flow_t *flow = (capture_flow_t *) _flow;
+    capture_t *capture = flow->capture;
+    if (_data->kind == OSI_DATA_MMS) {
+        capture_correlate(flow, _data);
+    }
+    unsigned int flags = MMS_PARSE_ARENA | MMS_PARSE_BORROW |
+                         MMS_PARSE_COMPACT;
+    service_t *service = NULL;
+    if (_data->kind == OSI_DATA_MMS) {
+        service = mms_parse_ex(_data->data, _data->length, flags);
+    } else {
+        // the initiate of an association, nothing for a release
+        mms_option_t option;
+        memset(&option, 0, sizeof(mms_option_t));
+        option.flags = flags;
+        service = mms_parse_assoc(
+                _data->ppdu, _data->ppdu_length, &option);
+    }
+    if (service == NULL) {
+        return;
+    }
+    int length = mms_tostring(service, capture->output, OUTPUT_SIZE);
+    mms_destroy(service);
+    if (length <= 0) {
+        return;
+    }
+    char src[64];
+    char dst[64];
+    address_tostring(&flow->key, 0, src, sizeof(src));
+    address_tostring(&flow->key, 1, dst, sizeof(dst));
+    unsigned long long stamp = flow->stamp;
+    printf("# %llu.%09llu %s > %s\n%s\n",
+           stamp / 1000000000ull, stamp % 1000000000ull,
+           src, dst, capture->output);
+}
+
+static void *capture_open(void *_capture, const tcp_key_t *_key) {
+    if (_key->sport != TCP_PORT_ISO && _key->dport != TCP_PORT_ISO) {
+        return NULL;
+    }
+    capture_flow_t *flow = (capture_flow_t *)
+            calloc(1, sizeof(capture_flow_t));
+    if (flow == NULL) {
+        return NULL;
+    }
+    flow->capture = (capture_t *) _capture;
+    flow->key = (*_key);
+    flow->osi = osi_stream_create(0, capture_pdu, flow);
+    if (flow->osi == NULL) {
+        free(flow);
+        return NULL;
+    }
+    return flow;
+}
+
+static void capture_data(
+        void *_capture, void *_flow,
+        const unsigned char *_data, size_t _length,
+        unsigned long long _stamp) {
+    capture_flow_t *flow = (capture_flow_t *) _flow;
+    (void) _capture;
+    flow->stamp = _stamp;
+    if (flow->lost) {
+        size_t skip = osi_sync(_data, _length);
+        if (skip == _length) {
+            return;
+        }
+        _data += skip;
+        _length -= skip;
+        flow->lost = 0;
+    }
+    if (osi_stream_feed(flow->osi, _data, _length) < 0) {
+        // resynchronize on a later tpkt
+        osi_stream_reset(flow->osi);
+        flow->lost = 1;
+    }
+}
+
+static void capture_gap(void *_capture, void *_flow) {
+    capture_flow_t *flow = (capture_flow_t *) _flow;
+    (void) _capture;
+    osi_stream_reset(flow->osi);
+    flow->lost = 1;
+}
+
+static void capture_close(void *_capture, void *_flow) {
+    capture_flow_t *flow = (capture_flow_t *) _flow;
+    (void) _capture;
+    osi_stream_destroy(flow->osi);
+    free(flow);
+}
+
+static capture_t *capture_create(void) {
+    capture_t *capture = (capture_t *) calloc(1, sizeof(capture_t));
+    if (capture == NULL) {
+        return NULL;
+    }
+    tcp_handler_t handler;
+    memset(&handler, 0, sizeof(tcp_handler_t));
+    handler.open = capture_open;
+    handler.data = capture_data;
+    handler.gap = capture_gap;
+    handler.close = capture_close;
+    handler.context = capture;
+    capture->table = tcp_table_create(&handler, NULL);
+    capture->corr = corr_create(NULL);
+    if (capture->table == NULL || capture->corr == NULL) {
+        tcp_table_destroy(capture->table);
+        corr_destroy(capture->corr);
+        free(capture);
+        return NULL;
+    }
+    return capture;
+}
+
+// close the flows, the pdus kept behind their holes are
+// decoded and counted before the report
+static void capture_flush(capture_t *_capture) {
+    tcp_table_expire(_capture->table, TCP_TIME_END);
+}
+
+static void capture_destroy(capture_t *_capture) {
+    tcp_table_destroy(_capture->table);
+    corr_destroy(_capture->corr);
+    free(_capture);
+}
+
+// print the request counters and latencies of each service
+static void capture_report(const corr_t *_corr) {
+    fprintf(stderr, "%-28s %9s %9s %7s %8s %9s %10s %10s %10s %10s\n",
+            "service", "requests", "responses", "errors", "timeouts",
+            "unmatched", "p50(us)", "p90(us)", "p99(us)", "max(us)");
+    int service = 0;
+    while (service < CORR_SERVICE_COUNT) {
+        const corr_stats_t *stats = corr_stats(_corr, service);
+        const corr_histogram_t *hist = &stats->latency;
+        if (stats->requests != 0 || stats->unmatched != 0) {
+            fprintf(stderr,
+                    "%-28s %9llu %9llu %7llu %8llu %9llu "
+                    "%10.1f %10.1f %10.1f %10.1f\n",
+                    corr_service_name(service),
+                    stats->requests, stats->responses, stats->errors,
+                    stats->timeouts, stats->unmatched,
+                    corr_histogram_quantile(hist, 0.5) / 1000.0,
+                    corr_histogram_quantile(hist, 0.9) / 1000.0,
+                    corr_histogram_quantile(hist, 0.99) / 1000.0,
+                    hist->max / 1000.0);
         }
-        read++;
+        service++;
+    }
+    fprintf(stderr, "%llu outstanding\n",
+            (unsigned long long) corr_outstanding(_corr));
+}
+
+// feed a captured frame to the flows of the capture
+static void capture_packet(void *_capture, const pcap_packet_t *_packet) {
+    capture_t *capture = (capture_t *) _capture;
+    tcp_segment_t segment;
+    if (tcp_decode(_packet->link, _packet->data,
+                   _packet->length, &segment) > 0) {
+        tcp_table_feed(capture->table, &segment, _packet->stamp);
     }
-    if (read != length) {
+    corr_expire(capture->corr, _packet->stamp);
+}
+
+// decode the mms traffic of a pcap or pcapng file, the flows
+// are stateful so the packets are decoded on the calling thread.
+// _latency prints the latencies of the services
+static int decode_capture(const xmap_t *_file, int _latency) {
+    pcap_reader_t reader;
+    int ret = pcap_reader_open(&reader, xmap_data(_file), xmap_size(_file));
+    if (ret < 0) {
+        return -1;
+    }
+    capture_t *capture = capture_create();
+    if (capture == NULL) {
         return -1;
     }
-    return writ;
+    pcap_packet_t packet;
+    while ((ret = pcap_reader_next(&reader, &packet)) > 0) {
+        capture_packet(capture, &packet);
+    }
+    capture_flush(capture);
+    if (_latency) {
+        capture_report(capture->corr);
+    }
+    capture_destroy(capture);
+    node_pool_trim();
+    return ret < 0 ? -1 : 0;
 }
 
-int main(int argc, char *argv[]) {
-    unsigned char *buffer =
-            (unsigned char *) malloc(1024 * 56);
-    if (buffer == NULL) {
+/*********************************live*********************************/
+
+// set by SIGINT and SIGTERM, the workers finish their block and stop
+static volatile sig_atomic_t g_stop = 0;
+
+static void live_signal(int _signal) {
+    (void) _signal;
+    g_stop = 1;
+}
+
+// a worker polling its ring, the fanout keeps both
+// directions of a connection on the same worker
+typedef struct live_t {
+    ring_t *ring;
+    capture_t *capture;
+    unsigned long long stamp; // latest frame, the clock of the flows
+} live_t;
+
+static void live_packet(void *_live, const pcap_packet_t *_packet) {
+    live_t *live = (live_t *) _live;
+    live->stamp = _packet->stamp;
+    capture_packet(live->capture, _packet);
+}
+
+static void live_main(void *_live) {
+    live_t *live = (live_t *) _live;
+    while (!g_stop) {
+        if (ring_poll(live->ring, RING_TIMEOUT, live_packet, live) < 0) {
+            break;
+        }
+        tcp_table_expire(live->capture->table, live->stamp);
+        fflush(stdout);
+    }
+}
+
+// decode the mms traffic of the interface _iface until interrupted,
+// _jobs rings share a fanout group with a worker each
+static int decode_live(
+        const char *_iface, unsigned int _jobs, int _latency) {
+    live_t *lives = (live_t *) calloc(_jobs, sizeof(live_t));
+    xthread_t **workers = (xthread_t **)
+            calloc(_jobs, sizeof(xthread_t *));
+    if (lives == NULL || workers == NULL) {
+        free(lives);
+        free(workers);
         return -1;
     }
-    FILE *data = fopen("../message.txt", "rb");
-    if (data == NULL) {
-        return -2;
+    ring_option_t option;
+    memset(&option, 0, sizeof(ring_option_t));
+    if (_jobs > 1) {
+        option.fanout = (unsigned int) getpid() & 0xffff;
     }
-    int length;
-    do {
-        length = fscanf(data, " %[^\n]", buffer);
-        if (length > 0 && buffer[0] == '#') {
-            printf("%s\n", (char *) buffer);
-            continue;
+    int ret = 0;
+    unsigned int idx = 0;
+    while (idx < _jobs) {
+        int error = 0;
+        lives[idx].ring = ring_open(_iface, &option, &error);
+        lives[idx].capture = capture_create();
+        if (lives[idx].ring == NULL || lives[idx].capture == NULL) {
+            fprintf(stderr, "cannot capture on %s (%d)\n", _iface, error);
+            ret = -1;
+            break;
         }
-        if (length > 0) {
-            length = (int) strlen((char *) buffer);
-            length = make_msg(buffer, length);
-            service_t *service = mms_parse(buffer, length);
-            length = mms_tostring(
-                    service, (char *) buffer, 10240);
-            if (length > 0) {
-                printf("%s\n", buffer);
+        idx++;
+    }
+    signal(SIGINT, live_signal);
+    signal(SIGTERM, live_signal);
+    unsigned int started = 0;
+    while (ret == 0 && started < _jobs) {
+        workers[started] = xthread_create(live_main, &lives[started]);
+        if (workers[started] == NULL) {
+            g_stop = 1;
+            ret = -1;
+            break;
+        }
+        started++;
+    }
+    idx = 0;
+    while (idx < started) {
+        xthread_join(workers[idx++]);
+    }
+    unsigned int packets = 0;
+    unsigned int drops = 0;
+    idx = 0;
+    while (idx < _jobs) {
+        unsigned int count = 0;
+        unsigned int dropped = 0;
+        if (ring_stats(lives[idx].ring, &count, &dropped) == 0) {
+            packets += count;
+            drops += dropped;
+        }
+        ring_close(lives[idx].ring);
+        idx++;
+    }
+    if (ret == 0) {
+        fprintf(stderr, "%u packets, %u dropped\n", packets, drops);
+        idx = 0;
+        while (idx < _jobs) {
+            capture_flush(lives[idx++].capture);
+        }
+        idx = 1;
+        while (idx < _jobs) {
+            corr_merge(lives[0].capture->corr, lives[idx++].capture->corr);
+        }
+        if (_latency) {
+            capture_report(lives[0].capture->corr);
+        }
+    }
+    idx = 0;
+    while (idx < _jobs) {
+        if (lives[idx].capture != NULL) {
+            capture_destroy(lives[idx].capture);
+        }
+        idx++;
+    }
+    free(lives);
+    free(workers);
+    node_pool_trim();
+    return ret;
+}
+
+// usage: mmsparser [--jobs N] [--latency] [--live IFACE | file]
+// N is the number of decoding threads, 0 for one per processor.
+// --live captures the tcp port 102 traffic of an interface,
+// --latency reports the response times of the captured services
+int main(int argc, char *argv[]) {
+    const char *path = "../message.txt";
+    const char *iface = NULL;
+    unsigned int jobs = 1;
+    int latency = 0;
+    int idx = 1;
+    while (idx < argc) {
+        if (strcmp(argv[idx], "--jobs") == 0 && idx + 1 < argc) {
+            jobs = (unsigned int) strtoul(argv[idx + 1], NULL, 10);
+            if (jobs == 0) {
+                jobs = xthread_cpus();
             }
-            mms_destroy(service);
+            idx += 2;
+            continue;
         }
-    } while (length >= 0);
+        if (strcmp(argv[idx], "--latency") == 0) {
+            latency = 1;
+            idx++;
+            continue;
+        }
+        if (strcmp(argv[idx], "--live") == 0 && idx + 1 < argc) {
+            iface = argv[idx + 1];
+            idx += 2;
+            continue;
+        }
+        path = argv[idx++];
+    }
+    if (iface != NULL) {
+        return decode_live(iface, jobs, latency);
+    }
+    // regular files are mapped, others are read line by line
+    xmap_t *map = xmap_open(path);
+    if (map != NULL) {
+        int ret = 0;
+        if (pcap_probe(xmap_data(map), xmap_size(map))) {
+            ret = decode_capture(map, latency);
+        } else {
+            ret = decode_mapped(map, jobs);
+        }
+        xmap_close(map);
+        return ret;
+    }
+    FILE *data = fopen(path, "rb");
+    if (data == NULL) {
+        return -2;
+    }
+    int ret = 0;
+    if (jobs > 1) {
+        ret = decode_file_jobs(data, jobs);
+    } else {
+        ret = decode_file(data);
+    }
     fclose(data);
-    return 0;
+    return ret;
 }
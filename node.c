@@ -2,13 +2,90 @@
 #include "node.h"
 
 #include <stdlib.h>
+#include <string.h>
+
+#include "xmem.h"
+
+// node types with a pool, every type has a single size
+#define NODE_POOL_TYPES (32)
+// nodes kept by each pool, the rest goes back to the heap
+#define NODE_POOL_DEPTH (1024)
+
+// free list of one node type, linked through node_t.next
+typedef struct node_pool_t {
+    node_t *head;
+    unsigned int count;
+} node_pool_t;
+
+// pools are per thread, so they need no locking
+static X_THREAD_LOCAL node_pool_t g_pools[NODE_POOL_TYPES];
+
+// allocate a zeroed node of _type, recycled from the
+// node pool of the calling thread when possible
+node_t *node_alloc(int _type, size_t _size) {
+    node_t *node = NULL;
+    // pools only hold blocks of the process wide allocator,
+    // arena nodes are released with their arena
+    if (xmem_is_global() &&
+        _type > 0 && _type < NODE_POOL_TYPES) {
+        node_pool_t *pool = g_pools + _type;
+        node = pool->head;
+        if (node != NULL) {
+            pool->head = node->next;
+            pool->count--;
+        }
+    }
+    if (node == NULL) {
+        node = (node_t *) xmem_alloc(_size);
+    }
+    if (node == NULL) {
+        return node;
+    }
+    memset(node, 0, _size);
+    node->type = _type;
+    return node;
+}
+
+// return the node to the pool of the calling thread
+void node_free(node_t *_node) {
+    if (_node == NULL) {
+        return;
+    }
+    int type = _node->type;
+    if (!xmem_is_global() ||
+        type <= 0 || type >= NODE_POOL_TYPES ||
+        g_pools[type].count >= NODE_POOL_DEPTH) {
+        xmem_free(_node);
+        return;
+    }
+    node_pool_t *pool = g_pools + type;
+    _node->next = pool->head;
+    pool->head = _node;
+    pool->count++;
+}
+
+// release the nodes cached by the calling thread
+void node_pool_trim() {
+    const xallocator_t *alloc = xmem_global();
+    int type = 0;
+    while (type < NODE_POOL_TYPES) {
+        node_pool_t *pool = g_pools + type;
+        while (pool->head != NULL) {
+            node_t *node = pool->head;
+            pool->head = node->next;
+            alloc->free(alloc->context, node);
+        }
+        pool->count = 0;
+        type++;
+    }
+}
 
 int node_destroy(node_t *_node) {
     if (_node == NULL) {
         return 0;
     }
     if (_node->op == NULL) {
-        free(_node);
+        xmem_free(_node);
         _node = NULL;
         return 0;
     }
@@ -20,7 +97,7 @@ int node_destroy(node_t *_node) {
 }
 
 int node_tostring(
-        node_t *_node,
+        const node_t *_node,
         char *_dest, size_t _size) {
     if (_node == NULL || _dest == NULL) {
         return 0;
@@ -13,7 +13,7 @@ typedef struct node_t node_t;
 typedef struct node_op_t {
     int (*destroy)(node_t *);
 
-    int (*tostring)(node_t *, char *, size_t);
+    int (*tostring)(const node_t *, char *, size_t);
 } node_op_t;
 
 // abstract node type
@@ -23,10 +23,20 @@ typedef struct node_t {
     const node_op_t *op;
 } node_t;
 
+// allocate a zeroed node of _type, recycled from the
+// node pool of the calling thread when possible
+node_t *node_alloc(int _type, size_t _size);
+
+// return the node to the pool of the calling thread
+void node_free(node_t *_node);
+
+// release the nodes cached by the calling thread
+void node_pool_trim();
+
 int node_destroy(node_t *_node);
 
 int node_tostring(
-        node_t *_node,
+        const node_t *_node,
         char *_dest, size_t _size);
 
 #ifdef __cplusplus
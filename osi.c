@@ -0,0 +1,656 @@
+#include "osi.h"
+
+#include <string.h>
+
+#include "xmem.h"
+#include "xtlv.h"
+
+// tpkt version 3 and the largest tpkt
+#define OSI_TPKT_VERSION (0x03)
+#define OSI_TPKT_HEADER (4)
+#define OSI_TPKT_MAX (65535)
+
+// session pdus
+#define OSI_SPDU_DT (0x01) // data transfer, after give tokens
+#define OSI_SPDU_FN (0x09)
+#define OSI_SPDU_DN (0x0a)
+#define OSI_SPDU_RF (0x0c)
+#define OSI_SPDU_CN (0x0d)
+#define OSI_SPDU_AC (0x0e)
+#define OSI_SPDU_AB (0x19)
+
+// session parameters carrying user data
+#define OSI_SPARAM_UDATA (0xc1)
+#define OSI_SPARAM_XUDATA (0xc2)
+
+/*********************************tpkt*********************************/
+
+int osi_frame(
+        const unsigned char *_data, size_t _length,
+        osi_frame_t *_frame) {
+    if (_data == NULL || _frame == NULL) {
+        return OSI_ERR_NULL;
+    }
+    if (_length < 2) {
+        return 0;
+    }
+    if (_data[0] != OSI_TPKT_VERSION || _data[1] != 0x00) {
+        return OSI_ERR_TPKT;
+    }
+    if (_length < OSI_TPKT_HEADER) {
+        return 0;
+    }
+    size_t size = ((size_t) _data[2] << 8) + _data[3];
+    // length indicator and tpdu code at least
+    if (size < OSI_TPKT_HEADER + 2) {
+        return OSI_ERR_TPKT;
+    }
+    if (_length < size) {
+        return 0;
+    }
+    const unsigned char *tpdu = _data + OSI_TPKT_HEADER;
+    size_t li = tpdu[0];
+    if (li == 0 || li == 0xff || OSI_TPKT_HEADER + 1 + li > size) {
+        return OSI_ERR_COTP;
+    }
+    memset(_frame, 0, sizeof(osi_frame_t));
+    _frame->size = size;
+    _frame->type = tpdu[1] & 0xf0;
+    if (_frame->type == OSI_COTP_DT) {
+        // class 0 and 1: eot, other classes: dst-ref and eot
+        if (li == 2) {
+            _frame->eot = (tpdu[2] & 0x80) != 0;
+        } else if (li >= 4) {
+            _frame->eot = (tpdu[4] & 0x80) != 0;
+        } else {
+            return OSI_ERR_COTP;
+        }
+    }
+    _frame->data = tpdu + 1 + li;
+    _frame->length = size - OSI_TPKT_HEADER - 1 - li;
+    return 1;
+}
+
+size_t osi_sync(const unsigned char *_data, size_t _length) {
+    if (_data == NULL) {
+        return _length;
+    }
+    size_t idx = 0;
+    while (idx + OSI_TPKT_HEADER + 2 <= _length) {
+        const unsigned char *data = _data + idx;
+        size_t size = ((size_t) data[2] << 8) + data[3];
+        if (data[0] == OSI_TPKT_VERSION && data[1] == 0x00 &&
+            size >= OSI_TPKT_HEADER + 3 && data[4] == 0x02 &&
+            (data[5] & 0xf0) == OSI_COTP_DT) {
+            return idx;
+        }
+        idx++;
+    }
+    return _length;
+}
+
+/*********************************session*********************************/
+
+// consume the length of a session pdu or parameter, one byte
+// or 0xff and two bytes. return 0 or OSI_ERR_SESSION
+static int osi_session_length(xtlv_t *_tlv, size_t *_length) {
+    int ret = xtlv_byte(_tlv);
+    if (ret == 0xff) {
+        unsigned int length = 0;
+        if (xtlv_uint(_tlv, 2, &length) < 0) {
+            return OSI_ERR_SESSION;
+        }
+        ret = (int) length;
+    }
+    if (ret < 0 || (size_t) ret > xtlv_left(_tlv)) {
+        return OSI_ERR_SESSION;
+    }
+    (*_length) = (size_t) ret;
+    return 0;
+}
+
+// find the user data parameter of a session pdu,
+// return 1 and fill _udata, 0 without user data or the error
+static int osi_session_udata(xtlv_t *_params, xtlv_t *_udata) {
+    while (xtlv_left(_params) > 0) {
+        int code = xtlv_byte(_params);
+        size_t length = 0;
+        if (osi_session_length(_params, &length) < 0) {
+            return OSI_ERR_SESSION;
+        }
+        if (code == OSI_SPARAM_UDATA || code == OSI_SPARAM_XUDATA) {
+            xtlv_init(_udata, _params->data, length);
+            return 1;
+        }
+        _params->data += length;
+    }
+    return 0;
+}
+
+/*********************************presentation*********************************/
+
+// decode the fully encoded user data of a presentation pdu,
+// a list of one pdv. return 1 or OSI_ERR_PRESENT
+static int osi_present_udata(xtlv_t *_tlv, osi_data_t *_data) {
+    xtlv_t udata;
+    xtlv_t pdv;
+    if (xtlv_enter(_tlv, 0x61, &udata) < 0 ||
+        xtlv_enter(&udata, 0x30, &pdv) < 0) {
+        return OSI_ERR_PRESENT;
+    }
+    // transfer syntax name
+    if (xtlv_peek(&pdv) == 0x06 && xtlv_skip(&pdv) < 0) {
+        return OSI_ERR_PRESENT;
+    }
+    unsigned int length = 0;
+    if (xtlv_expect(&pdv, 0x02, &length) < 0 ||
+        xtlv_uint(&pdv, length, &_data->context) < 0) {
+        return OSI_ERR_PRESENT;
+    }
+    // single asn.1 type or octet aligned
+    xtlv_t value;
+    if (xtlv_enter(&pdv, 0xa0, &value) < 0 &&
+        xtlv_enter(&pdv, 0x81, &value) < 0) {
+        return OSI_ERR_PRESENT;
+    }
+    _data->data = value.data;
+    _data->length = xtlv_left(&value);
+    return 1;
+}
+
+// decode a presentation pdu: user data of the data phase, or the
+// cp and cpa types of the connection. return 1, 0 for other
+// pdus or OSI_ERR_PRESENT
+static int osi_present(xtlv_t *_tlv, osi_data_t *_data) {
+    const unsigned char *ppdu = _tlv->data;
+    size_t left = xtlv_left(_tlv);
+    // fast path: 61 L 30 L 02 01 ctx a0 L, short lengths
+    if (left >= 9 && ppdu[0] == 0x61 && ppdu[2] == 0x30 &&
+        ppdu[4] == 0x02 && ppdu[5] == 0x01 && ppdu[7] == 0xa0 &&
+        ppdu[1] < 0x80 && ppdu[3] < 0x80 && ppdu[8] < 0x80 &&
+        ppdu[8] + 9u <= left) {
+        _data->context = ppdu[6];
+        _data->data = ppdu + 9;
+        _data->length = ppdu[8];
+        return 1;
+    }
+    if (xtlv_peek(_tlv) == 0x61) {
+        return osi_present_udata(_tlv, _data);
+    }
+    xtlv_t set;
+    if (xtlv_enter(_tlv, 0x31, &set) < 0) {
+        return 0;
+    }
+    // normal mode parameters
+    while (xtlv_left(&set) > 0) {
+        xtlv_t normal;
+        if (xtlv_peek(&set) != 0xa2) {
+            if (xtlv_skip(&set) < 0) {
+                return OSI_ERR_PRESENT;
+            }
+            continue;
+        }
+        if (xtlv_enter(&set, 0xa2, &normal) < 0) {
+            return OSI_ERR_PRESENT;
+        }
+        while (xtlv_left(&normal) > 0) {
+            if (xtlv_peek(&normal) == 0x61) {
+                return osi_present_udata(&normal, _data);
+            }
+            if (xtlv_skip(&normal) < 0) {
+                return OSI_ERR_PRESENT;
+            }
+        }
+        return 0;
+    }
+    return 0;
+}
+
+int osi_unwrap(
+        const unsigned char *_tsdu, size_t _length,
+        osi_data_t *_data) {
+    if (_tsdu == NULL || _data == NULL) {
+        return OSI_ERR_NULL;
+    }
+    memset(_data, 0, sizeof(osi_data_t));
+    xtlv_t tlv;
+    xtlv_init(&tlv, _tsdu, _length);
+    xtlv_t udata;
+    if (_length >= 4 && _tsdu[0] == 0x01 && _tsdu[1] == 0x00 &&
+        _tsdu[2] == 0x01 && _tsdu[3] == 0x00) {
+        // fast path: give tokens and data transfer, no parameters
+        _data->spdu = OSI_SPDU_DT;
+        xtlv_init(&udata, _tsdu + 4, _length - 4);
+    } else {
+        int spdu = xtlv_byte(&tlv);
+        size_t length = 0;
+        if (osi_session_length(&tlv, &length) < 0) {
+            return OSI_ERR_SESSION;
+        }
+        xtlv_t params;
+        xtlv_init(&params, tlv.data, length);
+        tlv.data += length;
+        _data->spdu = spdu;
+        if (spdu == OSI_SPDU_DT) {
+            // give tokens, then the data transfer and its user data
+            spdu = xtlv_byte(&tlv);
+            if (spdu != OSI_SPDU_DT ||
+                osi_session_length(&tlv, &length) < 0) {
+                return OSI_ERR_SESSION;
+            }
+            tlv.data += length;
+            udata = tlv;
+        } else if (spdu == OSI_SPDU_CN || spdu == OSI_SPDU_AC ||
+                   spdu == OSI_SPDU_FN || spdu == OSI_SPDU_DN ||
+                   spdu == OSI_SPDU_RF || spdu == OSI_SPDU_AB) {
+            int ret = osi_session_udata(&params, &udata);
+            if (ret <= 0) {
+                return ret;
+            }
+        } else {
+            return 0;
+        }
+    }
+    _data->ppdu = udata.data;
+    _data->ppdu_length = xtlv_left(&udata);
+    int ret = osi_present(&udata, _data);
+    if (ret <= 0) {
+        return ret;
+    }
+    // acse apdus are application 0 to 4, mms pdus context tags
+    _data->kind = OSI_DATA_MMS;
+    if (_data->length > 0 &&
+        _data->data[0] >= 0x60 && _data->data[0] <= 0x64) {
+        _data->kind = OSI_DATA_ACSE;
+    }
+    return 1;
+}
+
+/*********************************acse*********************************/
+
+// decode the contents of a ber integer, at most the size of an int
+static int osi_integer(xtlv_t *_value, int *_result) {
+    size_t length = xtlv_left(_value);
+    if (length == 0 || length > sizeof(int)) {
+        return OSI_ERR_PRESENT;
+    }
+    unsigned int value = (_value->data[0] & 0x80) ? ~0u : 0u;
+    while (xtlv_left(_value) > 0) {
+        value = (value << 8) | (unsigned int) xtlv_byte(_value);
+    }
+    (*_result) = (int) value;
+    return 0;
+}
+
+// decode the explicit tlv at _tlv, an ap title (object identifier,
+// form 2) or an ae qualifier (integer, form 2) into _title.
+// other forms are skipped. return 0 or OSI_ERR_PRESENT
+static int osi_acse_title(
+        xtlv_t *_tlv, int _qualifier,
+        osi_title_t *_title) {
+    xtlv_t outer;
+    xtlv_t value;
+    if (xtlv_contents(_tlv, &outer) < 0) {
+        return OSI_ERR_PRESENT;
+    }
+    int tag = _qualifier ? 0x02 : 0x06;
+    if (xtlv_peek(&outer) != tag) {
+        return 0;
+    }
+    if (xtlv_enter(&outer, tag, &value) < 0) {
+        return OSI_ERR_PRESENT;
+    }
+    if (_qualifier) {
+        _title->qualified = 1;
+        return osi_integer(&value, &_title->qualifier);
+    }
+    _title->oid = value.data;
+    _title->length = xtlv_left(&value);
+    return 0;
+}
+
+// decode the user information of an aarq or aare: an external
+// with the context of the initiate and the single asn.1 type
+static int osi_acse_udata(xtlv_t *_tlv, osi_assoc_t *_assoc) {
+    xtlv_t udata;
+    xtlv_t external;
+    if (xtlv_contents(_tlv, &udata) < 0 ||
+        xtlv_enter(&udata, 0x28, &external) < 0) {
+        return OSI_ERR_PRESENT;
+    }
+    // direct reference, the transfer syntax
+    if (xtlv_peek(&external) == 0x06 && xtlv_skip(&external) < 0) {
+        return OSI_ERR_PRESENT;
+    }
+    unsigned int length = 0;
+    if (xtlv_expect(&external, 0x02, &length) < 0 ||
+        xtlv_uint(&external, length, &_assoc->context) < 0) {
+        return OSI_ERR_PRESENT;
+    }
+    xtlv_t value;
+    if (xtlv_enter(&external, 0xa0, &value) < 0 &&
+        xtlv_enter(&external, 0x81, &value) < 0) {
+        return OSI_ERR_PRESENT;
+    }
+    _assoc->data = value.data;
+    _assoc->length = xtlv_left(&value);
+    return 0;
+}
+
+// decode an aarq or aare apdu, return 1 or OSI_ERR_PRESENT
+static int osi_acse(xtlv_t *_tlv, osi_assoc_t *_assoc) {
+    int acse = xtlv_byte(_tlv);
+    xtlv_t apdu;
+    if (xtlv_contents(_tlv, &apdu) < 0) {
+        return OSI_ERR_PRESENT;
+    }
+    _assoc->acse = acse;
+    while (xtlv_left(&apdu) > 0) {
+        int tag = xtlv_byte(&apdu);
+        int ret = 0;
+        xtlv_t value;
+        // the titles of an aarq, and the responding title of an aare
+        if (acse == OSI_ACSE_AARQ && (tag == 0xa2 || tag == 0xa3)) {
+            ret = osi_acse_title(&apdu, tag & 0x01, &_assoc->called);
+        } else if (acse == OSI_ACSE_AARQ && (tag == 0xa6 || tag == 0xa7)) {
+            ret = osi_acse_title(&apdu, tag & 0x01, &_assoc->calling);
+        } else if (acse == OSI_ACSE_AARE && (tag == 0xa4 || tag == 0xa5)) {
+            ret = osi_acse_title(&apdu, tag & 0x01, &_assoc->calling);
+        } else if (acse == OSI_ACSE_AARE && tag == 0xa2) {
+            xtlv_t result;
+            if (xtlv_contents(&apdu, &result) < 0 ||
+                xtlv_enter(&result, 0x02, &value) < 0) {
+                return OSI_ERR_PRESENT;
+            }
+            ret = osi_integer(&value, &_assoc->result);
+        } else if (tag == 0xbe) {
+            ret = osi_acse_udata(&apdu, _assoc);
+        } else {
+            // protocol version, context name, invocation
+            // identifiers and authentication
+            apdu.data--;
+            ret = xtlv_skip(&apdu);
+        }
+        if (ret < 0) {
+            return OSI_ERR_PRESENT;
+        }
+    }
+    return 1;
+}
+
+// decode one item of the presentation context definition list
+// of a cp, or of the result list of a cpa
+static int osi_assoc_context(
+        xtlv_t *_list, int _cpa,
+        osi_assoc_t *_assoc) {
+    xtlv_t item;
+    if (xtlv_enter(_list, 0x30, &item) < 0) {
+        return OSI_ERR_PRESENT;
+    }
+    osi_context_t context;
+    memset(&context, 0, sizeof(osi_context_t));
+    context.result = -1;
+    xtlv_t value;
+    if (_cpa) {
+        // result, transfer syntax and provider reason
+        if (xtlv_enter(&item, 0x80, &value) < 0 ||
+            osi_integer(&value, &context.result) < 0) {
+            return OSI_ERR_PRESENT;
+        }
+    } else {
+        // identifier, abstract syntax and transfer syntaxes
+        unsigned int length = 0;
+        if (xtlv_expect(&item, 0x02, &length) < 0 ||
+            xtlv_uint(&item, length, &context.id) < 0) {
+            return OSI_ERR_PRESENT;
+        }
+        if (xtlv_peek(&item) == 0x06) {
+            if (xtlv_enter(&item, 0x06, &value) < 0) {
+                return OSI_ERR_PRESENT;
+            }
+            context.syntax = value.data;
+            context.length = xtlv_left(&value);
+        }
+    }
+    if (_assoc->count < OSI_CONTEXT_MAX) {
+        _assoc->contexts[_assoc->count++] = context;
+    } else {
+        _assoc->truncated = 1;
+    }
+    return 0;
+}
+
+int osi_assoc(
+        const unsigned char *_ppdu, size_t _length,
+        osi_assoc_t *_assoc) {
+    if (_ppdu == NULL || _assoc == NULL) {
+        return OSI_ERR_NULL;
+    }
+    memset(_assoc, 0, sizeof(osi_assoc_t));
+    _assoc->result = -1;
+    xtlv_t tlv;
+    xtlv_init(&tlv, _ppdu, _length);
+    xtlv_t set;
+    if (xtlv_peek(&tlv) != 0x31) {
+        return 0;
+    }
+    if (xtlv_enter(&tlv, 0x31, &set) < 0) {
+        return OSI_ERR_PRESENT;
+    }
+    // mode selector, then the normal mode parameters
+    while (xtlv_left(&set) > 0 && xtlv_peek(&set) != 0xa2) {
+        if (xtlv_skip(&set) < 0) {
+            return OSI_ERR_PRESENT;
+        }
+    }
+    xtlv_t normal;
+    if (xtlv_enter(&set, 0xa2, &normal) < 0) {
+        return OSI_ERR_PRESENT;
+    }
+    while (xtlv_left(&normal) > 0) {
+        int tag = xtlv_peek(&normal);
+        if (tag == 0xa4 || tag == 0xa5) {
+            xtlv_t list;
+            if (xtlv_enter(&normal, tag, &list) < 0) {
+                return OSI_ERR_PRESENT;
+            }
+            while (xtlv_left(&list) > 0) {
+                if (osi_assoc_context(&list, tag == 0xa5, _assoc) < 0) {
+                    return OSI_ERR_PRESENT;
+                }
+            }
+            continue;
+        }
+        if (tag != 0x61) {
+            if (xtlv_skip(&normal) < 0) {
+                return OSI_ERR_PRESENT;
+            }
+            continue;
+        }
+        osi_data_t data;
+        memset(&data, 0, sizeof(osi_data_t));
+        if (osi_present_udata(&normal, &data) < 0) {
+            return OSI_ERR_PRESENT;
+        }
+        if (data.length == 0 ||
+            (data.data[0] != OSI_ACSE_AARQ &&
+             data.data[0] != OSI_ACSE_AARE)) {
+            return 0;
+        }
+        xtlv_init(&tlv, data.data, data.length);
+        return osi_acse(&tlv, _assoc);
+    }
+    return 0;
+}
+
+/*********************************osi_stream_t*********************************/
+
+// growing buffer of the pending bytes
+typedef struct osi_buffer_t {
+    unsigned char *data;
+    size_t used;
+    size_t capacity;
+} osi_buffer_t;
+
+typedef struct osi_stream_t {
+    osi_callback_t callback;
+    void *context;
+    size_t limit;
+    osi_buffer_t tpkt; // tpkt split across chunks
+    osi_buffer_t tsdu; // segments of a tsdu
+    int code; // error that stopped the stream
+} osi_stream_t;
+
+static int osi_buffer_append(
+        osi_buffer_t *_buffer,
+        const unsigned char *_data, size_t _length,
+        size_t _limit) {
+    size_t used = _buffer->used + _length;
+    if (used > _limit) {
+        return OSI_ERR_COTP;
+    }
+    if (used > _buffer->capacity) {
+        size_t capacity = _buffer->capacity * 2;
+        if (capacity < used) {
+            capacity = used;
+        }
+        if (capacity > _limit) {
+            capacity = _limit;
+        }
+        unsigned char *data = (unsigned char *) xmem_realloc(
+                _buffer->data, _buffer->capacity, capacity);
+        if (data == NULL) {
+            return OSI_ERR_MEMALLOC;
+        }
+        _buffer->data = data;
+        _buffer->capacity = capacity;
+    }
+    memcpy(_buffer->data + _buffer->used, _data, _length);
+    _buffer->used = used;
+    return 0;
+}
+
+osi_stream_t *osi_stream_create(
+        size_t _limit, osi_callback_t _callback, void *_ctx) {
+    if (_callback == NULL) {
+        return NULL;
+    }
+    osi_stream_t *stream = (osi_stream_t *) xmem_alloc(sizeof(osi_stream_t));
+    if (stream == NULL) {
+        return NULL;
+    }
+    memset(stream, 0, sizeof(osi_stream_t));
+    stream->callback = _callback;
+    stream->context = _ctx;
+    stream->limit = _limit == 0 ? OSI_TSDU_DEFAULT : _limit;
+    return stream;
+}
+
+void osi_stream_destroy(osi_stream_t *_stream) {
+    if (_stream == NULL) {
+        return;
+    }
+    xmem_free(_stream->tpkt.data);
+    xmem_free(_stream->tsdu.data);
+    xmem_free(_stream);
+}
+
+void osi_stream_reset(osi_stream_t *_stream) {
+    if (_stream == NULL) {
+        return;
+    }
+    _stream->tpkt.used = 0;
+    _stream->tsdu.used = 0;
+    _stream->code = 0;
+}
+
+// unwrap a complete tsdu, return 1 when a pdu was handed over
+static int osi_stream_tsdu(
+        const osi_stream_t *_stream,
+        const unsigned char *_tsdu, size_t _length) {
+    osi_data_t data;
+    if (osi_unwrap(_tsdu, _length, &data) <= 0) {
+        return 0;
+    }
+    _stream->callback(_stream->context, &data);
+    return 1;
+}
+
+// take the tpdu of a tpkt, return 1 when a pdu was
+// handed over, 0 or the error
+static int osi_stream_frame(
+        osi_stream_t *_stream, const osi_frame_t *_frame) {
+    if (_frame->type != OSI_COTP_DT) {
+        return 0;
+    }
+    if (_stream->tsdu.used == 0 && _frame->eot) {
+        return osi_stream_tsdu(_stream, _frame->data, _frame->length);
+    }
+    int ret = osi_buffer_append(
+            &_stream->tsdu, _frame->data, _frame->length,
+            _stream->limit);
+    if (ret < 0 || !_frame->eot) {
+        return ret;
+    }
+    ret = osi_stream_tsdu(
+            _stream, _stream->tsdu.data, _stream->tsdu.used);
+    _stream->tsdu.used = 0;
+    return ret;
+}
+
+int osi_stream_feed(
+        osi_stream_t *_stream,
+        const unsigned char *_data, size_t _length) {
+    if (_stream == NULL || (_data == NULL && _length > 0)) {
+        return OSI_ERR_NULL;
+    }
+    if (_stream->code < 0) {
+        return _stream->code;
+    }
+    osi_buffer_t *tpkt = &_stream->tpkt;
+    int count = 0;
+    while (_length > 0) {
+        osi_frame_t frame;
+        int ret = 0;
+        if (tpkt->used == 0) {
+            // tpkts inside the chunk are taken in place
+            ret = osi_frame(_data, _length, &frame);
+            if (ret > 0) {
+                _data += frame.size;
+                _length -= frame.size;
+            }
+        } else {
+            // complete the header, then the rest of the tpkt
+            size_t take = OSI_TPKT_HEADER - tpkt->used;
+            if (tpkt->used >= OSI_TPKT_HEADER) {
+                take = ((size_t) tpkt->data[2] << 8) +
+                       tpkt->data[3] - tpkt->used;
+            }
+            if (take > _length) {
+                take = _length;
+            }
+            ret = osi_buffer_append(
+                    tpkt, _data, take, OSI_TPKT_MAX);
+            _data += take;
+            _length -= take;
+            if (ret == 0) {
+                ret = osi_frame(tpkt->data, tpkt->used, &frame);
+            }
+        }
+        if (ret == 0 && tpkt->used == 0) {
+            ret = osi_buffer_append(
+                    tpkt, _data, _length, OSI_TPKT_MAX);
+            _length = 0;
+        }
+        if (ret > 0) {
+            ret = osi_stream_frame(_stream, &frame);
+            tpkt->used = 0;
+            count += ret > 0;
+        }
+        if (ret < 0) {
+            _stream->code = ret;
+            return ret;
+        }
+    }
+    return count;
+}
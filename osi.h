@@ -0,0 +1,146 @@
+#ifndef MMS_OSI_H
+#define MMS_OSI_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#define OSI_ERR_NULL (-1)
+#define OSI_ERR_TPKT (-2)
+#define OSI_ERR_COTP (-3)
+#define OSI_ERR_SESSION (-4)
+#define OSI_ERR_PRESENT (-5)
+#define OSI_ERR_MEMALLOC (-6)
+
+// cotp tpdu types
+#define OSI_COTP_CR (0xe0)
+#define OSI_COTP_CC (0xd0)
+#define OSI_COTP_DR (0x80)
+#define OSI_COTP_DT (0xf0)
+
+// user data of a presentation pdu
+#define OSI_DATA_MMS (1)
+#define OSI_DATA_ACSE (2)
+
+// largest tsdu a stream reassembles by default
+#define OSI_TSDU_DEFAULT (1048576)
+
+// a tpkt and the cotp tpdu it carries, slices of the stream
+typedef struct osi_frame_t {
+    size_t size; // size of the tpkt
+    int type; // cotp tpdu type
+    int eot; // last data tpdu of a tsdu
+    const unsigned char *data; // user data of a data tpdu
+    size_t length;
+} osi_frame_t;
+
+// decode the tpkt at _data, return 1 and fill _frame when it is
+// complete, 0 while more bytes are needed or the parsing error
+int osi_frame(
+        const unsigned char *_data, size_t _length,
+        osi_frame_t *_frame);
+
+// offset of the first tpkt header carrying a class 0 data tpdu,
+// or _length. resynchronizes a stream after lost bytes
+size_t osi_sync(const unsigned char *_data, size_t _length);
+
+// an mms or acse pdu found in a tsdu, a slice of it
+typedef struct osi_data_t {
+    int spdu; // session pdu carrying the data
+    unsigned int context; // presentation context identifier
+    int kind; // OSI_DATA_*
+    const unsigned char *data;
+    size_t length;
+    // the presentation pdu, osi_assoc decodes it for cp and cpa
+    const unsigned char *ppdu;
+    size_t ppdu_length;
+} osi_data_t;
+
+// strip the session and presentation headers of a tsdu,
+// return 1 and fill _data, 0 when the tsdu carries no
+// user data, or the parsing error
+int osi_unwrap(
+        const unsigned char *_tsdu, size_t _length,
+        osi_data_t *_data);
+
+// acse apdus of an association
+#define OSI_ACSE_AARQ (0x60)
+#define OSI_ACSE_AARE (0x61)
+
+// presentation contexts kept by osi_assoc
+#define OSI_CONTEXT_MAX (8)
+
+// ap title (form 2, an object identifier) and ae qualifier
+typedef struct osi_title_t {
+    const unsigned char *oid; // contents of the identifier, or NULL
+    size_t length;
+    int qualified; // the ae qualifier is present
+    int qualifier;
+} osi_title_t;
+
+// a presentation context of the cp definition list
+// or the cpa result list
+typedef struct osi_context_t {
+    unsigned int id; // 0 in a cpa, which lists results in order
+    const unsigned char *syntax; // abstract syntax, NULL in a cpa
+    size_t length;
+    int result; // -1 in a cp, 0 acceptance in a cpa
+} osi_context_t;
+
+// a presentation cp or cpa pdu and the acse apdu it carries,
+// slices of the pdu
+typedef struct osi_assoc_t {
+    int acse; // OSI_ACSE_AARQ or OSI_ACSE_AARE
+    int result; // result of an aare, -1 in an aarq
+    osi_title_t calling; // calling, or responding in an aare
+    osi_title_t called; // aarq only
+    osi_context_t contexts[OSI_CONTEXT_MAX];
+    size_t count;
+    int truncated; // more contexts were listed than kept
+    // presentation context of the mms initiate,
+    // the indirect reference of the user information
+    unsigned int context;
+    const unsigned char *data; // the mms initiate, or NULL
+    size_t length;
+} osi_assoc_t;
+
+// decode a presentation cp or cpa pdu (osi_data_t.ppdu of a connect
+// or accept), its presentation contexts and the aarq or aare in its
+// user data. return 1 and fill _assoc, 0 for other pdus or the
+// parsing error
+int osi_assoc(
+        const unsigned char *_ppdu, size_t _length,
+        osi_assoc_t *_assoc);
+
+// reassembly of the tsdus of one direction of a connection
+typedef struct osi_stream_t osi_stream_t;
+
+// receives the pdus of a stream, _data is valid during the call
+typedef void (*osi_callback_t)(void *_ctx, const osi_data_t *_data);
+
+// create a stream, _limit bounds a reassembled tsdu,
+// 0 for OSI_TSDU_DEFAULT
+osi_stream_t *osi_stream_create(
+        size_t _limit, osi_callback_t _callback, void *_ctx);
+
+void osi_stream_destroy(osi_stream_t *_stream);
+
+// drop the pending bytes and the error of the stream
+void osi_stream_reset(osi_stream_t *_stream);
+
+// decode the tpkts completed by the next _length bytes. tpkts inside
+// the chunk and unsegmented tsdus are unwrapped in place, a tsdu
+// that does not unwrap is dropped. return the number of pdus handed
+// to the callback or the framing error, which stops the stream
+// until osi_stream_reset
+int osi_stream_feed(
+        osi_stream_t *_stream,
+        const unsigned char *_data, size_t _length);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // !MMS_OSI_H
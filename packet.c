@@ -10,43 +10,34 @@
 #define PKT_ERR_TYPE (-2)
 #define PKT_ERR_FAILED (-3)
 
-typedef struct val2str_t {
-    int value;
-    const char *str;
-} val2str_t;
-
+// names indexed by a tag or a code, NULL where undefined
 static const char *value2str(
-        const val2str_t *_list, int _value) {
-    if (_list == NULL) {
-        return "";
-    }
-    const val2str_t *head = _list;
-    while (head->str) {
-        if (head->value == _value) {
-            break;
-        }
-        head++;
+        const char *const *_table, size_t _count, int _value) {
+    if (_value < 0 || (size_t) _value >= _count) {
+        return NULL;
     }
-    return head->str;
+    return _table[_value];
 }
 
+#define VALUE2STR(table, value) \
+        value2str(table, sizeof(table) / sizeof(table[0]), value)
+
 static const char *data_errstr(int _code) {
-    static val2str_t g_dataerr[] = {
-            {0,  "object-invalidated"},
-            {1,  "hardware-fault"},
-            {2,  "temporarily-unavailable"},
-            {3,  "object-access-denied"},
-            {4,  "object-undefined"},
-            {5,  "invalid-address"},
-            {6,  "type-unsupported"},
-            {7,  "type-inconsistent"},
-            {8,  "object-attribute-inconsistent"},
-            {9,  "object-access-unsupported"},
-            {10, "object-non-existent"},
-            {11, "object-value-invalid"},
-            {0, NULL},
+    static const char *const g_dataerr[] = {
+            [0] = "object-invalidated",
+            [1] = "hardware-fault",
+            [2] = "temporarily-unavailable",
+            [3] = "object-access-denied",
+            [4] = "object-undefined",
+            [5] = "invalid-address",
+            [6] = "type-unsupported",
+            [7] = "type-inconsistent",
+            [8] = "object-attribute-inconsistent",
+            [9] = "object-access-unsupported",
+            [10] = "object-non-existent",
+            [11] = "object-value-invalid",
     };
-    return value2str(g_dataerr, _code);
+    return VALUE2STR(g_dataerr, _code);
 }
 
 /*********************************file_spec_t*********************************/
@@ -65,22 +56,23 @@ static int file_spec_destroy(node_t *_node) {
     }
     file_spec_t *file = (file_spec_t *) _node;
     mmsstr_clear(&file->path);
-    free(_node);
+    node_free(_node);
     return 0;
 }
 
 static int file_spec_tostring(
-        node_t *_node, char *_dest, size_t _size) {
+        const node_t *_node, char *_dest, size_t _size) {
     if (_node == NULL || _dest == NULL || _size == 0) {
         return PKT_ERR_NULL;
     }
     if (_node->type != NODE_TYPE_FILESPEC) {
         return PKT_ERR_TYPE;
     }
-    file_spec_t *file = (file_spec_t *) (_node);
-    const char *fmt = xtrans("pathSpec:{path:%s}");
+    const file_spec_t *file = (const file_spec_t *) _node;
+    const char *fmt = xtrans("pathSpec:{path:%.*s}");
     int ret = snprintf(
             _dest, _size - 1, fmt,
+            (int) file->path.length,
             mmsstr_data(&file->path));
     if (ret < 0) {
         return PKT_ERR_FAILED;
@@ -93,12 +85,10 @@ static node_t *file_spec_create() {
             file_spec_destroy,
             file_spec_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(file_spec_t));
+    node_t *node = node_alloc(NODE_TYPE_FILESPEC, sizeof(file_spec_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(file_spec_t));
-    node->type = NODE_TYPE_FILESPEC;
     node->op = &nodeop;
     return node;
 }
@@ -193,7 +183,7 @@ static int fileattr_stamp(
 }
 
 static int fileattr_tostring(
-        file_attr_t *_attr,
+        const file_attr_t *_attr,
         char *_dest, size_t _size) {
     if (_attr == NULL ||
         _dest == NULL || _size == 0) {
@@ -226,24 +216,25 @@ static int dir_entry_destroy(node_t *_node) {
     }
     dir_entry_t *entry = (dir_entry_t *) _node;
     mmsstr_clear(&entry->name);
-    free(_node);
+    node_free(_node);
     _node = NULL;
     return 0;
 }
 
 static int dir_entry_tostring(
-        node_t *_node, char *_dest, size_t _size) {
+        const node_t *_node, char *_dest, size_t _size) {
     if (_node == NULL || _dest == NULL || _size == 0) {
         return PKT_ERR_NULL;
     }
     if (_node->type != NODE_TYPE_DIRENTRY) {
         return PKT_ERR_TYPE;
     }
-    dir_entry_t *entry = (dir_entry_t *) _node;
-    const char *fmt = xtrans("directoryEntry:{path:%s, ");
+    const dir_entry_t *entry = (const dir_entry_t *) _node;
+    const char *fmt = xtrans("directoryEntry:{path:%.*s, ");
     int idx = 0;
     int ret = snprintf(
             _dest, _size - 1, fmt,
+            (int) entry->name.length,
             mmsstr_data(&entry->name));
     if (ret < 0) {
         return PKT_ERR_FAILED;
@@ -271,12 +262,10 @@ static node_t *dir_entry_create() {
             dir_entry_destroy,
             dir_entry_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(dir_entry_t));
+    node_t *node = node_alloc(NODE_TYPE_DIRENTRY, sizeof(dir_entry_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(dir_entry_t));
-    node->type = NODE_TYPE_DIRENTRY;
     node->op = &nodeop;
     return node;
 }
@@ -338,23 +327,24 @@ static int fopen_req_destroy(node_t *_node) {
     }
     fopen_req_t *req = (fopen_req_t *) _node;
     mmsstr_clear(&req->path);
-    free(_node);
+    node_free(_node);
     _node = NULL;
     return 0;
 }
 
 static int fopen_req_tostring(
-        node_t *_node, char *_dest, size_t _size) {
+        const node_t *_node, char *_dest, size_t _size) {
     if (_node == NULL || _dest == NULL || _size == 0) {
         return PKT_ERR_NULL;
     }
     if (_node->type != NODE_TYPE_FOPENREQ) {
         return PKT_ERR_TYPE;
     }
-    fopen_req_t *req = (fopen_req_t *) _node;
-    const char *fmt = xtrans("fileOpenRequest:{path:%s, position:%u}");
+    const fopen_req_t *req = (const fopen_req_t *) _node;
+    const char *fmt = xtrans("fileOpenRequest:{path:%.*s, position:%u}");
     int ret = snprintf(
             _dest, _size - 1, fmt,
+            (int) req->path.length,
             mmsstr_data(&req->path), req->position);
     if (ret < 0) {
         return PKT_ERR_FAILED;
@@ -367,12 +357,10 @@ static node_t *fopen_req_create() {
             fopen_req_destroy,
             fopen_req_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(fopen_req_t));
+    node_t *node = node_alloc(NODE_TYPE_FOPENREQ, sizeof(fopen_req_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(fopen_req_t));
-    node->type = NODE_TYPE_FOPENREQ;
     node->op = &nodeop;
     return node;
 }
@@ -419,13 +407,13 @@ static int fopen_resp_destroy(node_t *_node) {
     if (_node->type != NODE_TYPE_FOPENRESP) {
         return PKT_ERR_TYPE;
     }
-    free(_node);
+    node_free(_node);
     _node = NULL;
     return 0;
 }
 
 static int fopen_resp_tostring(
-        node_t *_node, char *_dest, size_t _size) {
+        const node_t *_node, char *_dest, size_t _size) {
     if (_node == NULL ||
         _dest == NULL || _size == 0) {
         return PKT_ERR_NULL;
@@ -433,7 +421,7 @@ static int fopen_resp_tostring(
     if (_node->type != NODE_TYPE_FOPENRESP) {
         return PKT_ERR_TYPE;
     }
-    fopen_resp_t *resp = (fopen_resp_t *) _node;
+    const fopen_resp_t *resp = (const fopen_resp_t *) _node;
     const char *fmt = xtrans("fileOpenResponse:{fileHandle:%u, ");
     int idx = 0;
     int ret = snprintf(
@@ -465,12 +453,10 @@ static node_t *fopen_resp_create() {
             fopen_resp_destroy,
             fopen_resp_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(fopen_resp_t));
+    node_t *node = node_alloc(NODE_TYPE_FOPENRESP, sizeof(fopen_resp_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(fopen_resp_t));
-    node->type = NODE_TYPE_FOPENRESP;
     node->op = &nodeop;
     return node;
 }
@@ -516,13 +502,13 @@ static int fread_destroy(node_t *_node) {
     if (_node->type != NODE_TYPE_FREAD) {
         return PKT_ERR_TYPE;
     }
-    free(_node);
+    node_free(_node);
     _node = NULL;
     return 0;
 }
 
 static int fread_tostring(
-        node_t *_node, char *_dest, size_t _size) {
+        const node_t *_node, char *_dest, size_t _size) {
     if (_node == NULL ||
         _dest == NULL || _size == 0) {
         return PKT_ERR_NULL;
@@ -530,7 +516,7 @@ static int fread_tostring(
     if (_node->type != NODE_TYPE_FREAD) {
         return PKT_ERR_TYPE;
     }
-    fread_t *fread1 = (fread_t *) _node;
+    const fread_t *fread1 = (const fread_t *) _node;
     const char *fmt = xtrans("fileReadRequest:{fileHandle:%u}");
     int ret = snprintf(
             _dest, _size - 1,
@@ -543,12 +529,10 @@ static node_t *fread_create() {
             fread_destroy,
             fread_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(fread_t));
+    node_t *node = node_alloc(NODE_TYPE_FREAD, sizeof(fread_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(fread_t));
-    node->type = NODE_TYPE_FREAD;
     node->op = &nodeop;
     return node;
 }
@@ -584,13 +568,13 @@ static int fread_resp_destroy(node_t *_node) {
     if (_node->type != NODE_TYPE_FREADRESP) {
         return PKT_ERR_TYPE;
     }
-    free(_node);
+    node_free(_node);
     _node = NULL;
     return 0;
 }
 
 static int fread_resp_tostring(
-        node_t *_node,
+        const node_t *_node,
         char *_dest, size_t _size) {
     if (_node == NULL || _dest == NULL || _size == 0) {
         return PKT_ERR_NULL;
@@ -598,7 +582,7 @@ static int fread_resp_tostring(
     if (_node->type != NODE_TYPE_FREADRESP) {
         return PKT_ERR_TYPE;
     }
-    fread_resp_t *resp = (fread_resp_t *) _node;
+    const fread_resp_t *resp = (const fread_resp_t *) _node;
     int idx = 0;
     const char *fmt = xtrans("fileReadResponse:{size:%u");
     int ret = snprintf(
@@ -653,12 +637,10 @@ static node_t *fread_resp_create() {
             fread_resp_destroy,
             fread_resp_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(fread_resp_t));
+    node_t *node = node_alloc(NODE_TYPE_FREADRESP, sizeof(fread_resp_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(fread_resp_t));
-    node->type = NODE_TYPE_FREADRESP;
     node->op = &nodeop;
     ((fread_resp_t *) node)->follow = 'T';
     return node;
@@ -732,20 +714,20 @@ static int fclose_destroy(node_t *_node) {
     if (_node->type != NODE_TYPE_FCLOSE) {
         return PKT_ERR_TYPE;
     }
-    free(_node);
+    node_free(_node);
     _node = NULL;
     return 0;
 }
 
 static int fclose_tostring(
-        node_t *_node, char *_dest, size_t _size) {
+        const node_t *_node, char *_dest, size_t _size) {
     if (_node == NULL || _dest == NULL || _size == 0) {
         return PKT_ERR_NULL;
     }
     if (_node->type != NODE_TYPE_FCLOSE) {
         return PKT_ERR_TYPE;
     }
-    fclose_t *fclose1 = (fclose_t *) _node;
+    const fclose_t *fclose1 = (const fclose_t *) _node;
     int ret = 0;
     if (fclose1->b_updwon) {
         const char *fmt = xtrans("fileCloseRequest:{fileHandle:%u}");
@@ -768,12 +750,10 @@ static node_t *fclose_create() {
             fclose_destroy,
             fclose_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(fclose_t));
+    node_t *node = node_alloc(NODE_TYPE_FCLOSE, sizeof(fclose_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(fclose_t));
-    node->type = NODE_TYPE_FCLOSE;
     node->op = &nodeop;
     return node;
 }
@@ -811,13 +791,13 @@ static int var_spec_destroy(node_t *_node) {
     var_spec_t *variable = (var_spec_t *) _node;
     mmsstr_clear(&variable->domain);
     mmsstr_clear(&variable->index);
-    free(_node);
+    node_free(_node);
     _node = NULL;
     return 0;
 }
 
 static int var_spec_tostring(
-        node_t *_node, char *_dest, size_t _size) {
+        const node_t *_node, char *_dest, size_t _size) {
     if (_node == NULL ||
         _dest == NULL || _size == 0) {
         return PKT_ERR_NULL;
@@ -825,11 +805,13 @@ static int var_spec_tostring(
     if (_node->type != NODE_TYPE_VARSPEC) {
         return PKT_ERR_TYPE;
     }
-    var_spec_t *varspec = (var_spec_t *) _node;
-    const char *fmt = "varSpec:{%s/%s}";
+    const var_spec_t *varspec = (const var_spec_t *) _node;
+    const char *fmt = "varSpec:{%.*s/%.*s}";
     int ret = snprintf(
             _dest, _size - 1, fmt,
+            (int) varspec->domain.length,
             mmsstr_data(&varspec->domain),
+            (int) varspec->index.length,
             mmsstr_data(&varspec->index));
     if (ret < 0) {
         return PKT_ERR_FAILED;
@@ -842,12 +824,10 @@ static node_t *var_spec_create() {
             var_spec_destroy,
             var_spec_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(var_spec_t));
+    node_t *node = node_alloc(NODE_TYPE_VARSPEC, sizeof(var_spec_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(var_spec_t));
-    node->type = NODE_TYPE_VARSPEC;
     node->op = &nodeop;
     return node;
 }
@@ -898,13 +878,13 @@ static int udata_destroy(node_t *_node) {
     }
     udata_t *result = (udata_t *) _node;
     xvalue_clear(&result->value);
-    free(_node);
+    node_free(_node);
     _node = NULL;
     return 0;
 }
 
 static int udata_tostring(
-        node_t *_node,
+        const node_t *_node,
         char *_dest, size_t _size) {
     if (_node == NULL ||
         _dest == NULL || _size == 0) {
@@ -913,7 +893,7 @@ static int udata_tostring(
     if (_node->type != NODE_TYPE_UDATA) {
         return PKT_ERR_TYPE;
     }
-    udata_t *data = (udata_t *) _node;
+    const udata_t *data = (const udata_t *) _node;
     int ret = xvalue_to_string(&data->value, _dest, _size);
     if (ret < 0) {
         return PKT_ERR_FAILED;
@@ -926,12 +906,10 @@ static node_t *udata_create() {
             udata_destroy,
             udata_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(udata_t));
+    node_t *node = node_alloc(NODE_TYPE_UDATA, sizeof(udata_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(udata_t));
-    node->type = NODE_TYPE_UDATA;
     node->op = &nodeop;
     return node;
 }
@@ -951,6 +929,17 @@ const xvalue_t *udata_value(node_t *_node, const xvalue_t *_value) {
     return &result->value;
 }
 
+xlist_t *udata_struct(node_t *_node) {
+    if (_node == NULL) {
+        return NULL;
+    }
+    if (_node->type != NODE_TYPE_UDATA) {
+        return NULL;
+    }
+    udata_t *result = (udata_t *) _node;
+    return xvalue_struct(&result->value);
+}
+
 /*********************************name_req_t*********************************/
 
 typedef struct name_req_t {
@@ -970,19 +959,18 @@ static int name_req_destroy(node_t *_node) {
     name_req_t *namereq = (name_req_t *) _node;
     mmsstr_clear(&namereq->domain);
     mmsstr_clear(&namereq->next);
-    free(_node);
+    node_free(_node);
     _node = NULL;
     return 0;
 }
 
 static int name_req_tostring(
-        node_t *_node, char *_dest, size_t _size) {
-    static const val2str_t g_nr_type[] = {
-            {0x00, "variable"},
-            {0x02, "varList"},
-            {0x08, "journal"},
-            {0x09, "domain"},
-            {0, NULL},
+        const node_t *_node, char *_dest, size_t _size) {
+    static const char *const g_nr_type[] = {
+            [0x00] = "variable",
+            [0x02] = "varList",
+            [0x08] = "journal",
+            [0x09] = "domain",
     };
     if (_node == NULL ||
         _dest == NULL || _size == 0) {
@@ -991,21 +979,23 @@ static int name_req_tostring(
     if (_node->type != NODE_TYPE_NAMEREQ) {
         return PKT_ERR_TYPE;
     }
-    name_req_t *nreq = (name_req_t *) _node;
-    const char *type = value2str(g_nr_type, nreq->type);
+    const name_req_t *nreq = (const name_req_t *) _node;
+    const char *type = VALUE2STR(g_nr_type, nreq->type);
     if (type == NULL) {
         return PKT_ERR_FAILED;
     }
     type = xtrans(type);
+    const char *domain = mmsstr_data(&nreq->domain);
+    int domain_len = (int) nreq->domain.length;
     if (nreq->type == 0x09) {
-        const char *data = xtrans("vmdSpecific");
-        mmsstr_set_data(&nreq->domain, data, strlen(data));
+        domain = xtrans("vmdSpecific");
+        domain_len = (int) strlen(domain);
     }
-    const char *fmt = xtrans("nameRequest:{type:%s, domain:%s");
+    const char *fmt = xtrans("nameRequest:{type:%s, domain:%.*s");
     int idx = 0;
     int ret = snprintf(
             _dest + idx, _size - 1 - idx,
-            fmt, type, mmsstr_data(&nreq->domain));
+            fmt, type, domain_len, domain);
     if (ret < 0) {
         return PKT_ERR_FAILED;
     }
@@ -1019,10 +1009,11 @@ static int name_req_tostring(
         _dest[idx] = 0;
         return idx;
     }
-    fmt = xtrans(", continueAfter:%s}");
+    fmt = xtrans(", continueAfter:%.*s}");
     ret = snprintf(
             _dest + idx, _size - 1 - idx,
-            fmt, mmsstr_data(&nreq->next));
+            fmt, (int) nreq->next.length,
+            mmsstr_data(&nreq->next));
     if (ret < 0) {
         return PKT_ERR_FAILED;
     }
@@ -1039,12 +1030,10 @@ static node_t *name_req_create() {
             name_req_destroy,
             name_req_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(name_req_t));
+    node_t *node = node_alloc(NODE_TYPE_NAMEREQ, sizeof(name_req_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(name_req_t));
-    node->type = NODE_TYPE_NAMEREQ;
     node->op = &nodeop;
     return node;
 }
@@ -1107,13 +1096,13 @@ static int idstr_destroy(node_t *_node) {
     }
     idstr_t *idstr = (idstr_t *) _node;
     mmsstr_clear(&idstr->name);
-    free(_node);
+    node_free(_node);
     _node = NULL;
     return 0;
 }
 
 static int idstr_tostring(
-        node_t *_node,
+        const node_t *_node,
         char *_dest, size_t _size) {
     if (_node == NULL ||
         _dest == NULL || _size == 0) {
@@ -1122,10 +1111,11 @@ static int idstr_tostring(
     if (_node->type != NODE_TYPE_IDSTR) {
         return PKT_ERR_TYPE;
     }
-    idstr_t *idstr = (idstr_t *) _node;
-    const char *fmt = xtrans("id_string:{%s}");
+    const idstr_t *idstr = (const idstr_t *) _node;
+    const char *fmt = xtrans("id_string:{%.*s}");
     int ret = snprintf(
             _dest, _size - 1, fmt,
+            (int) idstr->name.length,
             mmsstr_data(&idstr->name));
     if (ret < 0) {
         return PKT_ERR_FAILED;
@@ -1138,12 +1128,10 @@ static node_t *idstr_create() {
             idstr_destroy,
             idstr_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(idstr_t));
+    node_t *node = node_alloc(NODE_TYPE_IDSTR, sizeof(idstr_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(idstr_t));
-    node->type = NODE_TYPE_IDSTR;
     node->op = &nodeop;
     return node;
 }
@@ -1175,21 +1163,21 @@ static int writ_resp_destroy(node_t *_node) {
     if (_node == NULL) {
         return 0;
     }
-    if (_node->type == NODE_TYPE_WRITRESP) {
+    if (_node->type != NODE_TYPE_WRITRESP) {
         return PKT_ERR_TYPE;
     }
-    free(_node);
+    node_free(_node);
     _node = NULL;
     return 0;
 }
 
 static int writ_resp_tostring(
-        node_t *_node,
+        const node_t *_node,
         char *_dest, size_t _size) {
     if (_node == NULL || _dest == NULL || _size == 0) {
         return PKT_ERR_NULL;
     }
-    writ_resp_t *resp = (writ_resp_t *) _node;
+    const writ_resp_t *resp = (const writ_resp_t *) _node;
     if (resp->is_okay) {
         int ret = snprintf(
                 _dest, _size - 1,
@@ -1219,12 +1207,10 @@ static node_t *writ_resp_create() {
             writ_resp_destroy,
             writ_resp_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(writ_resp_t));
+    node_t *node = node_alloc(NODE_TYPE_WRITRESP, sizeof(writ_resp_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(writ_resp_t));
-    node->type = NODE_TYPE_WRITRESP;
     node->op = &nodeop;
     return node;
 }
@@ -1268,11 +1254,12 @@ static int write_req_destroy(node_t *_node) {
     mmsstr_clear(&req->parent.domain);
     mmsstr_clear(&req->parent.index);
     xvalue_clear(&req->value);
+    node_free(_node);
     return 0;
 }
 
 static int writ_req_tostring(
-        node_t *_node,
+        const node_t *_node,
         char *_dest, size_t _size) {
     if (_node == NULL ||
         _dest == NULL || _size == 0) {
@@ -1281,12 +1268,14 @@ static int writ_req_tostring(
     if (_node->type != NODE_TYPE_WRITREQ) {
         return PKT_ERR_TYPE;
     }
-    writ_req_t *req = (writ_req_t *) _node;
+    const writ_req_t *req = (const writ_req_t *) _node;
     int idx = 0;
     int ret = snprintf(
             _dest + idx, _size - 1 - idx,
-            "writeValue:{%s/%s:",
+            "writeValue:{%.*s/%.*s:",
+            (int) req->parent.domain.length,
             mmsstr_data(&req->parent.domain),
+            (int) req->parent.index.length,
             mmsstr_data(&req->parent.index));
     if (ret < 0) {
         _dest[0] = 0;
@@ -1317,12 +1306,10 @@ static node_t *writ_req_create() {
             write_req_destroy,
             writ_req_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(writ_req_t));
+    node_t *node = node_alloc(NODE_TYPE_WRITREQ, sizeof(writ_req_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(writ_req_t));
-    node->type = NODE_TYPE_WRITREQ;
     node->op = &nodeop;
     return node;
 }
@@ -1537,6 +1524,28 @@ static int init_param_cbb_tostring(
     return idx;
 }
 
+// longest object identifier kept by an initiate node
+#define INIT_OID_MAX (32)
+// presentation contexts kept by an initiate node,
+// as many as osi_assoc decodes
+#define INIT_CONTEXT_MAX (8)
+
+// ap title and ae qualifier of an association
+typedef struct init_title_t {
+    unsigned char length; // 0 without a title
+    unsigned char oid[INIT_OID_MAX];
+    int qualified;
+    int qualifier;
+} init_title_t;
+
+// a presentation context of an association
+typedef struct init_context_t {
+    unsigned int id;
+    int result;
+    unsigned char length;
+    unsigned char syntax[INIT_OID_MAX];
+} init_context_t;
+
 typedef struct init_t {
     node_t parent;
     // local detail calling
@@ -1557,6 +1566,16 @@ typedef struct init_t {
     // service supported calling
     unsigned char padding2;
     unsigned char callings[11];
+    // acse apdu carrying the initiate, 0 for a bare pdu
+    int acse;
+    // result of an aare
+    int result;
+    // calling (or responding) and called entities
+    init_title_t titles[2];
+    unsigned int count;
+    init_context_t contexts[INIT_CONTEXT_MAX];
+    // titles or contexts were dropped
+    int truncated;
 } init_t;
 
 static int init_destroy(node_t *_node) {
@@ -1566,13 +1585,13 @@ static int init_destroy(node_t *_node) {
     if (_node->type != NODE_TYPE_INIT) {
         return PKT_ERR_TYPE;
     }
-    free(_node);
+    node_free(_node);
     _node = NULL;
     return 0;
 }
 
 static int init_detail_tostring(
-        init_t *_init,
+        const init_t *_init,
         char *_dest, size_t _size) {
     if (_init == NULL ||
         _dest == NULL || _size == 0) {
@@ -1627,8 +1646,170 @@ static int init_detail_tostring(
     return idx;
 }
 
+// dotted form of the contents of an object identifier
+static int init_oid_tostring(
+        const unsigned char *_oid, unsigned int _length,
+        char *_dest, size_t _size) {
+    int idx = 0;
+    unsigned int arc = 0;
+    unsigned int pos = 0;
+    _dest[0] = 0;
+    while (pos < _length) {
+        arc = (arc << 7) | (_oid[pos] & 0x7f);
+        if (_oid[pos++] & 0x80) {
+            continue;
+        }
+        int ret = 0;
+        if (idx == 0) {
+            // the first subidentifier holds two arcs
+            unsigned int first = arc < 80 ? arc / 40 : 2;
+            ret = snprintf(
+                    _dest, _size - 1, "%u.%u",
+                    first, arc - first * 40);
+        } else {
+            ret = snprintf(
+                    _dest + idx, _size - idx - 1, ".%u", arc);
+        }
+        if (ret < 0) {
+            return PKT_ERR_TYPE;
+        }
+        idx += ret;
+        if (idx >= (_size - 1)) {
+            idx = (int) _size - 1;
+            return idx;
+        }
+        arc = 0;
+    }
+    return idx;
+}
+
+static int init_title_tostring(
+        const char *_name, const init_title_t *_title,
+        char *_dest, size_t _size) {
+    char oid[64];
+    init_oid_tostring(_title->oid, _title->length, oid, sizeof(oid));
+    int ret = 0;
+    if (_title->qualified) {
+        ret = snprintf(
+                _dest, _size - 1,
+                ",\n%s:{apTitle:%s,aeQualifier:%d}",
+                _name, oid, _title->qualifier);
+    } else {
+        ret = snprintf(
+                _dest, _size - 1,
+                ",\n%s:{apTitle:%s}", _name, oid);
+    }
+    if (ret < 0) {
+        return PKT_ERR_TYPE;
+    }
+    if (ret >= (_size - 1)) {
+        ret = (int) _size - 1;
+    }
+    return ret;
+}
+
+// the acse apdu, the titles and presentation contexts
+// of the association carrying the initiate
+static int init_assoc_tostring(
+        const init_t *_init,
+        char *_dest, size_t _size) {
+    int aarq = _init->acse == 0x60;
+    int idx = 0;
+    int ret = 0;
+    if (aarq) {
+        ret = snprintf(
+                _dest, _size - 1,
+                ",\nassociation:{\nacse:AARQ");
+    } else {
+        ret = snprintf(
+                _dest, _size - 1,
+                ",\nassociation:{\nacse:AARE,\nresult:%d",
+                _init->result);
+    }
+    if (ret < 0) {
+        return PKT_ERR_TYPE;
+    }
+    idx += ret;
+    if (idx >= (_size - 1)) {
+        idx = (int) _size - 1;
+        return idx;
+    }
+    static const char *g_title[2][2] = {
+            {"responding", NULL},
+            {"calling",    "called"},
+    };
+    int side = 0;
+    while (side < 2) {
+        const init_title_t *title = _init->titles + side;
+        const char *name = g_title[aarq][side];
+        side++;
+        if ((title->length == 0 && !title->qualified) || name == NULL) {
+            continue;
+        }
+        ret = init_title_tostring(
+                name, title, _dest + idx, _size - idx);
+        if (ret < 0) {
+            return ret;
+        }
+        idx += ret;
+        if (idx >= (_size - 1)) {
+            idx = (int) _size - 1;
+            return idx;
+        }
+    }
+    ret = snprintf(_dest + idx, _size - idx - 1, ",\ncontexts:[");
+    if (ret < 0) {
+        return PKT_ERR_TYPE;
+    }
+    idx += ret;
+    if (idx >= (_size - 1)) {
+        idx = (int) _size - 1;
+        return idx;
+    }
+    unsigned int ctx = 0;
+    while (ctx < _init->count) {
+        const init_context_t *context = _init->contexts + ctx;
+        // definitions of a cp carry no result
+        if (context->result < 0) {
+            char oid[64];
+            init_oid_tostring(
+                    context->syntax, context->length,
+                    oid, sizeof(oid));
+            ret = snprintf(
+                    _dest + idx, _size - idx - 1,
+                    "%s{id:%u,syntax:%s}",
+                    ctx == 0 ? "" : ",", context->id, oid);
+        } else {
+            ret = snprintf(
+                    _dest + idx, _size - idx - 1,
+                    "%s{result:%d}",
+                    ctx == 0 ? "" : ",", context->result);
+        }
+        if (ret < 0) {
+            return PKT_ERR_TYPE;
+        }
+        idx += ret;
+        if (idx >= (_size - 1)) {
+            idx = (int) _size - 1;
+            return idx;
+        }
+        ctx++;
+    }
+    ret = snprintf(
+            _dest + idx, _size - idx - 1,
+            _init->truncated ? "],\ntruncated:true\n}" : "]\n}");
+    if (ret < 0) {
+        return PKT_ERR_TYPE;
+    }
+    idx += ret;
+    if (idx >= (_size - 1)) {
+        idx = (int) _size - 1;
+    }
+    return idx;
+}
+
 static int init_tostring(
-        node_t *_node,
+        const node_t *_node,
         char *_dest, size_t _size) {
     if (_node == NULL ||
         _dest == NULL || _size == 0) {
@@ -1637,7 +1818,7 @@ static int init_tostring(
     if (_node->type != NODE_TYPE_INIT) {
         return PKT_ERR_TYPE;
     }
-    init_t *init = (init_t *) _node;
+    const init_t *init = (const init_t *) _node;
     int idx = 0;
     int ret = snprintf(
             _dest + idx, _size - idx - 1,
@@ -1695,6 +1876,18 @@ static int init_tostring(
         idx = (int) _size - 1;
         return idx;
     }
+    if (init->acse != 0) {
+        ret = init_assoc_tostring(
+                init, _dest + idx, _size - idx);
+        if (ret < 0) {
+            return ret;
+        }
+        idx += ret;
+        if (idx >= (_size - 1)) {
+            idx = (int) _size - 1;
+            return idx;
+        }
+    }
     _dest[idx++] = '\n';
     _dest[idx] = 0;
     if (idx >= (_size - 1)) {
@@ -1711,12 +1904,10 @@ static node_t *init_create() {
             init_destroy,
             init_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(init_t));
+    node_t *node = node_alloc(NODE_TYPE_INIT, sizeof(init_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(init_t));
-    node->type = NODE_TYPE_INIT;
     node->op = &nodeop;
     return node;
 }
@@ -1777,6 +1968,17 @@ int init_struct_nest(
     return 0;
 }
 
+int init_get_nest(const node_t *_node) {
+    if (_node == NULL) {
+        return PKT_ERR_NULL;
+    }
+    if (_node->type != NODE_TYPE_INIT) {
+        return PKT_ERR_TYPE;
+    }
+    const init_t *init = (const init_t *) _node;
+    return init->nest_level;
+}
+
 int init_version(
         node_t *_node,
         unsigned int _version) {
@@ -1823,6 +2025,81 @@ int init_services(
     return 0;
 }
 
+int init_assoc(
+        node_t *_node,
+        int _acse, int _result) {
+    if (_node == NULL) {
+        return PKT_ERR_NULL;
+    }
+    if (_node->type != NODE_TYPE_INIT) {
+        return PKT_ERR_TYPE;
+    }
+    init_t *init = (init_t *) _node;
+    init->acse = _acse;
+    init->result = _result;
+    return 0;
+}
+
+int init_ap_title(
+        node_t *_node, int _called,
+        const unsigned char *_oid, unsigned int _length,
+        const int *_qualifier) {
+    if (_node == NULL) {
+        return PKT_ERR_NULL;
+    }
+    if (_node->type != NODE_TYPE_INIT) {
+        return PKT_ERR_TYPE;
+    }
+    if (_length > INIT_OID_MAX || (_oid == NULL && _length > 0)) {
+        return PKT_ERR_FAILED;
+    }
+    init_t *init = (init_t *) _node;
+    init_title_t *title = init->titles + (_called ? 1 : 0);
+    title->length = (unsigned char) _length;
+    if (_length > 0) {
+        memcpy(title->oid, _oid, _length);
+    }
+    title->qualified = _qualifier != NULL;
+    title->qualifier = _qualifier ? (*_qualifier) : 0;
+    return 0;
+}
+
+int init_context(
+        node_t *_node, unsigned int _id,
+        const unsigned char *_syntax, unsigned int _length,
+        int _result) {
+    if (_node == NULL) {
+        return PKT_ERR_NULL;
+    }
+    if (_node->type != NODE_TYPE_INIT) {
+        return PKT_ERR_TYPE;
+    }
+    init_t *init = (init_t *) _node;
+    if (init->count >= INIT_CONTEXT_MAX ||
+        _length > INIT_OID_MAX || (_syntax == NULL && _length > 0)) {
+        return PKT_ERR_FAILED;
+    }
+    init_context_t *context = init->contexts + init->count++;
+    context->id = _id;
+    context->result = _result;
+    context->length = (unsigned char) _length;
+    if (_length > 0) {
+        memcpy(context->syntax, _syntax, _length);
+    }
+    return 0;
+}
+
+int init_truncated(node_t *_node) {
+    if (_node == NULL) {
+        return PKT_ERR_NULL;
+    }
+    if (_node->type != NODE_TYPE_INIT) {
+        return PKT_ERR_TYPE;
+    }
+    ((init_t *) _node)->truncated = 1;
+    return 0;
+}
+
 /*********************************type_spec_t*********************************/
 
 typedef struct type_spec_t {
@@ -1842,24 +2119,23 @@ static int type_destroy(node_t *_node) {
     type_spec_t *type = (type_spec_t *) _node;
     mmsstr_clear(&type->name);
     xvalue_clear(&type->type);
-    free(_node);
+    node_free(_node);
     _node = NULL;
     return 0;
 }
 
 static int type_tostring(
-        node_t *_node,
+        const node_t *_node,
         char *_dest, size_t _size) {
-    static const val2str_t val2type[] = {
-            {0x85, "integer"},
-            {0x86, "unsigned integer"},
-            {0x84, "bit-string"},
-            {0x90, "unicode"},
-            {0x8a, "string"},
-            {0x83, "boolean"},
-            {0x91, "UTC-time"},
-            {0xa7, "float"},
-            {0, NULL},
+    static const char *const val2type[256] = {
+            [0x83] = "boolean",
+            [0x84] = "bit-string",
+            [0x85] = "integer",
+            [0x86] = "unsigned integer",
+            [0x8a] = "string",
+            [0x90] = "unicode",
+            [0x91] = "UTC-time",
+            [0xa7] = "float",
     };
     if (_node == NULL ||
         _dest == NULL || _size == 0) {
@@ -1868,19 +2144,21 @@ static int type_tostring(
     if (_node->type != NODE_TYPE_TYPE) {
         return PKT_ERR_TYPE;
     }
-    type_spec_t *type = (type_spec_t *) _node;
+    const type_spec_t *type = (const type_spec_t *) _node;
     int idx = 0;
     int ret = snprintf(
             _dest + idx, _size - 1 - idx,
-            "Attribute:{name:%s",
+            "Attribute:{name:%.*s",
+            (int) type->name.length,
             mmsstr_data(&type->name));
     if (ret < 0) {
         return PKT_ERR_FAILED;
     }
     idx += ret;
     if (type->code == 0xa2) {
-        xlist_t *list = type->type.value._struct;
-        node_t *node = xlist_begin(list);
+        xlist_iter_t iter;
+        xlist_iter_init(&iter, type->type.value._struct);
+        const node_t *node = xlist_iter_next(&iter);
         while (node && idx < (_size - 1)) {
             _dest[idx++] = ',';
             ret = node_tostring(
@@ -1889,10 +2167,10 @@ static int type_tostring(
                 break;
             }
             idx += ret;
-            node = xlist_next(list);
+            node = xlist_iter_next(&iter);
         }
     } else {
-        const char *type_str = value2str(
+        const char *type_str = VALUE2STR(
                 val2type, type->code);
         if (type_str == NULL) {
             return PKT_ERR_FAILED;
@@ -1911,11 +2189,11 @@ static int type_tostring(
         if (type->code == 0x85 || type->code == 0x86 ||
             type->code == 0x84 || type->code == 0x90 ||
             type->code == 0x8a) {
-            unsigned int max_len =
-                    type->type.value._uint;
+            // negative for a variable length
+            int max_len = type->type.value._int;
             ret = snprintf(
                     _dest + idx, _size - idx - 1,
-                    ", length:%u", max_len);
+                    ", length:%d", max_len);
             if (ret < 0) {
                 return PKT_ERR_FAILED;
             }
@@ -1936,12 +2214,10 @@ static node_t *type_create() {
             type_destroy,
             type_tostring,
     };
-    node_t *node = (node_t *) malloc(sizeof(type_spec_t));
+    node_t *node = node_alloc(NODE_TYPE_TYPE, sizeof(type_spec_t));
     if (node == NULL) {
         return node;
     }
-    memset(node, 0, sizeof(type_spec_t));
-    node->type = NODE_TYPE_TYPE;
     node->op = &nodeop;
     return node;
 }
@@ -1999,40 +2275,31 @@ xlist_t *type_get_constraint(
 
 /*********************************node*********************************/
 
-typedef struct node_creat_t {
-    int type;
-
-    node_t *(*create)();
-} node_creat_t;
+typedef node_t *(*node_creat_t)();
 
 node_t *node_create(int _type) {
+    // indexed by the node type
     static const node_creat_t g_node_creat[] = {
-            {NODE_TYPE_FILESPEC,  file_spec_create},
-            {NODE_TYPE_DIRENTRY,  dir_entry_create},
-            {NODE_TYPE_VARSPEC,   var_spec_create},
-            {NODE_TYPE_UDATA,     udata_create},
-            {NODE_TYPE_NAMEREQ,   name_req_create},
-            {NODE_TYPE_IDSTR,     idstr_create},
-            {NODE_TYPE_WRITRESP,  writ_resp_create},
-            {NODE_TYPE_WRITREQ,   writ_req_create},
-            {NODE_TYPE_FOPENREQ,  fopen_req_create},
-            {NODE_TYPE_FOPENRESP, fopen_resp_create},
-            {NODE_TYPE_FREAD,     fread_create},
-            {NODE_TYPE_FCLOSE,    fclose_create},
-            {NODE_TYPE_FREADRESP, fread_resp_create},
-            {NODE_TYPE_INIT,      init_create},
-            {NODE_TYPE_TYPE,      type_create},
-            {0, NULL},
+            [NODE_TYPE_FILESPEC] = file_spec_create,
+            [NODE_TYPE_DIRENTRY] = dir_entry_create,
+            [NODE_TYPE_VARSPEC] = var_spec_create,
+            [NODE_TYPE_UDATA] = udata_create,
+            [NODE_TYPE_NAMEREQ] = name_req_create,
+            [NODE_TYPE_IDSTR] = idstr_create,
+            [NODE_TYPE_WRITRESP] = writ_resp_create,
+            [NODE_TYPE_WRITREQ] = writ_req_create,
+            [NODE_TYPE_FOPENREQ] = fopen_req_create,
+            [NODE_TYPE_FOPENRESP] = fopen_resp_create,
+            [NODE_TYPE_FREAD] = fread_create,
+            [NODE_TYPE_FCLOSE] = fclose_create,
+            [NODE_TYPE_FREADRESP] = fread_resp_create,
+            [NODE_TYPE_INIT] = init_create,
+            [NODE_TYPE_TYPE] = type_create,
     };
-    const node_creat_t *constructor = g_node_creat;
-    while (constructor->create) {
-        if (constructor->type == _type) {
-            break;
-        }
-        constructor++;
-    }
-    if (constructor->create == NULL) {
+    size_t count = sizeof(g_node_creat) / sizeof(g_node_creat[0]);
+    if (_type < 0 || (size_t) _type >= count ||
+        g_node_creat[_type] == NULL) {
         return NULL;
     }
-    return constructor->create();
+    return g_node_creat[_type]();
 }
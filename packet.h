@@ -37,7 +37,7 @@ node_t *node_create(int _type);
 extern int node_destroy(node_t *_node);
 
 extern int node_tostring(
-        node_t *_node, char *_dest,
+        const node_t *_node, char *_dest,
         size_t _size);
 
 /*********************************file_spec_t*********************************/
@@ -111,6 +111,9 @@ int var_spec_index(
 const xvalue_t *udata_value(
         node_t *_node, const xvalue_t *_value);
 
+// members of a structure value, a lazy one is decoded first
+xlist_t *udata_struct(node_t *_node);
+
 /*********************************name_req_t*********************************/
 
 int name_req_type(node_t *_node, int _type);
@@ -159,6 +162,8 @@ int init_struct_nest(
         node_t *_node,
         unsigned int _nest);
 
+int init_get_nest(const node_t *_node);
+
 int init_version(
         node_t *_node,
         unsigned int _version);
@@ -171,6 +176,32 @@ int init_services(
         node_t *_node,
         const unsigned char *_data);
 
+// association carrying the initiate: the acse apdu
+// (0x60 aarq, 0x61 aare) and the result of an aare
+int init_assoc(
+        node_t *_node,
+        int _acse, int _result);
+
+// ap title (contents of the object identifier) and ae qualifier,
+// NULL when absent, of the called entity or, when _called is 0,
+// of the calling or responding one
+int init_ap_title(
+        node_t *_node, int _called,
+        const unsigned char *_oid, unsigned int _length,
+        const int *_qualifier);
+
+// append a presentation context: identifier and abstract syntax
+// of a cp, result of a cpa (_syntax NULL). init_ap_title and
+// init_context fail on identifiers longer than 32 bytes and
+// init_context past 8 contexts
+int init_context(
+        node_t *_node, unsigned int _id,
+        const unsigned char *_syntax, unsigned int _length,
+        int _result);
+
+// mark that titles or contexts of the association were dropped
+int init_truncated(node_t *_node);
+
 int type_name(
         node_t *_node, const char *_name,
         unsigned int _length);
@@ -1,6 +1,10 @@
 
 #include "parser.h"
 #include "localizer.h"
+#include "node.h"
+#include "osi.h"
+#include "xmem.h"
+#include "xtlv.h"
 #include <stdlib.h>
 #include <string.h>
 #include <stdio.h>
@@ -21,6 +25,7 @@
 // #define MMS_MSG_INVALID (0x00)
 #define MMS_MSG_REQUEST (0xa0)
 #define MMS_MSG_RESPONSE (0xa1)
+#define MMS_MSG_ERROR (0xa2)
 #define MMS_MSG_REPORT (0xa3)
 #define MMS_MSG_INIT_REQ (0xa8)
 #define MMS_MSG_INIT_RESP (0xa9)
@@ -36,6 +41,15 @@ typedef struct service_t {
     int code;
     unsigned int index;
     const service_op_t *op;
+    xarena_t *arena; // owner of the tree in arena mode
+    mms_batch_t *batch; // owner of the tree in batch mode
+    mms_allocator_t allocator; // owner of the tree when alloc is set
+    unsigned int flags; // MMS_PARSE_* of the parse
+    unsigned int nest; // deepest structure nesting accepted
+    // event mode: decoders report to the handler
+    // instead of building nodes
+    const mms_handler_t *handler;
+    void *context;
 } service_t;
 
 typedef struct initdata_t {
@@ -64,11 +78,13 @@ typedef struct response_t {
     unsigned char follow_has; // has follow flag
     unsigned char follow_is; // value of the follow flag
     unsigned char delete; // deletable flag
+    xcells_t *cells; // read results in compact mode
 } response_t;
 
 typedef struct report_t {
     service_t parent;
     xlist_t *data;
+    xcells_t *cells; // values in compact mode
 } report_t;
 
 int mms_tostring(
@@ -100,42 +116,50 @@ int mms_tostring(
 }
 
 int mms_destroy(service_t *_service) {
-    if (_service == NULL) {
+    if (_service == NULL || _service->batch != NULL) {
+        return 0;
+    }
+    if (_service->arena != NULL) {
+        // the service itself lives in the arena
+        xarena_destroy(_service->arena);
         return 0;
     }
     if (_service->op == NULL ||
         _service->op->destroy == NULL) {
         return 0;
     }
-    return _service->op->destroy(_service);
+    if (_service->allocator.alloc == NULL) {
+        return _service->op->destroy(_service);
+    }
+    // the copy outlives the service while it releases itself
+    mms_allocator_t alloc = _service->allocator;
+    const mms_allocator_t *prev = xmem_bind(&alloc);
+    int ret = _service->op->destroy(_service);
+    xmem_bind(prev);
+    return ret;
 }
 
-typedef struct errstr_t {
-    int err_code;
-    const char *err_str;
-} errstr_t;
-
 const char *error_tostring(int _error) {
-    static const errstr_t g_errstr[] = {
-            {MMS_ERR_NULL,     "MMS_ERR_NULL"},
-            {MMS_ERR_FLAG,     "MMS_ERR_FLAG"},
-            {MMS_ERR_LENGTH,   "MMS_ERR_LENGTH"},
-            {MMS_ERR_DATATYPE, "MMS_ERR_DATATYPE"},
-            {MMS_ERR_MSGTYPE,  "MMS_ERR_MSGTYPE"},
-            {MMS_ERR_INVOKE,   "MMS_ERR_INVOKE"},
-            {MMS_ERR_REQTYPE,  "MMS_ERR_REQTYPE"},
-            {MMS_ERR_MEMALLOC, "MMS_ERR_MEMALLOC"},
-            {MMS_ERR_DATANODE, "MMS_ERR_DATANODE"},
-            {0,                0},
+    // indexed by the negated error code
+    static const char *const g_errstr[] = {
+            [-MMS_ERR_NULL] = "MMS_ERR_NULL",
+            [-MMS_ERR_FLAG] = "MMS_ERR_FLAG",
+            [-MMS_ERR_LENGTH] = "MMS_ERR_LENGTH",
+            [-MMS_ERR_DATATYPE] = "MMS_ERR_DATATYPE",
+            [-MMS_ERR_MSGTYPE] = "MMS_ERR_MSGTYPE",
+            [-MMS_ERR_INVOKE] = "MMS_ERR_INVOKE",
+            [-MMS_ERR_REQTYPE] = "MMS_ERR_REQTYPE",
+            [-MMS_ERR_RESPTYPE] = "MMS_ERR_RESPTYPE",
+            [-MMS_ERR_MEMALLOC] = "MMS_ERR_MEMALLOC",
+            [-MMS_ERR_DATANODE] = "MMS_ERR_DATANODE",
+            [-MMS_ERR_DOMAIN] = "MMS_ERR_DOMAIN",
+            [-MMS_ERR_DEPTH] = "MMS_ERR_DEPTH",
     };
-    const errstr_t *e = g_errstr;
-    while (e->err_str) {
-        if (e->err_code == _error) {
-            break;
-        }
-        e++;
+    size_t count = sizeof(g_errstr) / sizeof(g_errstr[0]);
+    if (_error >= 0 || (size_t) -_error >= count) {
+        return NULL;
     }
-    return e->err_str;
+    return g_errstr[-_error];
 }
 
 #define MMS_INVOKE_ID (0x02)
@@ -150,231 +174,359 @@ const char *error_tostring(int _error) {
 #define MMS_SERVICE_VARATTR (0xa6)
 #define MMS_SERVICE_VARIDX (0xac)
 
-// 解析报文长度
-static int mms_parse_length(
-        const unsigned char *_data,
-        unsigned int *_length) {
-    if (_data == NULL) {
-        return -1;
-    }
-    int size = 0;
+// parsing error of a cursor error
+#define MMS_TLV_ERR(err) \
+        ((err) == XTLV_ERR_TAG ? MMS_ERR_FLAG : MMS_ERR_LENGTH)
+
+// 解析调用 ID
+static int mms_parse_invoke(
+        xtlv_t *_tlv,
+        unsigned int *_invoke) {
     unsigned int length = 0;
-    if (_data[0] < 0x81) {
-        length = _data[0];
-        size = 1;
-    } else if (_data[0] == 0x81) {
-        length = _data[1];
-        size = 2;
-    } else if (_data[0] == 0x82) {
-        length = _data[1];
-        length <<= 8;
-        length += _data[2];
-        size = 3;
-    } else {
-        // log: unknown length type
-        return -2;
+    int ret = xtlv_expect(_tlv, MMS_INVOKE_ID, &length);
+    if (ret < 0) {
+        return ret;
     }
-    if (_length != NULL) {
-        (*_length) = length;
+    return xtlv_uint(_tlv, length, _invoke);
+}
+
+// object name of a variable, slices of the pdu
+typedef struct objname_t {
+    const char *domain;
+    unsigned int domain_len;
+    const char *item;
+    unsigned int item_len;
+} objname_t;
+
+// directory entry of a file directory response
+typedef struct dirent_t {
+    const char *name;
+    unsigned int length;
+    unsigned int size;
+    const char *stamp;
+} dirent_t;
+
+#define MMS_EVENTS(service) ((service)->handler != NULL)
+
+static void mms_emit_var(
+        const service_t *_service,
+        const objname_t *_name) {
+    if (_service->handler->var_spec == NULL) {
+        return;
     }
-    return size;
+    _service->handler->var_spec(
+            _service->context,
+            _name->domain, _name->domain_len,
+            _name->item, _name->item_len);
 }
 
-// 解析调用 ID
-static int mms_parse_invoke(
-        const unsigned char *_data,
-        unsigned int *_invoke) {
-    if (_data == NULL) {
-        return -1;
+static void mms_emit_ident(
+        const service_t *_service,
+        const char *_name, unsigned int _length) {
+    if (_service->handler->identifier == NULL) {
+        return;
     }
-    int idx = 0;
-    if (_data[idx++] != MMS_INVOKE_ID) {
-        return -2;
+    _service->handler->identifier(
+            _service->context, _name, _length);
+}
+
+static void mms_emit_pdu(
+        const service_t *_service,
+        unsigned int _invoke, int _type) {
+    if (!MMS_EVENTS(_service) ||
+        _service->handler->begin_pdu == NULL) {
+        return;
+    }
+    _service->handler->begin_pdu(
+            _service->context, _service->type,
+            _invoke, _type);
+}
+
+static void mms_emit_value(
+        const service_t *_service,
+        const xvalue_t *_value) {
+    if (_service->handler->data_value == NULL) {
+        return;
     }
-    unsigned int inv_size = _data[idx++];
-    if (inv_size > sizeof(unsigned int)) {
-        // log: invoke out of range
-        return -3;
+    _service->handler->data_value(
+            _service->context, _value);
+}
+
+static void mms_emit_struct(
+        const service_t *_service, int _begin) {
+    void (*event)(void *) = _service->handler->end_struct;
+    if (_begin) {
+        event = _service->handler->begin_struct;
     }
-    unsigned int invoke = 0;
-    unsigned int inv_idx = 0;
-    while (inv_idx < inv_size) {
-        invoke <<= 8;
-        invoke += _data[idx++];
-        inv_idx++;
+    if (event == NULL) {
+        return;
     }
-    if (_invoke != NULL) {
-        (*_invoke) = invoke;
+    event(_service->context);
+}
+
+static void mms_emit_entry(
+        const service_t *_service,
+        const dirent_t *_entry) {
+    if (_service->handler->file_entry == NULL) {
+        return;
     }
-    return idx;
+    _service->handler->file_entry(
+            _service->context, _entry->name,
+            _entry->length, _entry->size,
+            _entry->stamp);
+}
+
+// report the variable in event mode,
+// or append a node of _type named _name to _list
+static int mms_append_var(
+        const service_t *_service, xlist_t *_list,
+        int _type, const objname_t *_name) {
+    if (MMS_EVENTS(_service)) {
+        mms_emit_var(_service, _name);
+        return 0;
+    }
+    node_t *variable = node_create(_type);
+    if (variable == NULL) {
+        return MMS_ERR_MEMALLOC;
+    }
+    var_spec_domain(variable, _name->domain, _name->domain_len);
+    var_spec_index(variable, _name->item, _name->item_len);
+    xlist_append(_list, variable);
+    return 0;
+}
+
+// append the decoded value to _list, nothing in event mode
+static int mms_append_value(
+        const service_t *_service, xlist_t *_list,
+        xvalue_t *_value) {
+    if (MMS_EVENTS(_service)) {
+        return 0;
+    }
+    node_t *variable = node_create(NODE_TYPE_UDATA);
+    if (variable == NULL) {
+        xvalue_clear(_value);
+        return MMS_ERR_MEMALLOC;
+    }
+    udata_value(variable, _value);
+    xlist_append(_list, variable);
+    return 0;
+}
+
+// create the list of a service, none in event mode
+static xlist_t *mms_list_create(
+        const service_t *_service, int *_code) {
+    (*_code) = 0;
+    if (MMS_EVENTS(_service)) {
+        return NULL;
+    }
+    xlist_t *list = xlist_create();
+    if (list == NULL) {
+        (*_code) = MMS_ERR_MEMALLOC;
+    }
+    return list;
+}
+
+// create the node of a service, none in event mode
+static node_t *mms_node_create(
+        const service_t *_service,
+        int _type, int *_code) {
+    (*_code) = 0;
+    if (MMS_EVENTS(_service)) {
+        return NULL;
+    }
+    node_t *node = node_create(_type);
+    if (node == NULL) {
+        (*_code) = MMS_ERR_MEMALLOC;
+    }
+    return node;
+}
+
+// compact mode: the decoders report the values
+// to a handler that appends them to an array of cells
+typedef struct compact_t {
+    xcells_t *cells;
+    int borrow; // keep long payloads as views into the pdu
+    int prev_borrow;
+    // the decoders stop at the nesting limit of the service
+    int depth;
+    int open[MMS_NEST_MAX];
+    int code;
+} compact_t;
+
+static void compact_begin_struct(void *_ctx) {
+    compact_t *compact = (compact_t *) _ctx;
+    int index = xcells_open(compact->cells);
+    if (index < 0) {
+        compact->code = MMS_ERR_MEMALLOC;
+    }
+    if (compact->depth < MMS_NEST_MAX) {
+        compact->open[compact->depth] = index;
+    }
+    compact->depth++;
+}
+
+static void compact_end_struct(void *_ctx) {
+    compact_t *compact = (compact_t *) _ctx;
+    if (compact->depth <= 0) {
+        return;
+    }
+    compact->depth--;
+    if (compact->depth < MMS_NEST_MAX) {
+        xcells_close(compact->cells,
+                     compact->open[compact->depth]);
+    }
+}
+
+static void compact_value(void *_ctx, const xvalue_t *_value) {
+    compact_t *compact = (compact_t *) _ctx;
+    if (xcells_append(compact->cells, _value,
+                      compact->borrow) < 0) {
+        compact->code = MMS_ERR_MEMALLOC;
+    }
+}
+
+// route the values of the service to cells in compact mode,
+// return 0 when the service builds value nodes
+static int mms_compact_begin(
+        service_t *_service, compact_t *_compact) {
+    static const mms_handler_t handler = {
+            NULL, NULL,
+            compact_begin_struct,
+            compact_end_struct,
+            NULL, NULL,
+            compact_value,
+            NULL,
+    };
+    memset(_compact, 0, sizeof(compact_t));
+    if (!(_service->flags & MMS_PARSE_COMPACT) ||
+        MMS_EVENTS(_service)) {
+        return 0;
+    }
+    _compact->cells = xcells_create();
+    if (_compact->cells == NULL) {
+        return MMS_ERR_MEMALLOC;
+    }
+    _compact->borrow = (_service->flags & MMS_PARSE_BORROW) != 0;
+    // the cells copy what they keep from the views
+    _compact->prev_borrow = mmsstr_borrow_mode(1);
+    _service->handler = &handler;
+    _service->context = _compact;
+    return 1;
+}
+
+// back to node mode, return the cells or NULL if there are none
+static xcells_t *mms_compact_end(
+        service_t *_service, compact_t *_compact) {
+    if (_compact->cells == NULL) {
+        return NULL;
+    }
+    _service->handler = NULL;
+    _service->context = NULL;
+    mmsstr_borrow_mode(_compact->prev_borrow);
+    if (_compact->code < 0 && _service->code == 0) {
+        _service->code = _compact->code;
+    }
+    if (_compact->cells->count == 0) {
+        xcells_destroy(_compact->cells);
+        _compact->cells = NULL;
+    }
+    return _compact->cells;
 }
 
 static int mms_parse_domain(
-        const unsigned char *_data,
-        node_t *_domain) {
-    if (_data == NULL || _domain == NULL) {
+        xtlv_t *_tlv,
+        objname_t *_name) {
+    if (_tlv == NULL || _name == NULL) {
         return MMS_ERR_NULL;
     }
-    int idx = 0;
     // domain flag
-    if (_data[idx++] != 0xa1) {
-        return MMS_ERR_FLAG;
-    }
-    unsigned int total_len = 0;
-    int ret = mms_parse_length(_data + idx, &total_len);
-    if (ret <= 0) {
-        return MMS_ERR_LENGTH;
+    xtlv_t domain;
+    int ret = xtlv_enter(_tlv, 0xa1, &domain);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    idx += ret;
-    total_len += idx;
     // domain id flag
-    if (_data[idx++] != 0x1a) {
-        return MMS_ERR_FLAG;
-    }
     unsigned int length = 0;
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        return MMS_ERR_LENGTH;
-    }
-    idx += ret;
-    if (_data[idx + length] != 0x1a) {
-        return MMS_ERR_FLAG;
+    ret = xtlv_expect(&domain, 0x1a, &length);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    var_spec_domain(_domain, (char *) _data + idx, length);
-    idx += (int) length;
+    _name->domain = (const char *) xtlv_bytes(&domain, length);
+    _name->domain_len = length;
     // item id flag
-    if (_data[idx++] != 0x1a) {
-        return MMS_ERR_FLAG;
-    }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        return MMS_ERR_LENGTH;
+    ret = xtlv_expect(&domain, 0x1a, &length);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    idx += ret;
-    if (length != (total_len - idx)) {
+    if (length != xtlv_left(&domain)) {
         return MMS_ERR_LENGTH;
     }
-    var_spec_index(_domain, (char *) _data + idx, length);
-    idx += (int) length;
-    return idx;
+    _name->item = (const char *) xtlv_bytes(&domain, length);
+    _name->item_len = length;
+    return 0;
 }
 
 // 解析指定的变量
 static int mms_var_spec(
-        const unsigned char *_data,
-        node_t *_variable) {
-    if (_data == NULL || _variable == NULL) {
+        xtlv_t *_tlv,
+        objname_t *_name) {
+    if (_tlv == NULL || _name == NULL) {
         return MMS_ERR_NULL;
     }
-    int idx = 0;
-    if (_data[idx++] != 0x30) {
-        return MMS_ERR_FLAG;
-    }
-    unsigned int total_len = 0;
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        return MMS_ERR_LENGTH;
+    xtlv_t spec;
+    int ret = xtlv_enter(_tlv, 0x30, &spec);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    idx += ret;
-    total_len = length + idx;
     // name flag
-    if (_data[idx++] != 0xa0) {
-        return MMS_ERR_FLAG;
-    }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        return MMS_ERR_LENGTH;
+    xtlv_t name;
+    ret = xtlv_enter(&spec, 0xa0, &name);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    idx += ret;
-    if (length != (total_len - idx)) {
+    if (xtlv_left(&spec) != 0) {
         return MMS_ERR_LENGTH;
     }
-    ret = mms_parse_domain(_data + idx, _variable);
-    if (ret < 0) {
+    if (mms_parse_domain(&name, _name) < 0) {
         return MMS_ERR_DOMAIN;
     }
-    idx += ret;
-    return idx;
+    return 0;
 }
 
 // 解析读变量请求
 static void mms_read_request(
         request_t *_request,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _request;
-    int idx = 0;
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
     // read request service data: 0xa1
-    if (_data[idx++] != 0xa1) {
-        service->code = MMS_ERR_FLAG;
-        service->index += idx;
-        return;
-    }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
+    xtlv_t spec;
+    int ret = xtlv_enter(_tlv, 0xa1, &spec);
+    if (ret < 0 || xtlv_left(_tlv) != 0) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
         return;
     }
     // data list flag: 0xa0
-    if (_data[idx++] != 0xa0) {
-        service->code = MMS_ERR_FLAG;
-        service->index += idx;
+    xtlv_t vars;
+    ret = xtlv_enter(&spec, 0xa0, &vars);
+    if (ret < 0 || xtlv_left(&spec) != 0) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
         return;
     }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    xlist_t *list = xlist_create();
-    if (list == NULL) {
-        service->code = MMS_ERR_MEMALLOC;
-        service->index += idx;
+    xlist_t *list = mms_list_create(service, &ret);
+    if (ret < 0) {
+        service->code = ret;
         return;
     }
-    while (idx < length) {
-        node_t *variable = node_create(NODE_TYPE_VARSPEC);
-        if (variable == NULL) {
+    while (xtlv_left(&vars) > 0) {
+        objname_t name;
+        if (mms_var_spec(&vars, &name) < 0) {
             break;
         }
-        ret = mms_var_spec(_data + idx, variable);
-        if (ret <= 0) {
-            node_destroy(variable);
-            variable = NULL;
+        if (mms_append_var(service, list,
+                           NODE_TYPE_VARSPEC, &name) < 0) {
             break;
         }
-        xlist_append(list, variable);
-        idx += ret;
     }
-    service->index += idx;
     if (xlist_count(list) == 0) {
         xlist_destroy(list);
         list = NULL;
@@ -382,264 +534,309 @@ static void mms_read_request(
     _request->data.list = list;
 }
 
-static int mms_data_value(
-        const unsigned char *_data,
-        xvalue_t *_value, int _level) {
-    if (_level > 15) {
-        return MMS_ERR_DEPTH;
-    }
-    if (_data == NULL || _value == NULL) {
-        return MMS_ERR_NULL;
+static int mms_lazy_decode(
+        const void *_ctx,
+        const unsigned char *_data, unsigned int _length,
+        xlist_t **_list, int _owned);
+
+static const xdecoder_t g_lazy_decoder = {
+        mms_lazy_decode,
+};
+
+// decode a simple data value, return 0 or the parsing error
+static int mms_scalar_value(
+        const service_t *_service,
+        xtlv_t *_tlv,
+        xvalue_t *_value) {
+    int tag = xtlv_byte(_tlv);
+    unsigned int length = 0;
+    if (tag < 0 || xtlv_length(_tlv, &length) < 0) {
+        return MMS_ERR_LENGTH;
     }
-    _level++;
-    int idx = 0;
-    switch (_data[idx++]) {
+    const unsigned char *data = xtlv_bytes(_tlv, length);
+    int code = 0;
+    switch (tag) {
         case 0x83: {  // boolean
-            if (_data[idx++] != 0x01) {
-                idx = MMS_ERR_LENGTH;
+            if (length != 0x01) {
+                code = MMS_ERR_LENGTH;
                 break;
             }
-            xvalue_set_bool(_value, _data[idx++]);
+            xvalue_set_bool(_value, data[0]);
             break;
         }
         case 0x84: {  // bit string
-            unsigned int length = 0;
-            int ret = mms_parse_length(_data + idx, &length);
-            if (ret <= 0) {
-                idx = MMS_ERR_LENGTH;
-                break;
-            }
-            idx += ret;
-            // bit string padding
-            if (_data[idx] >= 8) {
-                idx = MMS_ERR_LENGTH;
+            // bit string padding, unused bits need a data byte
+            if (length == 0 || data[0] >= 8 ||
+                (length == 1 && data[0] != 0)) {
+                code = MMS_ERR_LENGTH;
                 break;
             }
-            xvalue_set_bitstr(_value, (char *) _data + idx, length);
-            idx += (int) length;
+            xvalue_set_bitstr(_value, (const char *) data, length);
             break;
         }
         case 0x85: {  // integer
-            unsigned int intsz = _data[idx++];
-            if (intsz > sizeof(int)) {
-                idx = MMS_ERR_LENGTH;
+            if (length > sizeof(int)) {
+                code = MMS_ERR_LENGTH;
                 break;
             }
             int i_val = 0;
             unsigned int byte_idx = 0;
-            while (byte_idx < intsz) {
+            while (byte_idx < length) {
                 i_val <<= 8;
-                i_val += _data[idx++];
-                byte_idx++;
+                i_val += data[byte_idx++];
             }
             xvalue_set_int(_value, i_val);
             break;
         }
         case 0x86: {  // unsigned integer
-            unsigned int intsz = _data[idx++];
-            if (intsz > sizeof(unsigned int)) {
-                idx = MMS_ERR_LENGTH;
+            if (length > sizeof(unsigned int)) {
+                code = MMS_ERR_LENGTH;
                 break;
             }
             unsigned int ui_val = 0;
             unsigned int byte_idx = 0;
-            while (byte_idx < intsz) {
+            while (byte_idx < length) {
                 ui_val <<= 8;
-                ui_val += _data[idx++];
-                byte_idx++;
+                ui_val += data[byte_idx++];
             }
             xvalue_set_uint(_value, ui_val);
             break;
         }
         case 0x87: {  // float point
-            if (_data[idx++] != 0x05) {
-                idx = MMS_ERR_LENGTH;
+            if (length != 0x05) {
+                code = MMS_ERR_LENGTH;
                 break;
             }
-            if (_data[idx++] != 0x08) {
-                idx = MMS_ERR_FLAG;
+            if (data[0] != 0x08) {
+                code = MMS_ERR_FLAG;
                 break;
             }
             float f_val;
             unsigned char tmpdata[4] = {0};
-            tmpdata[3] = _data[idx++];
-            tmpdata[2] = _data[idx++];
-            tmpdata[1] = _data[idx++];
-            tmpdata[0] = _data[idx++];
+            tmpdata[3] = data[1];
+            tmpdata[2] = data[2];
+            tmpdata[1] = data[3];
+            tmpdata[0] = data[4];
             memcpy(&f_val, tmpdata, 4);
             xvalue_set_float(_value, f_val);
             break;
         }
         case 0x89: {  // octet string
-            unsigned int length = 0;
-            int ret = mms_parse_length(_data + idx, &length);
-            if (ret <= 0) {
-                idx = MMS_ERR_LENGTH;
-                break;
-            }
-            idx += ret;
-            xvalue_set_octstr(_value, (char *) _data + idx, length);
-            idx += (int) length;
+            xvalue_set_octstr(_value, (const char *) data, length);
             break;
         }
         case 0x8a: {  // visible string
-            unsigned int length = 0;
-            int ret = mms_parse_length(_data + idx, &length);
-            if (ret <= 0) {
-                idx = MMS_ERR_LENGTH;
-                break;
-            }
-            idx += ret;
-            xvalue_set_string(_value, (char *) _data + idx, length);
-            idx += (int) length;
+            xvalue_set_string(_value, (const char *) data, length);
             break;
         }
         case 0x8c: {  // binary time
-            unsigned int btsz = _data[idx++];
-            if (btsz != 0x06) {
-                idx = MMS_ERR_LENGTH;
+            if (length != 0x06) {
+                code = MMS_ERR_LENGTH;
                 break;
             }
-            xvalue_set_bintime(_value, _data + idx);
-            idx += 0x06;
+            xvalue_set_bintime(_value, data);
             break;
         }
         case 0x91: {  // utc time
-            if (_data[idx++] != 0x08) {
-                idx = MMS_ERR_LENGTH;
+            if (length != 0x08) {
+                code = MMS_ERR_LENGTH;
                 break;
             }
-            xvalue_set_utctime(_value, _data + idx);
-            idx += 0x08;
+            xvalue_set_utctime(_value, data);
             break;
         }
-        case 0xa2: {
-            unsigned int length = 0;
-            int ret = mms_parse_length(_data + idx, &length);
-            if (ret <= 0) {
-                idx = MMS_ERR_LENGTH;
-                break;
+        default: {
+            code = MMS_ERR_DATATYPE;
+            break;
+        }
+    }
+    if (code == 0 && MMS_EVENTS(_service)) {
+        mms_emit_value(_service, _value);
+    }
+    return code;
+}
+
+// keep the members of a structure for mms_lazy_decode,
+// only their number is decoded
+static int mms_lazy_value(
+        const service_t *_service,
+        const xtlv_t *_body, xvalue_t *_value) {
+    xlazy_t lazy;
+    lazy.data = _body->data;
+    lazy.length = (unsigned int) xtlv_left(_body);
+    lazy.count = 0;
+    lazy.decoder = &g_lazy_decoder;
+    lazy.context = _service;
+    xtlv_t members = (*_body);
+    while (xtlv_left(&members) > 0) {
+        if (xtlv_skip(&members) < 0) {
+            return MMS_ERR_LENGTH;
+        }
+        lazy.count++;
+    }
+    xvalue_set_lazy(_value, &lazy);
+    return 0;
+}
+
+// structure opened by mms_data_value
+typedef struct value_frame_t {
+    xlist_t *list;
+    xtlv_t members; // members left
+} value_frame_t;
+
+// decode a data value, nested structures are walked
+// with an explicit stack instead of recursion
+static int mms_data_value(
+        const service_t *_service,
+        xtlv_t *_tlv,
+        xvalue_t *_value) {
+    if (_tlv == NULL || _value == NULL) {
+        return MMS_ERR_NULL;
+    }
+    value_frame_t stack[MMS_NEST_MAX];
+    int lazy = (_service->flags & MMS_PARSE_LAZY) &&
+               !MMS_EVENTS(_service);
+    int depth = 0;
+    int code = 0;
+    xtlv_t *tlv = _tlv;
+    do {
+        xvalue_t value;
+        memset(&value, 0, sizeof(xvalue_t));
+        if (depth > 0 && xtlv_left(tlv) == 0) {
+            // the innermost structure is complete
+            depth--;
+            if (MMS_EVENTS(_service)) {
+                mms_emit_struct(_service, 0);
+            } else {
+                xvalue_set_struct(&value, stack[depth].list);
             }
-            idx += ret;
-            length += idx;
-            xlist_t *nodelist = xlist_create();
-            if (nodelist == NULL) {
-                idx = MMS_ERR_MEMALLOC;
+            tlv = depth > 0 ? &stack[depth - 1].members : _tlv;
+        } else if (xtlv_peek(tlv) == 0xa2) {
+            xtlv_t body;
+            if (xtlv_enter(tlv, 0xa2, &body) < 0) {
+                code = MMS_ERR_LENGTH;
                 break;
             }
-            while (idx < length) {
-                node_t *variable = node_create(NODE_TYPE_UDATA);
-                if (variable == NULL) {
+            if (lazy) {
+                code = mms_lazy_value(_service, &body, &value);
+                if (code < 0) {
                     break;
                 }
-                xvalue_t value;
-                memset(&value, 0, sizeof(xvalue_t));
-                ret = mms_data_value(_data + idx, &value, _level);
-                if (ret <= 0) {
-                    node_destroy(variable);
-                    variable = NULL;
+            } else {
+                if (depth >= (int) _service->nest) {
+                    code = MMS_ERR_DEPTH;
                     break;
                 }
-                udata_value(variable, &value);
-                xlist_append(nodelist, variable);
-                idx += ret;
+                xlist_t *list = mms_list_create(_service, &code);
+                if (code < 0) {
+                    break;
+                }
+                stack[depth].list = list;
+                stack[depth].members = body;
+                tlv = &stack[depth++].members;
+                if (MMS_EVENTS(_service)) {
+                    mms_emit_struct(_service, 1);
+                }
+                continue;
+            }
+        } else {
+            code = mms_scalar_value(_service, tlv, &value);
+            if (code < 0) {
+                xvalue_clear(&value);
+                break;
             }
-            xvalue_set_struct(_value, nodelist);
-            break;
         }
-        default: {
-            idx = MMS_ERR_DATATYPE;
+        if (depth == 0) {
+            (*_value) = value;
+        } else if (mms_append_value(
+                _service, stack[depth - 1].list, &value) < 0) {
+            code = MMS_ERR_MEMALLOC;
             break;
         }
+    } while (depth > 0);
+    if (code < 0 && depth == 0) {
+        return code;
     }
-    return idx;
+    // a malformed member ends the open structures, they keep
+    // the members decoded before it and _tlv is already past them
+    while (depth > 0) {
+        depth--;
+        if (MMS_EVENTS(_service)) {
+            mms_emit_struct(_service, 0);
+            continue;
+        }
+        xvalue_t value;
+        memset(&value, 0, sizeof(xvalue_t));
+        xvalue_set_struct(&value, stack[depth].list);
+        if (depth == 0) {
+            (*_value) = value;
+        } else {
+            mms_append_value(
+                    _service, stack[depth - 1].list, &value);
+        }
+    }
+    return 0;
 }
 
 static int mms_access_result(
-        const unsigned char *_data,
-        node_t *_acsret) {
-    if (_data == NULL || _acsret == NULL) {
+        const service_t *_service,
+        xtlv_t *_tlv,
+        xvalue_t *_value) {
+    if (_tlv == NULL || _value == NULL) {
         return MMS_ERR_NULL;
     }
-    int idx = 0;
-    xvalue_t value;
-    memset(&value, 0, sizeof(xvalue_t));
-    if (_data[idx] == 0x80) {  // error code
-        idx++;
-        if (_data[idx++] != 0x01) {
+    if (xtlv_peek(_tlv) == 0x80) {  // error code
+        unsigned int length = 0;
+        if (xtlv_expect(_tlv, 0x80, &length) < 0 ||
+            length != 0x01) {
             return MMS_ERR_LENGTH;
         }
-        value.value._int = _data[idx++];
-        udata_value(_acsret, &value);
-        return idx;
+        _value->type = VALUE_TYPE_ERROR;
+        _value->value._int = xtlv_byte(_tlv);
+        if (MMS_EVENTS(_service)) {
+            mms_emit_value(_service, _value);
+        }
+        return 0;
     }
     // data value
-    idx = mms_data_value(_data + idx, &value, 1);
-    if (idx <= 0) {
-        return idx;
-    }
-    udata_value(_acsret, &value);
-    return idx;
+    return mms_data_value(_service, _tlv, _value);
 }
 
 // 解析读服务响应
 static void mms_read_response(
         response_t *_resp,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _resp;
-    int idx = 0;
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
+    // read service response data flag
+    xtlv_t results;
+    int ret = xtlv_enter(_tlv, 0xa1, &results);
+    if (ret < 0 || xtlv_left(_tlv) != 0) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
         return;
     }
-    // read service response data flag
-    if (_data[idx++] != 0xa1) {
-        service->code = MMS_ERR_FLAG;
-        service->index += idx;
+    compact_t compact;
+    ret = mms_compact_begin(service, &compact);
+    if (ret < 0) {
+        service->code = ret;
         return;
     }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
+    xlist_t *list = mms_list_create(service, &ret);
+    if (ret < 0) {
+        service->code = ret;
         return;
     }
-    idx += ret;
-    if (length != (_length - idx)) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    xlist_t *list = xlist_create();
-    if (list == NULL) {
-        service->code = MMS_ERR_MEMALLOC;
-        service->index += idx;
-        return;
-    }
-    while (idx < _length) {
-        node_t *result = node_create(NODE_TYPE_UDATA);
-        if (result == NULL) {
+    while (xtlv_left(&results) > 0) {
+        xvalue_t value;
+        memset(&value, 0, sizeof(xvalue_t));
+        if (mms_access_result(service, &results, &value) < 0) {
+            xvalue_clear(&value);
             break;
         }
-        ret = mms_access_result(_data + idx, result);
-        if (ret <= 0) {
-            node_destroy(result);
-            result = NULL;
+        if (mms_append_value(service, list, &value) < 0) {
+            break;
         }
-        xlist_append(list, result);
-        idx += ret;
     }
-    service->index += idx;
+    _resp->cells = mms_compact_end(service, &compact);
     if (xlist_count(list) == 0) {
         xlist_destroy(list);
         list = NULL;
@@ -649,1381 +846,963 @@ static void mms_read_response(
 
 static void mms_write_request(
         request_t *_request,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _request;
-    int idx = 0;
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
     // list flag
-    if (_data[idx++] != 0xa0) {
-        service->code = MMS_ERR_FLAG;
-        service->index += idx;
-        return;
-    }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    idx += ret;
-    // data list flag
-    if (_data[length + idx] != 0xa0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
+    xtlv_t vars;
+    int ret = xtlv_enter(_tlv, 0xa0, &vars);
+    if (ret < 0) {
+        service->code = MMS_TLV_ERR(ret);
         return;
     }
     if (_request->data.list == NULL) {
-        _request->data.list = xlist_create();
+        _request->data.list = mms_list_create(service, &ret);
     }
-    if (_request->data.list == NULL) {
-        service->code = MMS_ERR_MEMALLOC;
-        service->index += idx;
+    if (ret < 0) {
+        service->code = ret;
         return;
     }
-    int idx_end = idx + (int) length;
-    while (idx < idx_end) {
-        node_t *req = node_create(NODE_TYPE_WRITREQ);
-        ret = mms_var_spec(_data + idx, req);
-        if (ret <= 0) {
-            node_destroy(req);
-            req = NULL;
+    while (xtlv_left(&vars) > 0) {
+        objname_t name;
+        if (mms_var_spec(&vars, &name) < 0) {
+            break;
+        }
+        if (mms_append_var(service, _request->data.list,
+                           NODE_TYPE_WRITREQ, &name) < 0) {
             break;
         }
-        xlist_append(_request->data.list, req);
-        idx += ret;
     }
     // write request data list
-    if (_data[idx++] != 0xa0) {
-        service->code = MMS_ERR_FLAG;
-        service->index += idx;
-        return;
-    }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
+    xtlv_t values;
+    ret = xtlv_enter(_tlv, 0xa0, &values);
+    if (ret < 0 || xtlv_left(_tlv) != 0) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
         return;
     }
-    idx += ret;
-    if (length != (_length - idx)) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    node_t *req = xlist_begin(_request->data.list);
-    do {
+    // the values complete the variables of the request list
+    size_t item = 0;
+    node_t *req = xlist_at(_request->data.list, item++);
+    while (xtlv_left(&values) > 0) {
         xvalue_t value;
         memset(&value, 0, sizeof(xvalue_t));
-        ret = mms_data_value(_data + idx, &value, 1);
-        if (ret <= 0) {
+        if (mms_data_value(service, &values, &value) < 0) {
             break;
         }
-        writ_req_value(req, &value);
-        req = xlist_next(_request->data.list);
-        idx += ret;
-    } while (idx < _length);
-    service->index += idx;
+        if (writ_req_value(req, &value) < 0) {
+            xvalue_clear(&value);
+        }
+        req = xlist_at(_request->data.list, item++);
+    }
 }
 
 static void mms_write_response(
         response_t *_resp,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _resp;
-    int idx = 0;
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
+    int ret = 0;
     if (_resp->data.list == NULL) {
-        _resp->data.list = xlist_create();
+        _resp->data.list = mms_list_create(service, &ret);
     }
-    if (_resp->data.list == NULL) {
-        service->code = MMS_ERR_MEMALLOC;
-        service->index += idx;
+    if (ret < 0) {
+        service->code = ret;
         return;
     }
-    while (idx < _length) {
-        node_t *resp = node_create(NODE_TYPE_WRITRESP);
-        if (resp == NULL) {
-            break;
-        }
-        unsigned char is_okay = _data[idx++];
+    while (xtlv_left(_tlv) > 0) {
+        xvalue_t value;
+        memset(&value, 0, sizeof(xvalue_t));
+        unsigned int length = 0;
+        int is_okay = xtlv_peek(_tlv);
         if (is_okay == 0x81) {
-            if (_data[idx++] != 0x00) {
+            if (xtlv_expect(_tlv, 0x81, &length) < 0 ||
+                length != 0x00) {
                 break;
             }
-            writ_resp_code(resp, 1, 0);
-            xlist_append(_resp->data.list, resp);
         } else if (is_okay == 0x80) {
-            if (_data[idx++] != 0x01) {
+            if (xtlv_expect(_tlv, 0x80, &length) < 0 ||
+                length != 0x01) {
                 break;
             }
-            unsigned char code = _data[idx++];
-            writ_resp_code(resp, 0, code);
-            xlist_append(_resp->data.list, resp);
+            value.type = VALUE_TYPE_ERROR;
+            value.value._int = xtlv_byte(_tlv);
         } else {
             break;
         }
+        if (MMS_EVENTS(service)) {
+            mms_emit_value(service, &value);
+            continue;
+        }
+        node_t *resp = node_create(NODE_TYPE_WRITRESP);
+        if (resp == NULL) {
+            break;
+        }
+        writ_resp_code(resp, value.type != VALUE_TYPE_ERROR,
+                       (unsigned char) value.value._int);
+        xlist_append(_resp->data.list, resp);
     }
-    service->index += idx;
 }
 
 static int mms_name_req(
-        const unsigned char *_data,
-        unsigned int _length,
+        const service_t *_service,
+        xtlv_t *_tlv,
         node_t *_name_req) {
-    if (_data == NULL || _name_req == NULL) {
+    if (_tlv == NULL) {
         return MMS_ERR_NULL;
     }
-    int idx = 0;
-    if (_data[idx++] != 0xa1) {
-        return MMS_ERR_FLAG;
+    xtlv_t scope;
+    int ret = xtlv_enter(_tlv, 0xa1, &scope);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
     unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        return MMS_ERR_LENGTH;
-    }
-    idx += ret;
-    if (length != (_length - idx) &&
-        _data[idx + length] != 0x82) {
-        return MMS_ERR_LENGTH;
-    }
-    if (_data[idx++] != 0x81) {
-        return MMS_ERR_FLAG;
-    }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        return MMS_ERR_LENGTH;
+    ret = xtlv_expect(&scope, 0x81, &length);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    idx += ret;
-    if (length != (_length - idx) &&
-        _data[idx + length] != 0x82) {
-        return MMS_ERR_LENGTH;
+    const char *domain = (const char *) xtlv_bytes(&scope, length);
+    name_req_domain(_name_req, domain, length);
+    if (MMS_EVENTS(_service)) {
+        mms_emit_ident(_service, domain, length);
     }
-    name_req_domain(_name_req, (char *) _data + idx, length);
-    idx += (int) length;
-    if (idx == _length) {
-        return idx;
+    if (xtlv_left(_tlv) == 0) {
+        return 0;
     }
-    if (_data[idx++] != 0x82) {
-        return MMS_ERR_FLAG;
+    ret = xtlv_expect(_tlv, 0x82, &length);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
+    if (length != xtlv_left(_tlv)) {
         return MMS_ERR_LENGTH;
     }
-    idx += ret;
-    if (length != (_length - idx)) {
-        return MMS_ERR_LENGTH;
+    const char *next = (const char *) xtlv_bytes(_tlv, length);
+    name_req_next(_name_req, next, length);
+    if (MMS_EVENTS(_service)) {
+        mms_emit_ident(_service, next, length);
     }
-    name_req_next(_name_req, (char *) _data + idx, length);
-    idx += (int) length;
-    return idx;
+    return 0;
 }
 
 static void mms_getnamelist_request(
         request_t *_request,
-        const unsigned char *_data,
-        size_t _length) {
-    int idx = 0;
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _request;
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    if (_data[idx++] != 0xa0) {
-        service->code = MMS_ERR_FLAG;
-        service->index += idx;
-        return;
-    }
-    if (_data[idx++] != 0x03) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    if (_data[idx++] != 0x80) {
-        service->code = MMS_ERR_FLAG;
-        service->index += idx;
+    xtlv_t object;
+    int ret = xtlv_enter(_tlv, 0xa0, &object);
+    if (ret < 0) {
+        service->code = MMS_TLV_ERR(ret);
         return;
     }
-    if (_data[idx++] != 0x01) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
+    unsigned int length = 0;
+    ret = xtlv_expect(&object, 0x80, &length);
+    if (ret < 0 || length != 0x01) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
         return;
     }
-    int type = _data[idx++];
+    int type = xtlv_byte(&object);
     if (type == 0x09) {
-        if (_data[idx++] != 0xa1) {
-            service->code = MMS_ERR_FLAG;
-            service->index += idx;
-            return;
-        }
-        if (_data[idx++] != 0x02) {
-            service->code = MMS_ERR_LENGTH;
-            service->index += idx;
-            return;
-        }
-        if (_data[idx++] != 0x80) {
-            service->code = MMS_ERR_FLAG;
-            service->index += idx;
+        xtlv_t scope;
+        ret = xtlv_enter(_tlv, 0xa1, &scope);
+        if (ret < 0) {
+            service->code = MMS_TLV_ERR(ret);
             return;
         }
-        if (_data[idx++] != 0x00) {
-            service->code = MMS_ERR_LENGTH;
-            service->index += idx;
+        ret = xtlv_expect(&scope, 0x80, &length);
+        if (ret < 0 || length != 0x00) {
+            service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
             return;
         }
-        node_t *req = node_create(NODE_TYPE_NAMEREQ);
-        if (req == NULL) {
-            service->code = MMS_ERR_MEMALLOC;
-            service->index += idx;
+        node_t *req = mms_node_create(
+                service, NODE_TYPE_NAMEREQ, &ret);
+        if (ret < 0) {
+            service->code = ret;
             return;
         }
         name_req_type(req, type);
         _request->data.node = req;
-        service->index += idx;
     } else if (type == 0x00 || type == 0x02 ||
                type == 0x08) {
-        node_t *req = node_create(NODE_TYPE_NAMEREQ);
-        if (req == NULL) {
-            service->code = MMS_ERR_MEMALLOC;
-            service->index += idx;
+        node_t *req = mms_node_create(
+                service, NODE_TYPE_NAMEREQ, &ret);
+        if (ret < 0) {
+            service->code = ret;
             return;
         }
         name_req_type(req, type);
-        ret = mms_name_req(_data + idx, _length - idx, req);
+        ret = mms_name_req(service, _tlv, req);
         if (ret < 0) {
             node_destroy(req);
             req = NULL;
             service->code = ret;
-            service->index += idx;
             return;
         }
         _request->data.node = req;
-        idx += ret;
-        service->index += idx;
     } else {
         service->code = MMS_ERR_FLAG;
-        service->index += idx;
-        return;
     }
 }
 
 static int mms_identifer(
-        const unsigned char *_data,
-        node_t *_idstr) {
-    if (_data == NULL || _idstr == NULL) {
+        xtlv_t *_tlv,
+        const char **_name,
+        unsigned int *_length) {
+    if (_tlv == NULL || _name == NULL) {
         return MMS_ERR_NULL;
     }
-    int idx = 0;
-    if (_data[idx++] != 0x1a) {
-        return MMS_ERR_FLAG;
-    }
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        return MMS_ERR_LENGTH;
+    int ret = xtlv_expect(_tlv, 0x1a, _length);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    idx += ret;
-    idstr_name(_idstr, (char *) _data + idx, length);
-    idx += (int) length;
-    return idx;
+    (*_name) = (const char *) xtlv_bytes(_tlv, *_length);
+    return 0;
 }
 
 static void mms_getnamelist_response(
         response_t *_resp,
-        const unsigned char *_data,
-        size_t _length) {
-    int code = MMS_ERR_LENGTH;
-    int idx = 0;
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _resp;
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
     // name list flag
-    if (_data[idx++] != 0xa0) {
-        service->code = MMS_ERR_FLAG;
-        service->index += idx;
-        return;
-    }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    idx += ret;
-    if (length != (_length - idx) &&
-        _data[length + idx] != 0x81) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
+    xtlv_t names;
+    int ret = xtlv_enter(_tlv, 0xa0, &names);
+    if (ret < 0) {
+        service->code = MMS_TLV_ERR(ret);
         return;
     }
     if (_resp->data.list == NULL) {
-        _resp->data.list = xlist_create();
+        _resp->data.list = mms_list_create(service, &ret);
     }
-    if (_resp->data.list == NULL) {
-        service->code = MMS_ERR_MEMALLOC;
-        service->index += idx;
+    if (ret < 0) {
+        service->code = ret;
         return;
     }
-    while (idx < _length) {
+    while (xtlv_left(&names) > 0) {
+        const char *name = NULL;
+        unsigned int length = 0;
+        if (mms_identifer(&names, &name, &length) < 0) {
+            break;
+        }
+        if (MMS_EVENTS(service)) {
+            mms_emit_ident(service, name, length);
+            continue;
+        }
         node_t *idstr = node_create(NODE_TYPE_IDSTR);
-        ret = mms_identifer(_data + idx, idstr);
-        if (ret <= 0) {
-            node_destroy(idstr);
+        if (idstr == NULL) {
             break;
         }
-        idx += ret;
+        idstr_name(idstr, name, length);
         xlist_append(_resp->data.list, idstr);
     }
-    if (idx >= _length) {
-        service->index += idx;
-        return;
-    }
-    if (_data[idx++] != 0x81) {
-        service->code = MMS_ERR_FLAG;
-        service->index += idx;
+    if (xtlv_left(_tlv) == 0) {
         return;
     }
-    if (_data[idx++] != 0x01) {
+    unsigned int length = 0;
+    ret = xtlv_expect(_tlv, 0x81, &length);
+    if (ret < 0 || length != 0x01) {
         service->code = MMS_ERR_FLAG;
-        service->index += idx;
         return;
     }
     _resp->follow_has = 1;
-    _resp->follow_is = _data[idx++];
-    service->index += idx;
+    _resp->follow_is = (unsigned char) xtlv_byte(_tlv);
 }
 
 static void mms_varattr_request(
         request_t *_request,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _request;
-    node_t *varspec = NULL;
-    int code = MMS_ERR_LENGTH;
-    int idx = 0;
-    unsigned int length = 0;
-    do {
-        int ret = mms_parse_length(_data + idx, &length);
-        if (ret <= 0) {
-            break;
-        }
-        idx += ret;
-        if (length != (_length - idx)) {
-            break;
-        }
-        if (_data[idx++] != 0xa0) {
-            code = MMS_ERR_FLAG;
-            break;
-        }
-        ret = mms_parse_length(_data + idx, &length);
-        if (ret <= 0) {
-            break;
-        }
-        idx += ret;
-        if (length != (_length - idx)) {
-            break;
-        }
-        varspec = node_create(NODE_TYPE_VARSPEC);
-        if (varspec == NULL) {
-            code = MMS_ERR_MEMALLOC;
-            break;
-        }
-        ret = mms_parse_domain(_data + idx, varspec);
-        if (ret < 0) {
-            code = MMS_ERR_DOMAIN;
-            break;
-        }
-        idx += ret;
-        _request->data.node = varspec;
-        service->index += idx;
+    xtlv_t object;
+    int ret = xtlv_enter(_tlv, 0xa0, &object);
+    if (ret < 0 || xtlv_left(_tlv) != 0) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
         return;
-    } while (0);
-    service->code = code;
-    service->index += idx;
-    node_destroy(varspec);
-    varspec = NULL;
+    }
+    objname_t name;
+    if (mms_parse_domain(&object, &name) < 0) {
+        service->code = MMS_ERR_DOMAIN;
+        return;
+    }
+    if (MMS_EVENTS(service)) {
+        mms_emit_var(service, &name);
+        return;
+    }
+    node_t *varspec = node_create(NODE_TYPE_VARSPEC);
+    if (varspec == NULL) {
+        service->code = MMS_ERR_MEMALLOC;
+        return;
+    }
+    var_spec_domain(varspec, name.domain, name.domain_len);
+    var_spec_index(varspec, name.item, name.item_len);
+    _request->data.node = varspec;
 }
 
-static int mms_type_array(
-        node_t *_type,
-        const unsigned char *_data,
-        unsigned int _length, int _level);
-
-static int mms_type_spec(
+// decode the name of a type spec, _desc receives the
+// type description. return the type code or the parsing error
+static int mms_type_head(
+        const service_t *_service,
         node_t *_type,
-        const unsigned char *_data,
-        int _level) {
-    if (_level > 9) {
-        return MMS_ERR_DEPTH;
-    }
-    if (_type == NULL || _data == NULL) {
-        return MMS_ERR_NULL;
-    }
-    int idx = 0;
+        xtlv_t *_tlv,
+        xtlv_t *_desc) {
     // item flag
-    if (_data[idx++] != 0x30) {
-        return MMS_ERR_FLAG;
-    }
-    unsigned int total = 0;
-    int ret = mms_parse_length(_data + idx, &total);
-    if (ret <= 0) {
-        return MMS_ERR_LENGTH;
+    xtlv_t spec;
+    int ret = xtlv_enter(_tlv, 0x30, &spec);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    idx += ret;
-    total += idx;
     // name flag
-    if (_data[idx++] != 0x80) {
-        return MMS_ERR_FLAG;
-    }
     unsigned int length = 0;
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        return MMS_ERR_LENGTH;
+    ret = xtlv_expect(&spec, 0x80, &length);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    idx += ret;
-    if (_data[idx + length] != 0xa1) {
-        return MMS_ERR_LENGTH;
+    const char *name = (const char *) xtlv_bytes(&spec, length);
+    type_name(_type, name, length);
+    if (MMS_EVENTS(_service)) {
+        mms_emit_ident(_service, name, length);
     }
-    type_name(_type, (char *) _data + idx, length);
-    idx += (int) length;
     // value
-    if (_data[idx++] != 0xa1) {
-        return MMS_ERR_FLAG;
+    ret = xtlv_enter(&spec, 0xa1, _desc);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    ret = mms_parse_length(
-            _data + idx, &length);
-    if (ret <= 0) {
+    if (xtlv_left(&spec) != 0) {
         return MMS_ERR_LENGTH;
     }
-    idx += ret;
-    if (length != (total - idx)) {
+    int typecode = xtlv_peek(_desc);
+    if (typecode < 0) {
         return MMS_ERR_LENGTH;
     }
-    int typecode = _data[idx++];
     type_code(_type, typecode);
-    if (typecode == 0xa2) {
-        // complex structure
-        ret = mms_parse_length(
-                _data + idx, &length);
-        if (ret <= 0) {
+    return typecode;
+}
+
+// decode the constraint of a simple type,
+// return 0 or the parsing error
+static int mms_type_leaf(
+        node_t *_type,
+        xtlv_t *_desc,
+        int _code) {
+    if (_code == 0xa7) {
+        // float : todo:
+        return xtlv_skip(_desc) < 0 ? MMS_ERR_LENGTH : 0;
+    }
+    unsigned int length = 0;
+    if (xtlv_expect(_desc, _code, &length) < 0) {
+        return MMS_ERR_LENGTH;
+    }
+    if (_code == 0x85 ||
+        _code == 0x86 ||
+        _code == 0x84 ||
+        _code == 0x90 ||
+        _code == 0x8a) {
+        // integer && string : type + length, an Integer32,
+        // negative for a variable length
+        const unsigned char *data = NULL;
+        if (length == 0 || length > sizeof(int) ||
+            (data = xtlv_bytes(_desc, length)) == NULL) {
             return MMS_ERR_LENGTH;
         }
-        idx += ret;
-        ret = mms_type_array(
-                _type, _data + idx,
-                length, _level + 1);
-        if (ret <= 0) {
-            return ret;
-        }
-        idx += ret;
-    } else if (typecode == 0x85 ||
-               typecode == 0x86 ||
-               typecode == 0x84 ||
-               typecode == 0x90 ||
-               typecode == 0x8a) {
-        // integer && string : type + length
-        length = _data[idx++];
-        unsigned int value = 0;
-        ret = 0;
-        while (ret < length) {
-            value <<= 8;
-            value += _data[ret];
-            ret++;
+        unsigned int value = (data[0] & 0x80) ? 0xffffffffu : 0;
+        unsigned int idx = 0;
+        while (idx < length) {
+            value = (value << 8) | data[idx++];
         }
-        idx += (int) length;
         xvalue_t xvalue;
         memset(&xvalue, 0, sizeof(xvalue_t));
-        xvalue_set_uint(&xvalue, value);
+        xvalue_set_int(&xvalue, (int) value);
         type_constraint(_type, &xvalue);
-    } else if (typecode == 0x83 ||
-               typecode == 0x91) {
+    } else if (_code == 0x83 ||
+               _code == 0x91) {
         // boolean && utc : no any constraint
-        if (_data[idx++] != 0x00) {
+        if (length != 0x00) {
             return MMS_ERR_DATANODE;
         }
-    } else if (typecode == 0xa7) {
-        // float : todo:
-        idx += 7;
     } else {
         // unknown type
         return MMS_ERR_DATATYPE;
     }
-    return idx;
+    return 0;
 }
 
-static int mms_type_array(
+// structure type opened by mms_type_array
+typedef struct type_frame_t {
+    xlist_t *array;
+    xtlv_t components; // components left
+} type_frame_t;
+
+// open the component array of _type in _body,
+// return 0 or the parsing error
+static int mms_type_open(
+        const service_t *_service,
         node_t *_type,
-        const unsigned char *_data,
-        unsigned int _length, int _level) {
-    if (_level > 9) {
-        return MMS_ERR_DEPTH;
-    }
-    if (_type == NULL ||
-        _data == NULL || _length == 0) {
-        return MMS_ERR_NULL;
-    }
-    int idx = 0;
-    unsigned int length = 0;
+        xtlv_t *_body,
+        type_frame_t *_frame) {
     // array flag
-    if (_data[idx++] != 0xa1) {
-        return MMS_ERR_FLAG;
-    }
-    int ret = mms_parse_length(
-            _data + idx, &length);
-    if (ret <= 0) {
-        return MMS_ERR_LENGTH;
+    int ret = xtlv_enter(_body, 0xa1, &_frame->components);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    idx += ret;
-    if (length != (_length - idx)) {
+    if (xtlv_left(_body) != 0) {
         return MMS_ERR_LENGTH;
     }
     // create array
-    xlist_t *type_array = xlist_create();
-    if (type_array == NULL) {
-        return MMS_ERR_MEMALLOC;
+    xlist_t *type_array = mms_list_create(_service, &ret);
+    if (ret < 0) {
+        return ret;
     }
-    while (idx < _length) {
-        node_t *type = node_create(NODE_TYPE_TYPE);
-        if (type == NULL) {
-            break;
-        }
-        ret = mms_type_spec(
-                type, _data + idx, _level + 1);
-        if (ret <= 0) {
-            node_destroy(type);
-            type = NULL;
-            break;
-        }
-        idx += ret;
-        xlist_append(type_array, type);
-    }
-    xvalue_t value;
-    memset(&value, 0, sizeof(xvalue_t));
-    xvalue_set_struct(&value, type_array);
-    type_constraint(_type, &value);
-    if (idx != _length) {
-        if (ret <= 0) {
-            return MMS_ERR_DATANODE;
-        }
-        return MMS_ERR_MEMALLOC;
+    if (MMS_EVENTS(_service)) {
+        mms_emit_struct(_service, 1);
+    } else {
+        // the components are appended while decoding
+        xvalue_t value;
+        memset(&value, 0, sizeof(xvalue_t));
+        xvalue_set_struct(&value, type_array);
+        type_constraint(_type, &value);
     }
-    return idx;
+    _frame->array = type_array;
+    return 0;
 }
 
-static void mms_varattr_response(
-        response_t *_resp,
-        const unsigned char *_data,
-        size_t _length) {
-    service_t *service = (service_t *) _resp;
-    int code = MMS_ERR_LENGTH;
-    int idx = 0;
-    unsigned int length = 0;
-    do {
-        int ret = mms_parse_length(_data + idx, &length);
-        if (ret <= 0) {
-            break;
-        }
-        idx += ret;
-        if (length != (_length - idx)) {
-            break;
-        }
-        if (_data[idx++] != 0x80) {
-            code = MMS_ERR_FLAG;
-            break;
-        }
-        if (_data[idx++] != 0x01) {
-            break;
+// decode the component array of a structure type, nested
+// structures are walked with an explicit stack instead of
+// recursion. on error the components decoded so far stay
+// in _type, return 0 or the parsing error
+static int mms_type_array(
+        const service_t *_service,
+        node_t *_type,
+        xtlv_t *_body) {
+    if (_body == NULL) {
+        return MMS_ERR_NULL;
+    }
+    type_frame_t stack[MMS_NEST_MAX];
+    int code = mms_type_open(_service, _type, _body, &stack[0]);
+    if (code < 0) {
+        return code;
+    }
+    int depth = 1;
+    while (depth > 0) {
+        type_frame_t *frame = &stack[depth - 1];
+        if (xtlv_left(&frame->components) == 0) {
+            depth--;
+            if (MMS_EVENTS(_service)) {
+                mms_emit_struct(_service, 0);
+            }
+            continue;
         }
-        _resp->delete = _data[idx++];
-        if (_data[idx++] != 0xa2) {
-            code = MMS_ERR_FLAG;
+        node_t *type = mms_node_create(
+                _service, NODE_TYPE_TYPE, &code);
+        if (code < 0) {
             break;
         }
-        ret = mms_parse_length(_data + idx, &length);
-        if (ret <= 0) {
+        if (type != NULL &&
+            xlist_append(frame->array, type) < 0) {
+            node_destroy(type);
+            code = MMS_ERR_MEMALLOC;
             break;
         }
-        idx += ret;
-        if (length != (_length - idx)) {
+        xtlv_t desc;
+        int typecode = mms_type_head(
+                _service, type, &frame->components, &desc);
+        if (typecode < 0) {
+            code = typecode;
             break;
         }
-        if (_data[idx++] != 0xa2) {
-            code = MMS_ERR_FLAG;
-            break;
+        if (typecode != 0xa2) {
+            code = mms_type_leaf(type, &desc, typecode);
+            if (code < 0) {
+                break;
+            }
+            continue;
         }
-        ret = mms_parse_length(_data + idx, &length);
-        if (ret <= 0) {
+        // complex structure
+        if (depth >= (int) _service->nest) {
+            code = MMS_ERR_DEPTH;
             break;
         }
-        idx += ret;
-        if (length != (_length - idx)) {
+        xtlv_t body;
+        if (xtlv_enter(&desc, 0xa2, &body) < 0) {
+            code = MMS_ERR_LENGTH;
             break;
         }
-        node_t *type = node_create(NODE_TYPE_TYPE);
-        if (type == NULL) {
-            code = MMS_ERR_MEMALLOC;
+        code = mms_type_open(_service, type, &body, &stack[depth]);
+        if (code < 0) {
             break;
         }
-        ret = mms_type_array(
-                type, _data + idx,
-                length, 1);
-        if (ret <= 0) {
-            code = MMS_ERR_DATANODE;
-            break;
+        depth++;
+    }
+    if (MMS_EVENTS(_service)) {
+        while (depth-- > 0) {
+            mms_emit_struct(_service, 0);
         }
-        idx += ret;
-        _resp->data.node = type;
-        service->index += idx;
+    }
+    return code;
+}
+
+static void mms_varattr_response(
+        response_t *_resp,
+        xtlv_t *_tlv) {
+    service_t *service = (service_t *) _resp;
+    unsigned int length = 0;
+    int ret = xtlv_expect(_tlv, 0x80, &length);
+    if (ret < 0 || length != 0x01) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
         return;
-    } while (0);
-    service->code = code;
-    service->index += idx;
+    }
+    _resp->delete = (unsigned char) xtlv_byte(_tlv);
+    xtlv_t spec;
+    ret = xtlv_enter(_tlv, 0xa2, &spec);
+    if (ret < 0 || xtlv_left(_tlv) != 0) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
+        return;
+    }
+    xtlv_t body;
+    ret = xtlv_enter(&spec, 0xa2, &body);
+    if (ret < 0 || xtlv_left(&spec) != 0) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
+        return;
+    }
+    node_t *type = mms_node_create(
+            service, NODE_TYPE_TYPE, &ret);
+    if (ret < 0) {
+        service->code = ret;
+        return;
+    }
+    if (mms_type_array(service, type, &body) < 0) {
+        node_destroy(type);
+        service->code = MMS_ERR_DATANODE;
+        return;
+    }
+    _resp->data.node = type;
 }
 
 static void mms_varattr_list_request(
         request_t *_request,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _request;
-    node_t *varspec = NULL;
-    int code = MMS_ERR_LENGTH;
-    int idx = 0;
-    unsigned int length = 0;
-    do {
-        int ret = mms_parse_length(
-                _data + idx, &length);
-        if (ret <= 0) {
-            break;
-        }
-        idx += ret;
-        if (length != (_length - idx)) {
-            break;
-        }
-        varspec = node_create(NODE_TYPE_VARSPEC);
-        if (varspec == NULL) {
-            code = MMS_ERR_MEMALLOC;
-            break;
-        }
-        ret = mms_parse_domain(_data + idx, varspec);
-        if (ret < 0) {
-            code = MMS_ERR_DOMAIN;
-            break;
-        }
-        idx += ret;
-        _request->data.node = varspec;
-        service->index += idx;
+    objname_t name;
+    if (mms_parse_domain(_tlv, &name) < 0) {
+        service->code = MMS_ERR_DOMAIN;
         return;
-    } while (0);
-    service->code = code;
-    service->index += idx;
-    node_destroy(varspec);
-    varspec = NULL;
+    }
+    if (MMS_EVENTS(service)) {
+        mms_emit_var(service, &name);
+        return;
+    }
+    node_t *varspec = node_create(NODE_TYPE_VARSPEC);
+    if (varspec == NULL) {
+        service->code = MMS_ERR_MEMALLOC;
+        return;
+    }
+    var_spec_domain(varspec, name.domain, name.domain_len);
+    var_spec_index(varspec, name.item, name.item_len);
+    _request->data.node = varspec;
 }
 
 static void mms_varattr_list_response(
         response_t *_resp,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _resp;
-    int idx = 0;
-    int code = MMS_ERR_LENGTH;
-    do {
-        unsigned int length = 0;
-        int ret = mms_parse_length(
-                _data + idx, &length);
-        if (ret <= 0) {
-            break;
-        }
-        idx += ret;
-        if (length != (_length - idx)) {
-            break;
-        }
-        if (_data[idx++] != 0x80) {
-            code = MMS_ERR_FLAG;
-            break;
-        }
-        if (_data[idx++] != 0x01) {
-            break;
-        }
-        // mms deletable
-        _resp->delete = _data[idx++];
-        // item list flag
-        if (_data[idx++] != 0xa1) {
-            code = MMS_ERR_FLAG;
-            break;
-        }
-        ret = mms_parse_length(
-                _data + idx, &length);
-        if (ret <= 0) {
-            break;
-        }
-        idx += ret;
-        if (length != (_length - idx)) {
+    unsigned int length = 0;
+    int ret = xtlv_expect(_tlv, 0x80, &length);
+    if (ret < 0 || length != 0x01) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
+        return;
+    }
+    // mms deletable
+    _resp->delete = (unsigned char) xtlv_byte(_tlv);
+    // item list flag
+    xtlv_t vars;
+    ret = xtlv_enter(_tlv, 0xa1, &vars);
+    if (ret < 0 || xtlv_left(_tlv) != 0) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
+        return;
+    }
+    xlist_t *list = mms_list_create(service, &ret);
+    if (ret < 0) {
+        service->code = ret;
+        return;
+    }
+    while (xtlv_left(&vars) > 0) {
+        objname_t name;
+        ret = mms_var_spec(&vars, &name);
+        if (ret < 0) {
+            service->code = ret;
             break;
         }
-        xlist_t *list = xlist_create();
-        if (list == NULL) {
-            code = MMS_ERR_MEMALLOC;
+        ret = mms_append_var(
+                service, list, NODE_TYPE_VARSPEC, &name);
+        if (ret < 0) {
+            service->code = ret;
             break;
         }
-        while (idx < _length) {
-            node_t *node = node_create(
-                    NODE_TYPE_VARSPEC);
-            if (node == NULL) {
-                code = MMS_ERR_MEMALLOC;
-                break;
-            }
-            ret = mms_var_spec(_data + idx, node);
-            if (ret < 0) {
-                code = ret;
-                node_destroy(node);
-                break;
-            }
-            idx += ret;
-            xlist_append(list, node);
-        }
-        _resp->data.list = list;
-        if (idx == _length) {
-            service->index += idx;
-            return;
-        }
-    } while (0);
-    service->code = code;
-    service->index += idx;
+    }
+    _resp->data.list = list;
 }
 
 // 解析文件请求服务
 static void mms_file_dir_request(
         request_t *_request,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _request;
-    node_t *directory = NULL;
-    int code = MMS_ERR_LENGTH;
-    int idx = 0;
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        goto filedir_request_exit;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        goto filedir_request_exit;
-    }
     // directory name list flag: 0xa0
-    if (_data[idx++] != 0xa0) {
-        service->code = MMS_ERR_FLAG;
-        goto filedir_request_exit;
-    }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        goto filedir_request_exit;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        goto filedir_request_exit;
+    xtlv_t names;
+    int ret = xtlv_enter(_tlv, 0xa0, &names);
+    if (ret < 0 || xtlv_left(_tlv) != 0) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
+        return;
     }
     // filename flag: 0x19
-    if (_data[idx++] != 0x19) {
-        code = MMS_ERR_FLAG;
-        goto filedir_request_exit;
+    unsigned int length = 0;
+    ret = xtlv_expect(&names, 0x19, &length);
+    if (ret < 0 || length != xtlv_left(&names)) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
+        return;
     }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        goto filedir_request_exit;
+    const char *path = (const char *) xtlv_bytes(&names, length);
+    if (MMS_EVENTS(service)) {
+        mms_emit_ident(service, path, length);
+        return;
     }
-    idx += ret;
-    directory = node_create(NODE_TYPE_FILESPEC);
+    node_t *directory = node_create(NODE_TYPE_FILESPEC);
     if (directory == NULL) {
-        code = MMS_ERR_MEMALLOC;
-        goto filedir_request_exit;
-    }
-    ret = file_spec_path(directory, (char *) _data + idx, length);
-    if (ret < 0) {
-        code = MMS_ERR_DATANODE;
-        goto filedir_request_exit;
+        service->code = MMS_ERR_MEMALLOC;
+        return;
     }
-    idx += (int) length;
-    if (idx == _length) {
-        service->index += idx;
-        _request->data.node = directory;
+    if (file_spec_path(directory, path, length) < 0) {
+        node_destroy(directory);
+        service->code = MMS_ERR_DATANODE;
         return;
     }
-    filedir_request_exit:
-    service->code = code;
-    service->index += idx;
-    node_destroy(directory);
-    directory = NULL;
+    _request->data.node = directory;
 }
 
 // 解析目录项
 static int mms_dir_entry(
-        const unsigned char *_data,
-        node_t *_entry) {
-    if (_data == NULL || _entry == NULL) {
+        xtlv_t *_tlv,
+        dirent_t *_entry) {
+    if (_tlv == NULL || _entry == NULL) {
         return MMS_ERR_NULL;
     }
-    int idx = 0;
     // directory entry flag: 0x30
-    if (_data[idx++] != 0x30) {
-        return MMS_ERR_FLAG;
-    }
-    unsigned int total_len = 0;
-    unsigned int length = 0;
-    int lensz = mms_parse_length(_data + idx, &length);
-    if (lensz <= 0) {
-        return MMS_ERR_LENGTH;
-    }
-    idx += lensz;
-    total_len = length + idx;
-    if (_data[idx++] != 0xa0) {
-        return MMS_ERR_FLAG;
-    }
-    unsigned int path_len = 0;
-    lensz = mms_parse_length(_data + idx, &length);
-    if (lensz <= 0) {
-        return MMS_ERR_LENGTH;
+    xtlv_t entry;
+    int ret = xtlv_enter(_tlv, 0x30, &entry);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    idx += lensz;
-    if (length >= total_len) {
-        return MMS_ERR_LENGTH;
+    xtlv_t path;
+    ret = xtlv_enter(&entry, 0xa0, &path);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    path_len = length;
     // file name flag: 0x19
-    if (_data[idx++] != 0x19) {
-        return MMS_ERR_FLAG;
-    }
-    lensz = mms_parse_length(_data + idx, &length);
-    if (lensz <= 0) {
-        return MMS_ERR_LENGTH;
+    unsigned int length = 0;
+    ret = xtlv_expect(&path, 0x19, &length);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    idx += lensz;
-    if (length != (path_len - lensz - 1)) {
+    if (length != xtlv_left(&path)) {
         return MMS_ERR_LENGTH;
     }
-    dir_entry_path(_entry, (char *) _data + idx, length);
-    idx += (int) length;
-    if (_data[idx++] != 0xa1) {
-        return MMS_ERR_FLAG;
-    }
-    lensz = mms_parse_length(_data + idx, &length);
-    if (lensz <= 0) {
-        return MMS_ERR_LENGTH;
+    _entry->name = (const char *) xtlv_bytes(&path, length);
+    _entry->length = length;
+    xtlv_t attr;
+    ret = xtlv_enter(&entry, 0xa1, &attr);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    idx += lensz;
-    if (length != (total_len - idx)) {
+    if (xtlv_left(&entry) != 0) {
         return MMS_ERR_LENGTH;
     }
-    if (_data[idx++] != 0x80) {
-        return MMS_ERR_FLAG;
+    ret = xtlv_expect(&attr, 0x80, &length);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    {
-        int len = _data[idx++];
-        int dataidx = 0;
-        unsigned int value = 0;
-        while (dataidx < len) {
-            value <<= 8;
-            value += _data[idx++];
-            dataidx++;
-        }
-        dir_entry_size(_entry, value);
+    if (xtlv_uint(&attr, length, &_entry->size) < 0) {
+        return MMS_ERR_LENGTH;
     }
-    if (_data[idx++] != 0x81) {
-        return MMS_ERR_FLAG;
+    ret = xtlv_expect(&attr, 0x81, &length);
+    if (ret < 0) {
+        return MMS_TLV_ERR(ret);
     }
-    if (_data[idx++] != 0x0f) {
+    if (length != 0x0f) {
         return MMS_ERR_LENGTH;
     }
-    dir_entry_stamp(_entry, (char *) (_data + idx));
-    idx += 0x0f;
-    return idx;
+    _entry->stamp = (const char *) xtlv_bytes(&attr, length);
+    return 0;
 }
 
 // 解析目录项服务响应报文
 static void mms_file_dir_response(
         response_t *_resp,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _resp;
-    int idx = 0;
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
     // directory entry list flag: 0xa0
-    if (_data[idx++] != 0xa0) {
-        service->code = MMS_ERR_FLAG;
-        service->index += idx;
+    xtlv_t list_of;
+    int ret = xtlv_enter(_tlv, 0xa0, &list_of);
+    if (ret < 0 || xtlv_left(_tlv) != 0) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
         return;
     }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
+    xtlv_t entries;
+    ret = xtlv_enter(&list_of, 0x30, &entries);
+    if (ret < 0 || xtlv_left(&list_of) != 0) {
+        service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
         return;
     }
-    idx += ret;
-    if (length != (_length - idx)) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
+    int code = 0;
+    xlist_t *list = mms_list_create(service, &code);
+    if (code < 0) {
+        service->code = code;
         return;
     }
-    unsigned int size = _data[idx++];
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        service->code = MMS_ERR_LENGTH;
-        service->index += idx;
-        return;
-    }
-    xlist_t *list = xlist_create();
-    if (list == NULL) {
-        service->code = MMS_ERR_MEMALLOC;
-        service->index += idx;
-        return;
-    }
-    while (idx < _length) {
-        node_t *entry = node_create(NODE_TYPE_DIRENTRY);
-        if (entry == NULL) {
+    while (xtlv_left(&entries) > 0) {
+        dirent_t dirent;
+        if (mms_dir_entry(&entries, &dirent) < 0) {
             break;
         }
-        ret = mms_dir_entry(_data + idx, entry);
-        if (ret <= 0) {
-            node_destroy(entry);
-            entry = NULL;
+        if (MMS_EVENTS(service)) {
+            mms_emit_entry(service, &dirent);
+            continue;
+        }
+        node_t *entry = node_create(NODE_TYPE_DIRENTRY);
+        if (entry == NULL) {
             break;
         }
-        idx += ret;
+        dir_entry_path(entry, dirent.name, dirent.length);
+        dir_entry_size(entry, dirent.size);
+        dir_entry_stamp(entry, dirent.stamp);
         xlist_append(list, entry);
     }
-    if (xlist_count(list) != size) {
+    // a partial directory is dropped
+    if (list != NULL && xtlv_left(&entries) != 0) {
         xlist_destroy(list);
         list = NULL;
     }
-    service->index += idx;
     _resp->data.list = list;
 }
 
 static void mms_fopen_request(
         request_t *_request,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _request;
-    node_t *req = NULL;
-    int code = MMS_ERR_LENGTH;
-    int idx = 0;
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        goto fopen_exit;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        goto fopen_exit;
-    }
     // file name list flag: 0xa0
-    if (_data[idx++] != 0xa0) {
-        code = MMS_ERR_FLAG;
-        goto fopen_exit;
-    }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        goto fopen_exit;
-    }
-    idx += ret;
-    if (_data[length + idx] != 0x81) {
-        goto fopen_exit;
+    xtlv_t names;
+    int ret = xtlv_enter(_tlv, 0xa0, &names);
+    if (ret < 0) {
+        service->code = MMS_TLV_ERR(ret);
+        return;
     }
     // filename flag: 0x19
-    if (_data[idx++] != 0x19) {
+    unsigned int length = 0;
+    ret = xtlv_expect(&names, 0x19, &length);
+    if (ret < 0) {
         // log: unknown file name flag
-        code = MMS_ERR_FLAG;
-        goto fopen_exit;
+        service->code = MMS_TLV_ERR(ret);
+        return;
     }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        goto fopen_exit;
+    const char *path = (const char *) xtlv_bytes(&names, length);
+    node_t *req = mms_node_create(
+            service, NODE_TYPE_FOPENREQ, &ret);
+    if (ret < 0) {
+        service->code = ret;
+        return;
     }
-    idx += ret;
-    req = node_create(NODE_TYPE_FOPENREQ);
-    if (req == NULL) {
-        code = MMS_ERR_MEMALLOC;
-        goto fopen_exit;
-    }
-    fopen_req_path(req, (char *) _data + idx, length);
-    idx += (int) length;
-    if (_data[idx++] != 0x81) {
-        code = MMS_ERR_FLAG;
-        goto fopen_exit;
-    }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        goto fopen_exit;
+    if (MMS_EVENTS(service)) {
+        mms_emit_ident(service, path, length);
     }
-    idx += ret;
-    if (length > sizeof(unsigned int)) {
-        goto fopen_exit;
+    fopen_req_path(req, path, length);
+    ret = xtlv_expect(_tlv, 0x81, &length);
+    if (ret < 0) {
+        node_destroy(req);
+        service->code = MMS_TLV_ERR(ret);
+        return;
     }
-    unsigned int int_idx = 0;
     unsigned int pos = 0;
-    while (int_idx < length) {
-        pos <<= 8;
-        pos += _data[idx + int_idx];
-        int_idx++;
+    if (xtlv_uint(_tlv, length, &pos) < 0) {
+        node_destroy(req);
+        service->code = MMS_ERR_LENGTH;
+        return;
     }
-    idx += (int) length;
     fopen_req_position(req, pos);
     _request->data.node = req;
-    service->index += idx;
-    return; // success
-    fopen_exit: // exit work
-    service->code = code;
-    service->index += idx;
-    node_destroy(req);
-    req = NULL;
 }
 
 static void mms_fopen_response(
         response_t *_resp,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _resp;
     node_t *resp = NULL;
     int code = MMS_ERR_LENGTH;
-    int idx = 0;
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        goto fopen_resp_exit;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        goto fopen_resp_exit;
-    }
-    if (_data[idx++] != 0x80) {
-        code = MMS_ERR_FLAG;
-        goto fopen_resp_exit;
-    }
-    length = _data[idx++];
-    if (length > sizeof(unsigned int)) {
-        goto fopen_resp_exit;
-    }
-    resp = node_create(NODE_TYPE_FOPENRESP);
-    if (resp == NULL) {
-        code = MMS_ERR_MEMALLOC;
-        goto fopen_resp_exit;
-    }
-    // frsm
-    unsigned int int_idx = 0;
-    unsigned int frsm = 0;
-    while (int_idx < length) {
-        frsm <<= 8;
-        frsm += _data[idx + int_idx];
-        int_idx++;
-    }
-    idx += (int) length;
-    fopen_resp_frsm(resp, frsm);
-    // file attr
-    if (_data[idx++] != 0xa1) {
-        code = MMS_ERR_FLAG;
-        goto fopen_resp_exit;
-    }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        goto fopen_resp_exit;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        goto fopen_resp_exit;
-    }
-    // file attr.size
-    if (_data[idx++] != 0x80) {
-        code = MMS_ERR_FLAG;
-        goto fopen_resp_exit;
-    }
-    length = _data[idx++];
-    if (length > sizeof(size_t)) {
-        goto fopen_resp_exit;
-    }
-    int_idx = 0;
-    size_t fsize = 0;
-    while (int_idx < length) {
-        fsize <<= 8;
-        fsize += _data[idx + int_idx];
-        int_idx++;
-    }
-    idx += (int) length;
-    // file attr.stamp
-    if (_data[idx++] != 0x81) {
-        code = MMS_ERR_FLAG;
-        goto fopen_resp_exit;
-    }
-    if (_data[idx++] != 0x0f) {
-        goto fopen_resp_exit;
-    }
-    fopen_resp_attr(resp, fsize, (char *) _data + idx);
-    idx += 0x0f;
-    _resp->data.node = resp;
-    service->index += idx;
-    return;
-    fopen_resp_exit: // exit work
+    do {
+        // frsm
+        unsigned int length = 0;
+        int ret = xtlv_expect(_tlv, 0x80, &length);
+        if (ret < 0) {
+            code = MMS_TLV_ERR(ret);
+            break;
+        }
+        unsigned int frsm = 0;
+        if (xtlv_uint(_tlv, length, &frsm) < 0) {
+            break;
+        }
+        resp = mms_node_create(
+                service, NODE_TYPE_FOPENRESP, &code);
+        if (code < 0) {
+            break;
+        }
+        code = MMS_ERR_LENGTH;
+        fopen_resp_frsm(resp, frsm);
+        // file attr
+        xtlv_t attr;
+        ret = xtlv_enter(_tlv, 0xa1, &attr);
+        if (ret < 0) {
+            code = MMS_TLV_ERR(ret);
+            break;
+        }
+        if (xtlv_left(_tlv) != 0) {
+            break;
+        }
+        // file attr.size
+        ret = xtlv_expect(&attr, 0x80, &length);
+        if (ret < 0) {
+            code = MMS_TLV_ERR(ret);
+            break;
+        }
+        if (length > sizeof(size_t)) {
+            break;
+        }
+        const unsigned char *data = xtlv_bytes(&attr, length);
+        size_t fsize = 0;
+        unsigned int int_idx = 0;
+        while (int_idx < length) {
+            fsize <<= 8;
+            fsize += data[int_idx++];
+        }
+        // file attr.stamp
+        ret = xtlv_expect(&attr, 0x81, &length);
+        if (ret < 0) {
+            code = MMS_TLV_ERR(ret);
+            break;
+        }
+        if (length != 0x0f) {
+            break;
+        }
+        data = xtlv_bytes(&attr, length);
+        fopen_resp_attr(resp, fsize, (const char *) data);
+        _resp->data.node = resp;
+        return;
+    } while (0);
     service->code = code;
-    service->index += idx;
     node_destroy(resp);
     resp = NULL;
 }
 
 static void mms_fread_request(
         request_t *_request,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _request;
-    node_t *req = NULL;
-    int code = MMS_ERR_LENGTH;
-    int idx = 0;
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        goto fread_request_exit;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        goto fread_request_exit;
-    }
-    if (length > sizeof(unsigned int)) {
-        goto fread_request_exit;
-    }
-    unsigned int int_idx = 0;
     unsigned int value = 0;
-    while (int_idx < length) {
-        value <<= 8;
-        value += _data[idx + int_idx];
-        int_idx++;
+    if (xtlv_uint(_tlv, (unsigned int) xtlv_left(_tlv),
+                  &value) < 0) {
+        service->code = MMS_ERR_LENGTH;
+        return;
     }
-    idx += (int) length;
-    req = node_create(NODE_TYPE_FREAD);
-    if (req == NULL) {
-        code = MMS_ERR_MEMALLOC;
-        goto fread_request_exit;
+    int code = 0;
+    node_t *req = mms_node_create(service, NODE_TYPE_FREAD, &code);
+    if (code < 0) {
+        service->code = code;
+        return;
     }
     fread_value(req, value);
     _request->data.node = req;
-    service->index += idx;
-    return;
-    fread_request_exit:
-    service->code = code;
-    service->index += idx;
-    node_destroy(req);
-    req = NULL;
 }
 
 static void mms_fread_response(
         response_t *_resp,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _resp;
-    node_t *resp = NULL;
-    int code = MMS_ERR_LENGTH;
-    int idx = 0;
     unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        goto fread_resp_exit;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        goto fread_resp_exit;
-    }
-    if (_data[idx++] != 0x80) {
-        code = MMS_ERR_FLAG;
-        goto fread_resp_exit;
-    }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        goto fread_resp_exit;
-    }
-    idx += ret;
-    if (length != (_length - idx) &&
-        _data[length + idx] != 0x81) {
-        goto fread_resp_exit;
+    int ret = xtlv_expect(_tlv, 0x80, &length);
+    if (ret < 0) {
+        service->code = MMS_TLV_ERR(ret);
+        return;
     }
-    resp = node_create(NODE_TYPE_FREADRESP);
-    if (resp == NULL) {
-        code = MMS_ERR_MEMALLOC;
-        goto fread_resp_exit;
+    const unsigned char *data = xtlv_bytes(_tlv, length);
+    node_t *resp = mms_node_create(
+            service, NODE_TYPE_FREADRESP, &ret);
+    if (ret < 0) {
+        service->code = ret;
+        return;
     }
     fread_resp_size(resp, length);
     if (length > 0) {
-        fread_resp_flag(resp, _data + idx, length, 1);
+        fread_resp_flag(resp, data, length, 1);
     }
     if (length > 8) {
-        fread_resp_flag(resp, _data + idx + length - 4, 4, 0);
+        fread_resp_flag(resp, data + length - 4, 4, 0);
     } else if (length > 4) {
-        fread_resp_flag(resp, _data + idx + 4, length - 4, 0);
-    }
-    idx += (int) length;
-    if (idx == _length) {
-        fread_resp_follow(resp, 1);
-        _resp->data.node = resp;
-        service->index += idx;
-        return;
-    }
-    if (_data[idx++] != 0x81) {
-        code = MMS_ERR_FLAG;
-        goto fread_resp_exit;
-    }
-    if (_data[idx++] != 0x01) {
-        goto fread_resp_exit;
-    }
-    if (_data[idx++] != 0x00) {
-        code = MMS_ERR_FLAG;
-        goto fread_resp_exit;
+        fread_resp_flag(resp, data + 4, length - 4, 0);
+    }
+    int follow = 1;
+    if (xtlv_left(_tlv) > 0) {
+        int code = MMS_ERR_LENGTH;
+        ret = xtlv_expect(_tlv, 0x81, &length);
+        if (ret == 0 && length == 0x01) {
+            follow = xtlv_byte(_tlv);
+            code = MMS_ERR_FLAG;
+        } else if (ret == XTLV_ERR_TAG) {
+            code = MMS_ERR_FLAG;
+        }
+        if (follow != 0) {
+            service->code = code;
+            node_destroy(resp);
+            return;
+        }
     }
-    fread_resp_follow(resp, 0);
+    fread_resp_follow(resp, follow);
     _resp->data.node = resp;
-    service->index += idx;
-    return;
-    fread_resp_exit:
-    service->code = code;
-    service->index += idx;
-    node_destroy(resp);
 }
 
 static void mms_fclose_request(
         request_t *_request,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _request;
-    node_t *fclose1 = NULL;
-    int code = MMS_ERR_LENGTH;
-    int idx = 0;
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        goto fclose_req_exit;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        goto fclose_req_exit;
-    }
-    if (length > sizeof(unsigned int)) {
-        goto fclose_req_exit;
-    }
-    unsigned int int_idx = 0;
     unsigned int value = 0;
-    while (int_idx < length) {
-        value <<= 8;
-        value += _data[idx + int_idx];
-        int_idx++;
+    if (xtlv_uint(_tlv, (unsigned int) xtlv_left(_tlv),
+                  &value) < 0) {
+        service->code = MMS_ERR_LENGTH;
+        return;
     }
-    idx += (int) length;
-    fclose1 = node_create(NODE_TYPE_FCLOSE);
-    if (fclose1 == NULL) {
-        code = MMS_ERR_MEMALLOC;
-        goto fclose_req_exit;
+    int code = 0;
+    node_t *fclose1 = mms_node_create(
+            service, NODE_TYPE_FCLOSE, &code);
+    if (code < 0) {
+        service->code = code;
+        return;
     }
     fclose_value(fclose1, 1, value);
     _request->data.node = fclose1;
-    service->index += idx;
-    return;
-    fclose_req_exit:
-    service->code = code;
-    service->index += idx;
-    node_destroy(fclose1);
-    fclose1 = NULL;
 }
 
 static void mms_fclose_response(
         response_t *_resp,
-        const unsigned char *_data,
-        size_t _length) {
+        xtlv_t *_tlv) {
     service_t *service = (service_t *) _resp;
-    node_t *fclose1 = NULL;
-    int idx = 0;
-    int code = MMS_ERR_NULL;
-    if (_data[idx++] != 0x00) {
-        code = MMS_ERR_FLAG;
-        goto fclose_resp_exit;
+    if (xtlv_left(_tlv) != 0) {
+        service->code = MMS_ERR_FLAG;
+        return;
     }
-    fclose1 = node_create(NODE_TYPE_FCLOSE);
-    if (fclose1 == NULL) {
-        goto fclose_resp_exit;
+    int code = 0;
+    node_t *fclose1 = mms_node_create(
+            service, NODE_TYPE_FCLOSE, &code);
+    if (code < 0) {
+        service->code = code;
+        return;
     }
     fclose_value(fclose1, 0, 0);
     _resp->data.node = fclose1;
-    service->index += idx;
-    return;
-    fclose_resp_exit:
-    service->code = code;
-    service->index += idx;
-    node_destroy(fclose1);
-    fclose1 = NULL;
 }
 
 /***************************************to_string***************************************/
 
 static int list_tostring(
-        xlist_t *_list, char *_dest, size_t _size,
+        const xlist_t *_list, char *_dest, size_t _size,
         const char *_header) {
     if (_list == NULL) {
         return 0;
@@ -2038,7 +1817,9 @@ static int list_tostring(
         strcpy(_dest + idx, data);
         idx += ret;
     }
-    node_t *node = xlist_begin(_list);
+    xlist_iter_t iter;
+    xlist_iter_init(&iter, _list);
+    const node_t *node = xlist_iter_next(&iter);
     while (node && idx < (_size - 1)) {
         _dest[idx++] = '\n';
         int ret = node_tostring(
@@ -2048,7 +1829,46 @@ static int list_tostring(
             break;
         }
         idx += ret;
-        node = xlist_next(_list);
+        node = xlist_iter_next(&iter);
+    }
+    if (idx >= (_size - 1)) {
+        idx = (int) _size - 1;
+        return idx;
+    }
+    _dest[idx++] = '\n';
+    _dest[idx] = 0;
+    return idx;
+}
+
+// render the top level cells one per line like list_tostring
+static int cells_tostring(
+        const xcells_t *_cells, char *_dest, size_t _size,
+        const char *_header) {
+    if (_cells == NULL) {
+        return 0;
+    }
+    int idx = 0;
+    if (_header != NULL && _header[0] != 0) {
+        const char *data = xtrans(_header);
+        int ret = (int) strlen(data);
+        if (ret >= _size) {
+            return 0;
+        }
+        strcpy(_dest + idx, data);
+        idx += ret;
+    }
+    const xcell_t *cell = _cells->cells;
+    const xcell_t *end = _cells->cells + _cells->count;
+    while (cell < end && idx < (_size - 1)) {
+        _dest[idx++] = '\n';
+        int ret = xcell_to_string(
+                cell, _dest + idx, _size - idx);
+        if (ret < 0) {
+            _dest[idx] = 0;
+            break;
+        }
+        idx += ret;
+        cell = xcell_skip(cell);
     }
     if (idx >= (_size - 1)) {
         idx = (int) _size - 1;
@@ -2328,9 +2148,16 @@ static int filedir_response_tostring(
 static int read_response_tostring(
         const response_t *_resp,
         char *_dest, size_t _size) {
-    int ret = list_tostring(
-            _resp->data.list, _dest,
-            _size, "readVarResponse:{");
+    int ret = 0;
+    if (_resp->cells != NULL) {
+        ret = cells_tostring(
+                _resp->cells, _dest,
+                _size, "readVarResponse:{");
+    } else {
+        ret = list_tostring(
+                _resp->data.list, _dest,
+                _size, "readVarResponse:{");
+    }
     if (ret <= 0) {
         _dest[0] = 0;
         return ret;
@@ -2374,26 +2201,22 @@ static int init_tostring(
     return node_tostring(init->data, _dest, _size);
 }
 
-typedef struct req_tostr_t {
-    int req;
-
-    int (*tostring)(const request_t *, char *, size_t);
-} req_tostr_t;
+typedef int (*req_tostr_t)(const request_t *, char *, size_t);
 
 static int request_tostring(
         const service_t *_service,
         char *_dest, size_t _size) {
-    static const req_tostr_t g_req2str[] = {
-            {MMS_SERVICE_VARATTR, varattr_request_tostring},
-            {MMS_SERVICE_VARIDX,  varattrs_request_tostring},
-            {MMS_SERVICE_NAMES,   names_request_tostring},
-            {MMS_SERVICE_WRITE,   writ_request_tostring},
-            {MMS_SERVICE_READ,    read_request_tostring},
-            {MMS_SERVICE_FILEDIR, filedir_request_tostring},
-            {MMS_SERVICE_FOPEN,   node_request_tostring},
-            {MMS_SERVICE_FREAD,   node_request_tostring},
-            {MMS_SERVICE_FCLOSE,  node_request_tostring},
-            {0, NULL},
+    // indexed by the service tag
+    static const req_tostr_t g_req2str[256] = {
+            [MMS_SERVICE_VARATTR] = varattr_request_tostring,
+            [MMS_SERVICE_VARIDX] = varattrs_request_tostring,
+            [MMS_SERVICE_NAMES] = names_request_tostring,
+            [MMS_SERVICE_WRITE] = writ_request_tostring,
+            [MMS_SERVICE_READ] = read_request_tostring,
+            [MMS_SERVICE_FILEDIR] = filedir_request_tostring,
+            [MMS_SERVICE_FOPEN] = node_request_tostring,
+            [MMS_SERVICE_FREAD] = node_request_tostring,
+            [MMS_SERVICE_FCLOSE] = node_request_tostring,
     };
     if (_service == NULL ||
         _dest == NULL || _size == 0) {
@@ -2403,39 +2226,29 @@ static int request_tostring(
         return MMS_ERR_MSGTYPE;
     }
     request_t *req = (request_t *) _service;
-    const req_tostr_t *req2str = g_req2str;
-    while (req2str->tostring) {
-        if (req2str->req == req->type) {
-            break;
-        }
-        req2str++;
-    }
-    if (req2str->tostring == NULL) {
+    if (req->type < 0 || req->type > 0xff ||
+        g_req2str[req->type] == NULL) {
         return MMS_ERR_REQTYPE;
     }
-    return req2str->tostring(req, _dest, _size);
+    return g_req2str[req->type](req, _dest, _size);
 }
 
-typedef struct resp_tostr_t {
-    int resp;
-
-    int (*tostring)(const response_t *, char *, size_t);
-} resp_tostr_t;
+typedef int (*resp_tostr_t)(const response_t *, char *, size_t);
 
 static int response_tostring(
         const service_t *_service,
         char *_dest, size_t _size) {
-    static const resp_tostr_t g_resp2str[] = {
-            {MMS_SERVICE_VARATTR, varattr_response_tostring},
-            {MMS_SERVICE_VARIDX,  varattrs_response_tostring},
-            {MMS_SERVICE_NAMES,   names_response_tostring},
-            {MMS_SERVICE_WRITE,   writ_response_tostring},
-            {MMS_SERVICE_READ,    read_response_tostring},
-            {MMS_SERVICE_FILEDIR, filedir_response_tostring},
-            {MMS_SERVICE_FOPEN,   node_response_tostring},
-            {MMS_SERVICE_FREAD,   node_response_tostring},
-            {MMS_SERVICE_FCLOSE,  node_response_tostring},
-            {0, NULL},
+    // indexed by the service tag
+    static const resp_tostr_t g_resp2str[256] = {
+            [MMS_SERVICE_VARATTR] = varattr_response_tostring,
+            [MMS_SERVICE_VARIDX] = varattrs_response_tostring,
+            [MMS_SERVICE_NAMES] = names_response_tostring,
+            [MMS_SERVICE_WRITE] = writ_response_tostring,
+            [MMS_SERVICE_READ] = read_response_tostring,
+            [MMS_SERVICE_FILEDIR] = filedir_response_tostring,
+            [MMS_SERVICE_FOPEN] = node_response_tostring,
+            [MMS_SERVICE_FREAD] = node_response_tostring,
+            [MMS_SERVICE_FCLOSE] = node_response_tostring,
     };
     if (_service == NULL ||
         _dest == NULL || _size == 0) {
@@ -2445,17 +2258,11 @@ static int response_tostring(
         return MMS_ERR_MSGTYPE;
     }
     response_t *resp = (response_t *) _service;
-    const resp_tostr_t *resp2str = g_resp2str;
-    while (resp2str->tostring) {
-        if (resp2str->resp == resp->type) {
-            break;
-        }
-        resp2str++;
-    }
-    if (resp2str->tostring == NULL) {
+    if (resp->type < 0 || resp->type > 0xff ||
+        g_resp2str[resp->type] == NULL) {
         return MMS_ERR_RESPTYPE;
     }
-    return resp2str->tostring(resp, _dest, _size);
+    return g_resp2str[resp->type](resp, _dest, _size);
 }
 
 static int report_tostring(
@@ -2468,10 +2275,17 @@ static int report_tostring(
     if (_service->type != MMS_MSG_REPORT) {
         return MMS_ERR_MSGTYPE;
     }
-    report_t *report = (report_t *) _service;
-    int ret = list_tostring(
-            report->data, _dest,
-            _size, "infoReport:{");
+    const report_t *report = (const report_t *) _service;
+    int ret = 0;
+    if (report->cells != NULL) {
+        ret = cells_tostring(
+                report->cells, _dest,
+                _size, "infoReport:{");
+    } else {
+        ret = list_tostring(
+                report->data, _dest,
+                _size, "infoReport:{");
+    }
     if (ret <= 0) {
         _dest[0] = 0;
         return ret;
@@ -2483,6 +2297,13 @@ static int report_tostring(
     return ret;
 }
 
+// a pdu of unknown type, only the service itself
+static int unknown_destroy(service_t *_service) {
+    xmem_free(_service);
+    _service = NULL;
+    return 0;
+}
+
 static int init_destroy(service_t *_service) {
     if (_service == NULL) {
         return 0;
@@ -2494,7 +2315,7 @@ static int init_destroy(service_t *_service) {
     initdata_t *init = (initdata_t *) _service;
     node_destroy(init->data);
     init->data = NULL;
-    free(_service);
+    xmem_free(_service);
     _service = NULL;
     return 0;
 }
@@ -2509,7 +2330,9 @@ static int report_destroy(service_t *_service) {
     report_t *report = (report_t *) _service;
     xlist_destroy(report->data);
     report->data = NULL;
-    free(_service);
+    xcells_destroy(report->cells);
+    report->cells = NULL;
+    xmem_free(_service);
     _service = NULL;
     return 0;
 }
@@ -2535,10 +2358,10 @@ static int request_destroy(service_t *_service) {
                request->type == MMS_SERVICE_READ) {
         xlist_destroy(request->data.list);
         request->data.list = NULL;
-    } else {
+    } else if (request->type != 0) {
         return MMS_ERR_REQTYPE;
     }
-    free(_service);
+    xmem_free(_service);
     _service = NULL;
     return 0;
 }
@@ -2558,16 +2381,18 @@ static int response_destroy(service_t *_service) {
         resp->type == MMS_SERVICE_VARIDX) {
         xlist_destroy(resp->data.list);
         resp->data.list = NULL;
+        xcells_destroy(resp->cells);
+        resp->cells = NULL;
     } else if (resp->type == MMS_SERVICE_VARATTR ||
                resp->type == MMS_SERVICE_FOPEN ||
                resp->type == MMS_SERVICE_FREAD ||
                resp->type == MMS_SERVICE_FCLOSE) {
         node_destroy(resp->data.node);
         resp->data.node = NULL;
-    } else {
+    } else if (resp->type != 0) {
         return MMS_ERR_RESPTYPE;
     }
-    free(_service);
+    xmem_free(_service);
     _service = NULL;
     return 0;
 }
@@ -2576,130 +2401,101 @@ static void mms_parse_initdata(
         service_t *_service,
         const unsigned char *_data,
         size_t _length) {
-    node_t *data = NULL;
-    int idx = 0;
-    int ret = _data[idx++];
+    xtlv_t tlv;
+    xtlv_init(&tlv, _data, _length);
+    int ret = xtlv_byte(&tlv);
     if ((ret != MMS_MSG_INIT_REQ ||
          _service->type != MMS_MSG_INIT_REQ) &&
         (ret != MMS_MSG_INIT_RESP ||
          _service->type != MMS_MSG_INIT_RESP)) {
         _service->code = MMS_ERR_MSGTYPE;
-        _service->index = idx;
+        _service->index = 1;
         return;
     }
     initdata_t *init = (initdata_t *) _service;
-    data = node_create(NODE_TYPE_INIT);
-    if (data == NULL) {
-        _service->code = MMS_ERR_MEMALLOC;
-        _service->index = idx;
+    int code = 0;
+    node_t *data = mms_node_create(_service, NODE_TYPE_INIT, &code);
+    if (code < 0) {
+        _service->code = code;
+        _service->index = 1;
         return;
     }
+    mms_emit_pdu(_service, 0, 0);
     unsigned int length = 0;
-    int code = MMS_ERR_LENGTH;
+    code = MMS_ERR_LENGTH;
     do {
-        ret = mms_parse_length(_data + idx, &length);
-        if (ret < 0) {
-            break;
-        }
-        idx += ret;
-        if (length != (_length - idx)) {
+        xtlv_t pdu;
+        if (xtlv_contents(&tlv, &pdu) < 0 ||
+            xtlv_left(&tlv) != 0) {
             break;
         }
+        tlv = pdu;
         // local detail calling flag
-        if (_data[idx++] != 0x80) {
-            code = MMS_ERR_FLAG;
-            break;
-        }
-        length = _data[idx++];
-        if (length > sizeof(unsigned int)) {
+        ret = xtlv_expect(&tlv, 0x80, &length);
+        if (ret < 0) {
+            code = MMS_TLV_ERR(ret);
             break;
         }
-        ret = 0;
         unsigned int value = 0;
-        while (ret < length) {
-            value <<= 8;
-            value += _data[idx + ret];
-            ret++;
+        if (xtlv_uint(&tlv, length, &value) < 0) {
+            break;
         }
-        idx += ret;
         init_detail_called(data, value);
         // max serv outstanding calling flag
-        if (_data[idx++] != 0x81) {
-            code = MMS_ERR_FLAG;
-            break;
-        }
-        if (_data[idx++] != 0x01) {
+        ret = xtlv_expect(&tlv, 0x81, &length);
+        if (ret < 0 || length != 0x01) {
+            code = MMS_TLV_ERR(ret);
             break;
         }
-        value = _data[idx++];
-        init_max_calling(data, value);
+        init_max_calling(data, xtlv_byte(&tlv));
         // max serv outstanding called flag
-        if (_data[idx++] != 0x82) {
-            code = MMS_ERR_FLAG;
-            break;
-        }
-        if (_data[idx++] != 0x01) {
+        ret = xtlv_expect(&tlv, 0x82, &length);
+        if (ret < 0 || length != 0x01) {
+            code = MMS_TLV_ERR(ret);
             break;
         }
-        value = _data[idx++];
-        init_max_called(data, value);
+        init_max_called(data, xtlv_byte(&tlv));
         // data structure nesting level
-        if (_data[idx++] != 0x83) {
-            code = MMS_ERR_FLAG;
-            break;
-        }
-        if (_data[idx++] != 0x01) {
-            code = MMS_ERR_LENGTH;
+        ret = xtlv_expect(&tlv, 0x83, &length);
+        if (ret < 0 || length != 0x01) {
+            code = MMS_TLV_ERR(ret);
             break;
         }
-        value = _data[idx++];
-        init_struct_nest(data, value);
+        init_struct_nest(data, xtlv_byte(&tlv));
         // init detail
-        if (_data[idx++] != 0xa4) {
-            code = MMS_ERR_FLAG;
-            break;
-        }
-        ret = mms_parse_length(_data + idx, &length);
-        if (ret <= 0) {
-            break;
-        }
-        idx += ret;
-        if (length != (_length - idx)) {
-            break;
-        }
-        if (_data[idx++] != 0x80) {
-            code = MMS_ERR_FLAG;
-            break;
-        }
-        if (_data[idx++] != 0x01) {
+        xtlv_t detail;
+        ret = xtlv_enter(&tlv, 0xa4, &detail);
+        if (ret < 0) {
+            code = MMS_TLV_ERR(ret);
             break;
         }
-        value = _data[idx++];
-        init_version(data, value);
-        if (_data[idx++] != 0x81) {
-            code = MMS_ERR_FLAG;
+        if (xtlv_left(&tlv) != 0) {
             break;
         }
-        if (_data[idx++] != 0x03) {
+        ret = xtlv_expect(&detail, 0x80, &length);
+        if (ret < 0 || length != 0x01) {
+            code = MMS_TLV_ERR(ret);
             break;
         }
-        init_param_cbb(data, _data + idx);
-        idx += 0x03;
-        if (_data[idx++] != 0x82) {
-            code = MMS_ERR_FLAG;
+        init_version(data, xtlv_byte(&detail));
+        ret = xtlv_expect(&detail, 0x81, &length);
+        if (ret < 0 || length != 0x03) {
+            code = MMS_TLV_ERR(ret);
             break;
         }
-        if (_data[idx++] != 0x0c) {
+        init_param_cbb(data, xtlv_bytes(&detail, length));
+        ret = xtlv_expect(&detail, 0x82, &length);
+        if (ret < 0 || length != 0x0c) {
+            code = MMS_TLV_ERR(ret);
             break;
         }
-        init_services(data, _data + idx);
-        idx += 0x0c;
-        _service->index = idx;
+        init_services(data, xtlv_bytes(&detail, length));
+        _service->index = (unsigned int) (detail.data - _data);
         init->data = data;
         return;
     } while (0);
     _service->code = code;
-    _service->index = idx;
+    _service->index = (unsigned int) (tlv.data - _data);
     node_destroy(data);
     data = NULL;
 }
@@ -2708,343 +2504,823 @@ static void mms_parse_report(
         service_t *_service,
         const unsigned char *_data,
         size_t _length) {
-    int idx = 0;
-    if (_data[idx++] != MMS_MSG_REPORT ||
+    xtlv_t tlv;
+    xtlv_init(&tlv, _data, _length);
+    if (xtlv_byte(&tlv) != MMS_MSG_REPORT ||
         _service->type != MMS_MSG_REPORT) {
         _service->code = MMS_ERR_MSGTYPE;
-        _service->index = idx;
-        return;
-    }
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        _service->code = MMS_ERR_LENGTH;
-        _service->index = idx;
+        _service->index = 1;
         return;
     }
-    idx += ret;
-    if (length != (_length - idx)) {
+    xtlv_t pdu;
+    if (xtlv_contents(&tlv, &pdu) < 0 ||
+        xtlv_left(&tlv) != 0) {
         _service->code = MMS_ERR_LENGTH;
-        _service->index = idx;
+        _service->index = 1;
         return;
     }
-    if (_data[idx++] != 0xa0) {
-        _service->code = MMS_ERR_FLAG;
-        _service->index = idx;
+    tlv = pdu;
+    unsigned int length = 0;
+    xtlv_t body;
+    int ret = xtlv_enter(&tlv, 0xa0, &body);
+    if (ret < 0 || xtlv_left(&tlv) != 0) {
+        _service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
+        _service->index = (unsigned int) (tlv.data - _data);
         return;
     }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        _service->code = MMS_ERR_LENGTH;
-        _service->index = idx;
-        return;
+    // report name "RPT"
+    xtlv_t name;
+    ret = xtlv_enter(&body, 0xa1, &name);
+    if (ret == 0) {
+        ret = xtlv_expect(&name, 0x80, &length);
     }
-    idx += ret;
-    if (length != (_length - idx)) {
-        _service->code = MMS_ERR_LENGTH;
-        _service->index = idx;
-        return;
-    }
-    {
-        unsigned char flags[] = {
-                0xa1, 0x05, 0x80,
-                0x03, 0x52, 0x50, 0x54
-        };
-        int fsize = sizeof(flags);
-        int fidx = 0;
-        while (fidx < fsize) {
-            if (_data[idx++] != flags[fidx]) {
-                _service->code = MMS_ERR_FLAG;
-                _service->index = idx;
-                return;
-            }
-            fidx++;
-        }
+    const unsigned char *rpt = NULL;
+    if (ret == 0 && length == 0x03 && xtlv_left(&name) == 0x03) {
+        rpt = xtlv_bytes(&name, length);
     }
-    // report list flag
-    if (_data[idx++] != 0xa0) {
+    if (rpt == NULL || memcmp(rpt, "RPT", 3) != 0) {
         _service->code = MMS_ERR_FLAG;
-        _service->index = idx;
-        return;
-    }
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        _service->code = MMS_ERR_LENGTH;
-        _service->index = idx;
+        _service->index = (unsigned int) (body.data - _data);
         return;
     }
-    idx += ret;
-    if (length != (_length - idx)) {
-        _service->code = MMS_ERR_LENGTH;
-        _service->index = idx;
+    // report list flag
+    xtlv_t values;
+    ret = xtlv_enter(&body, 0xa0, &values);
+    if (ret < 0 || xtlv_left(&body) != 0) {
+        _service->code = ret < 0 ? MMS_TLV_ERR(ret) : MMS_ERR_LENGTH;
+        _service->index = (unsigned int) (body.data - _data);
         return;
     }
+    _service->index = (unsigned int) (values.data - _data);
     report_t *report = (report_t *) _service;
+    int code = 0;
     if (report->data == NULL) {
-        report->data = xlist_create();
+        report->data = mms_list_create(_service, &code);
     }
-    if (report->data == NULL) {
-        _service->code = MMS_ERR_MEMALLOC;
-        _service->index = idx;
+    if (code < 0) {
+        _service->code = code;
         return;
     }
-    while (idx < _length) {
-        node_t *var = node_create(NODE_TYPE_UDATA);
-        if (var == NULL) {
-            break;
-        }
+    mms_emit_pdu(_service, 0, 0);
+    compact_t compact;
+    code = mms_compact_begin(_service, &compact);
+    if (code < 0) {
+        _service->code = code;
+        return;
+    }
+    while (xtlv_left(&values) > 0) {
         xvalue_t value;
         memset(&value, 0, sizeof(xvalue_t));
-        ret = mms_data_value(_data + idx, &value, 1);
-        if (ret <= 0) {
-            node_destroy(var);
-            var = NULL;
+        if (mms_data_value(_service, &values, &value) < 0) {
             _service->code = MMS_ERR_FLAG;
             break;
         }
-        idx += ret;
-        udata_value(var, &value);
-        xlist_append(report->data, var);
+        if (mms_append_value(_service, report->data, &value) < 0) {
+            break;
+        }
     }
-    _service->index = idx;
+    _service->index = (unsigned int) (values.data - _data);
+    report->cells = mms_compact_end(_service, &compact);
 }
 
-typedef struct reqfunc_t {
-    int req;
+// enter a confirmed pdu of type _type up to the length of its
+// service, return the service tag or the parsing error
+static int mms_parse_confirmed(
+        int _type, xtlv_t *_tlv, unsigned int *_invoke) {
+    if (xtlv_byte(_tlv) != _type) {
+        return MMS_ERR_MSGTYPE;
+    }
+    xtlv_t pdu;
+    if (xtlv_contents(_tlv, &pdu) < 0 ||
+        xtlv_left(_tlv) != 0) {
+        return MMS_ERR_LENGTH;
+    }
+    (*_tlv) = pdu;
+    if (mms_parse_invoke(_tlv, _invoke) < 0) {
+        return MMS_ERR_INVOKE;
+    }
+    int code = xtlv_peek(_tlv);
+    if (code == 0xbf || code == 0x9f) {
+        xtlv_byte(_tlv);
+    }
+    code = xtlv_byte(_tlv);
+    if (code < 0) {
+        return MMS_ERR_LENGTH;
+    }
+    return code;
+}
 
-    void (*func)(request_t *, const unsigned char *, size_t);
-} reqfunc_t;
+typedef void (*reqfunc_t)(request_t *, xtlv_t *);
 
 static void mms_parse_request(
         service_t *_service,
         const unsigned char *_data,
         size_t _length) {
-    static const reqfunc_t g_reqfunc[] = {
-            {MMS_SERVICE_NAMES,   mms_getnamelist_request},
-            {MMS_SERVICE_VARATTR, mms_varattr_request},
-            {MMS_SERVICE_VARIDX,  mms_varattr_list_request},
-            {MMS_SERVICE_WRITE,   mms_write_request},
-            {MMS_SERVICE_READ,    mms_read_request},
-            {MMS_SERVICE_FILEDIR, mms_file_dir_request},
-            {MMS_SERVICE_FOPEN,   mms_fopen_request},
-            {MMS_SERVICE_FREAD,   mms_fread_request},
-            {MMS_SERVICE_FCLOSE,  mms_fclose_request},
-            {0,                   0},
+    // indexed by the service tag
+    static const reqfunc_t g_reqfunc[256] = {
+            [MMS_SERVICE_NAMES] = mms_getnamelist_request,
+            [MMS_SERVICE_VARATTR] = mms_varattr_request,
+            [MMS_SERVICE_VARIDX] = mms_varattr_list_request,
+            [MMS_SERVICE_WRITE] = mms_write_request,
+            [MMS_SERVICE_READ] = mms_read_request,
+            [MMS_SERVICE_FILEDIR] = mms_file_dir_request,
+            [MMS_SERVICE_FOPEN] = mms_fopen_request,
+            [MMS_SERVICE_FREAD] = mms_fread_request,
+            [MMS_SERVICE_FCLOSE] = mms_fclose_request,
     };
-    int idx = 0;
-    if (_data[idx++] != MMS_MSG_REQUEST ||
-        _service->type != MMS_MSG_REQUEST) {
+    if (_service->type != MMS_MSG_REQUEST) {
         // log::error not request message
         _service->code = MMS_ERR_MSGTYPE;
-        _service->index = idx;
-        return;
-    }
-    unsigned int length = 0;
-    int ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        // log::error request length
-        _service->code = MMS_ERR_LENGTH;
-        _service->index = idx;
-        return;
-    }
-    idx += ret;
-    if (length != (_length - idx)) {
-        // log::error request length
-        _service->code = MMS_ERR_LENGTH;
-        _service->index = idx;
+        _service->index = 1;
         return;
     }
-    unsigned int invoke = 0;
-    ret = mms_parse_invoke(_data + idx, &invoke);
-    if (ret <= 0) {
-        // log::error invoke id
-        _service->code = MMS_ERR_INVOKE;
-        _service->index = idx;
-    }
-    idx += ret;
+    xtlv_t tlv;
+    xtlv_init(&tlv, _data, _length);
     request_t *request = (request_t *) _service;
-    request->invoke = invoke;
-    if (_data[idx] == 0xbf ||
-        _data[idx] == 0x9f) {
-        idx++;
-    }
-    const reqfunc_t *reqfunc = g_reqfunc;
-    int reqcode = _data[idx++];
-    while (reqfunc->func) {
-        if (reqfunc->req == reqcode) {
-            break;
-        }
-        reqfunc++;
+    int reqcode = mms_parse_confirmed(
+            MMS_MSG_REQUEST, &tlv, &request->invoke);
+    _service->index = (unsigned int) (tlv.data - _data);
+    if (reqcode < 0) {
+        // log::error request header
+        _service->code = reqcode;
+        return;
     }
-    _service->index = idx;
-    if (reqfunc->func == NULL) {
+    reqfunc_t reqfunc = g_reqfunc[reqcode];
+    if (reqfunc == NULL) {
         // log::error unknown request type
         _service->code = MMS_ERR_REQTYPE;
         return;
     }
     request->type = reqcode;
-    reqfunc->func(request, _data + idx, _length - idx);
+    mms_emit_pdu(_service, request->invoke, reqcode);
+    xtlv_t body;
+    if (xtlv_contents(&tlv, &body) < 0 ||
+        xtlv_left(&tlv) != 0) {
+        _service->code = MMS_ERR_LENGTH;
+        return;
+    }
+    reqfunc(request, &body);
+    _service->index = (unsigned int) (body.data - _data);
 }
 
-typedef struct respfunc_t {
-    int resp;
-
-    void (*func)(response_t *, const unsigned char *, size_t);
-} respfunc_t;
+typedef void (*respfunc_t)(response_t *, xtlv_t *);
 
 static void mms_parse_response(
         service_t *_service,
         const unsigned char *_data,
         size_t _length) {
-    static const respfunc_t g_respfunc[] = {
-            {MMS_SERVICE_NAMES,   mms_getnamelist_response},
-            {MMS_SERVICE_VARATTR, mms_varattr_response},
-            {MMS_SERVICE_VARIDX,  mms_varattr_list_response},
-            {MMS_SERVICE_WRITE,   mms_write_response},
-            {MMS_SERVICE_READ,    mms_read_response},
-            {MMS_SERVICE_FILEDIR, mms_file_dir_response},
-            {MMS_SERVICE_FOPEN,   mms_fopen_response},
-            {MMS_SERVICE_FREAD,   mms_fread_response},
-            {MMS_SERVICE_FCLOSE,  mms_fclose_response},
-            {0,                   0},
+    // indexed by the service tag
+    static const respfunc_t g_respfunc[256] = {
+            [MMS_SERVICE_NAMES] = mms_getnamelist_response,
+            [MMS_SERVICE_VARATTR] = mms_varattr_response,
+            [MMS_SERVICE_VARIDX] = mms_varattr_list_response,
+            [MMS_SERVICE_WRITE] = mms_write_response,
+            [MMS_SERVICE_READ] = mms_read_response,
+            [MMS_SERVICE_FILEDIR] = mms_file_dir_response,
+            [MMS_SERVICE_FOPEN] = mms_fopen_response,
+            [MMS_SERVICE_FREAD] = mms_fread_response,
+            [MMS_SERVICE_FCLOSE] = mms_fclose_response,
     };
-    int idx = 0;
-    if (_data[idx++] != MMS_MSG_RESPONSE) {
-        // log::error not request message
-        _service->code = MMS_ERR_MSGTYPE;
-        _service->index = idx;
+    xtlv_t tlv;
+    xtlv_init(&tlv, _data, _length);
+    response_t *resp = (response_t *) _service;
+    int respcode = mms_parse_confirmed(
+            MMS_MSG_RESPONSE, &tlv, &resp->invoke);
+    _service->index = (unsigned int) (tlv.data - _data);
+    if (respcode < 0) {
+        // log::error response header
+        _service->code = respcode;
         return;
     }
-    int ret = 0;
-    unsigned int length = 0;
-    ret = mms_parse_length(_data + idx, &length);
-    if (ret <= 0) {
-        // log::error request length
-        _service->code = MMS_ERR_LENGTH;
-        _service->index = idx;
+    respfunc_t respfunc = g_respfunc[respcode];
+    if (respfunc == NULL) {
+        // log::error unknown response type
+        _service->code = MMS_ERR_RESPTYPE;
         return;
     }
-    idx += ret;
-    if (length != (_length - idx)) {
-        // log::error request length
+    resp->type = respcode;
+    mms_emit_pdu(_service, resp->invoke, respcode);
+    xtlv_t body;
+    if (xtlv_contents(&tlv, &body) < 0 ||
+        xtlv_left(&tlv) != 0) {
         _service->code = MMS_ERR_LENGTH;
-        _service->index = idx;
         return;
     }
-    unsigned int invoke = 0;
-    ret = mms_parse_invoke(_data + idx, &invoke);
-    if (ret <= 0) {
-        // log::error invoke id
-        _service->code = MMS_ERR_INVOKE;
-        _service->index = idx;
+    respfunc(resp, &body);
+    _service->index = (unsigned int) (body.data - _data);
+}
+
+// limit of the structure nesting, 0 for the default
+static unsigned int mms_nest_limit(unsigned int _nest) {
+    if (_nest == 0) {
+        return MMS_NEST_DEFAULT;
     }
-    idx += ret;
-    response_t *resp = (response_t *) _service;
-    resp->invoke = invoke;
-    if (_data[idx] == 0xbf ||
-        _data[idx] == 0x9f) {
-        idx++;
-    }
-    const respfunc_t *respfunc = g_respfunc;
-    int respcode = _data[idx++];
-    while (respfunc->func) {
-        if (respfunc->resp == respcode) {
-            break;
-        }
-        respfunc++;
+    if (_nest > MMS_NEST_MAX) {
+        return MMS_NEST_MAX;
     }
-    _service->index = idx;
-    if (respfunc->func == NULL) {
-        // log::error unknown response type
-        _service->code = MMS_ERR_RESPTYPE;
-        return;
+    return _nest;
+}
+
+// a kind of pdu: the size of its service, its operations
+// and its decoder
+typedef struct pdu_kind_t {
+    size_t size;
+    service_op_t op;
+
+    void (*parse)(service_t *, const unsigned char *, size_t);
+} pdu_kind_t;
+
+// kinds of pdus indexed by their tag
+static const pdu_kind_t g_pdu_kind[256] = {
+        [MMS_MSG_REQUEST] = {
+                sizeof(request_t),
+                {request_destroy, request_tostring},
+                mms_parse_request,
+        },
+        [MMS_MSG_RESPONSE] = {
+                sizeof(response_t),
+                {response_destroy, response_tostring},
+                mms_parse_response,
+        },
+        [MMS_MSG_REPORT] = {
+                sizeof(report_t),
+                {report_destroy, report_tostring},
+                mms_parse_report,
+        },
+        [MMS_MSG_INIT_REQ] = {
+                sizeof(initdata_t),
+                {init_destroy, init_tostring},
+                mms_parse_initdata,
+        },
+        [MMS_MSG_INIT_RESP] = {
+                sizeof(initdata_t),
+                {init_destroy, init_tostring},
+                mms_parse_initdata,
+        },
+};
+
+// a pdu of unknown type keeps only its error
+static const pdu_kind_t g_pdu_unknown = {
+        sizeof(service_t),
+        {unknown_destroy, NULL},
+        NULL,
+};
+
+static service_t *mms_parse_service(
+        const unsigned char *_data, size_t _length,
+        unsigned int _flags, unsigned int _nest) {
+    if (_data == NULL || _length == 0) {
+        return NULL;
     }
-    resp->type = respcode;
-    respfunc->func(resp, _data + idx, _length - idx);
+    const pdu_kind_t *kind = &g_pdu_kind[_data[0]];
+    if (kind->parse == NULL) {
+        // log::warn unknown message type
+        kind = &g_pdu_unknown;
+    }
+    service_t *service = (service_t *) xmem_alloc(kind->size);
+    if (service == NULL) {
+        return NULL;
+    }
+    memset(service, 0, kind->size);
+    service->op = &kind->op;
+    if (kind->parse == NULL) {
+        service->code = MMS_ERR_MSGTYPE;
+        return service;
+    }
+    service->type = _data[0];
+    service->flags = _flags;
+    service->nest = mms_nest_limit(_nest);
+    kind->parse(service, _data, _length);
+    return service;
 }
 
 service_t *mms_parse(
         const unsigned char *_data,
         size_t _length) {
-    if (_data == NULL || _length == 0) {
+    return mms_parse_service(_data, _length, 0, 0);
+}
+
+int mms_peek(
+        const unsigned char *_data, size_t _length,
+        mms_header_t *_header) {
+    if (_data == NULL || _length == 0 || _header == NULL) {
+        return MMS_ERR_NULL;
+    }
+    memset(_header, 0, sizeof(mms_header_t));
+    xtlv_t tlv;
+    xtlv_init(&tlv, _data, _length);
+    _header->type = xtlv_byte(&tlv);
+    // the body may not have arrived yet
+    if (xtlv_read_length(&tlv, &_header->length) < 0) {
+        return MMS_ERR_LENGTH;
+    }
+    if (_header->type == MMS_MSG_ERROR) {
+        // the invoke id of a confirmed error is context tagged
+        unsigned int length = 0;
+        if (xtlv_expect(&tlv, 0x80, &length) < 0) {
+            return MMS_ERR_INVOKE;
+        }
+        if (xtlv_uint(&tlv, length, &_header->invoke) < 0) {
+            return MMS_ERR_LENGTH;
+        }
+        return (int) (tlv.data - _data);
+    }
+    if (_header->type != MMS_MSG_REQUEST &&
+        _header->type != MMS_MSG_RESPONSE) {
+        return (int) (tlv.data - _data);
+    }
+    int ret = mms_parse_invoke(&tlv, &_header->invoke);
+    if (ret < 0) {
+        return ret == XTLV_ERR_TAG ? MMS_ERR_INVOKE : MMS_ERR_LENGTH;
+    }
+    ret = xtlv_peek(&tlv);
+    if (ret == 0xbf || ret == 0x9f) {
+        xtlv_byte(&tlv);
+    }
+    ret = xtlv_byte(&tlv);
+    if (ret < 0) {
+        return MMS_ERR_LENGTH;
+    }
+    _header->service = ret;
+    return (int) (tlv.data - _data);
+}
+
+// minimum chunk of the per-parse arena
+#define MMS_ARENA_CHUNK (4096)
+
+service_t *mms_parse_ex(
+        const unsigned char *_data,
+        size_t _length, unsigned int _flags) {
+    mms_option_t option;
+    memset(&option, 0, sizeof(mms_option_t));
+    option.flags = _flags;
+    return mms_parse_opt(_data, _length, &option);
+}
+
+service_t *mms_parse_opt(
+        const unsigned char *_data, size_t _length,
+        const mms_option_t *_option) {
+    if (_data == NULL || _length == 0 || _option == NULL) {
         return NULL;
     }
-    service_t *service = NULL;
-    switch (_data[0]) {
-        case MMS_MSG_REQUEST: {
-            static const service_op_t sop = {
-                    request_destroy,
-                    request_tostring,
-            };
-            service = (service_t *) malloc(sizeof(request_t));
-            if (service == NULL) {
-                break;
-            }
-            memset(service, 0, sizeof(request_t));
-            service->type = MMS_MSG_REQUEST;
-            service->op = &sop;
-            mms_parse_request(service, _data, _length);
-            break;
+    const mms_allocator_t *alloc = _option->allocator;
+    if (alloc != NULL &&
+        (alloc->alloc == NULL || alloc->free == NULL)) {
+        alloc = NULL;
+    }
+    const mms_allocator_t *prev_alloc = xmem_bind(alloc);
+    xarena_t *arena = NULL;
+    if (_option->flags & MMS_PARSE_ARENA) {
+        // the decoded tree is usually a few times larger than the pdu
+        size_t chunk = _length * 4;
+        if (chunk < MMS_ARENA_CHUNK) {
+            chunk = MMS_ARENA_CHUNK;
+        }
+        arena = xarena_create(chunk);
+        if (arena == NULL) {
+            xmem_bind(prev_alloc);
+            return NULL;
+        }
+    }
+    int borrow = mmsstr_borrow_mode(
+            (_option->flags & MMS_PARSE_BORROW) != 0);
+    xarena_t *prev = xarena_bind(arena);
+    service_t *service = mms_parse_service(
+            _data, _length, _option->flags, _option->nest);
+    xarena_bind(prev);
+    mmsstr_borrow_mode(borrow);
+    xmem_bind(prev_alloc);
+    if (service == NULL) {
+        xarena_destroy(arena);
+        return NULL;
+    }
+    service->arena = arena;
+    if (alloc != NULL && arena == NULL) {
+        service->allocator = (*alloc);
+    }
+    return service;
+}
+
+int mms_nest_level(const service_t *_service) {
+    if (_service == NULL) {
+        return MMS_ERR_NULL;
+    }
+    if (_service->type != MMS_MSG_INIT_REQ &&
+        _service->type != MMS_MSG_INIT_RESP) {
+        return MMS_ERR_MSGTYPE;
+    }
+    const initdata_t *init = (const initdata_t *) _service;
+    return init_get_nest(init->data);
+}
+
+service_t *mms_parse_assoc(
+        const unsigned char *_ppdu, size_t _length,
+        const mms_option_t *_option) {
+    osi_assoc_t assoc;
+    if (osi_assoc(_ppdu, _length, &assoc) <= 0 || assoc.data == NULL) {
+        return NULL;
+    }
+    mms_option_t option;
+    memset(&option, 0, sizeof(mms_option_t));
+    if (_option != NULL) {
+        option = (*_option);
+    }
+    service_t *service = mms_parse_opt(assoc.data, assoc.length, &option);
+    if (service == NULL || service->code < 0 ||
+        (service->type != MMS_MSG_INIT_REQ &&
+         service->type != MMS_MSG_INIT_RESP)) {
+        return service;
+    }
+    // the setters copy into the node, nothing is allocated
+    node_t *data = ((initdata_t *) service)->data;
+    init_assoc(data, assoc.acse, assoc.result);
+    const osi_title_t *titles[2] = {&assoc.calling, &assoc.called};
+    // what the node cannot keep is dropped and marked
+    int truncated = assoc.truncated;
+    int called = 0;
+    while (called < 2) {
+        const osi_title_t *title = titles[called];
+        if ((title->oid != NULL || title->qualified) &&
+            init_ap_title(
+                    data, called, title->oid,
+                    (unsigned int) title->length,
+                    title->qualified ? &title->qualifier : NULL) < 0) {
+            truncated = 1;
+        }
+        called++;
+    }
+    size_t idx = 0;
+    while (idx < assoc.count) {
+        const osi_context_t *context = assoc.contexts + idx++;
+        if (init_context(
+                data, context->id, context->syntax,
+                (unsigned int) context->length, context->result) < 0) {
+            truncated = 1;
+        }
+    }
+    if (truncated) {
+        init_truncated(data);
+    }
+    return service;
+}
+
+void mms_set_allocator(const mms_allocator_t *_alloc) {
+    // the cached nodes belong to the previous allocator
+    node_pool_trim();
+    xmem_set_allocator(_alloc);
+}
+
+int mms_parse_events(
+        const unsigned char *_data, size_t _length,
+        const mms_handler_t *_handler, void *_ctx) {
+    if (_data == NULL || _length == 0 || _handler == NULL) {
+        return MMS_ERR_NULL;
+    }
+    // the service lives on the stack, nothing is allocated
+    // since every decoder only reports to the handler
+    union {
+        service_t service;
+        request_t request;
+        response_t response;
+        report_t report;
+        initdata_t init;
+    } storage;
+    memset(&storage, 0, sizeof(storage));
+    service_t *service = &storage.service;
+    service->type = _data[0];
+    service->handler = _handler;
+    service->context = _ctx;
+    service->nest = MMS_NEST_DEFAULT;
+    int borrow = mmsstr_borrow_mode(1);
+    const pdu_kind_t *kind = &g_pdu_kind[_data[0]];
+    if (kind->parse != NULL) {
+        kind->parse(service, _data, _length);
+    } else {
+        service->code = MMS_ERR_MSGTYPE;
+    }
+    mmsstr_borrow_mode(borrow);
+    if (_handler->end_pdu != NULL) {
+        _handler->end_pdu(_ctx, service->code, service->index);
+    }
+    return service->code;
+}
+
+/***************************************batch***************************************/
+
+// minimum chunk of the batch arena
+#define MMS_BATCH_CHUNK (65536)
+
+typedef struct mms_batch_t {
+    xarena_t *arena;
+    unsigned int flags;
+} mms_batch_t;
+
+mms_batch_t *mms_batch_create(unsigned int _flags) {
+    mms_batch_t *batch = (mms_batch_t *) xmem_alloc(sizeof(mms_batch_t));
+    if (batch == NULL) {
+        return NULL;
+    }
+    batch->arena = xarena_create(MMS_BATCH_CHUNK);
+    if (batch->arena == NULL) {
+        xmem_free(batch);
+        return NULL;
+    }
+    batch->flags = _flags;
+    return batch;
+}
+
+void mms_batch_destroy(mms_batch_t *_batch) {
+    if (_batch == NULL) {
+        return;
+    }
+    xarena_destroy(_batch->arena);
+    xmem_free(_batch);
+}
+
+int mms_parse_batch(
+        mms_batch_t *_batch,
+        const mms_frame_t *_frames, size_t _count,
+        service_t **_out) {
+    if (_batch == NULL || _frames == NULL || _out == NULL) {
+        return MMS_ERR_NULL;
+    }
+    // the services of the previous batch are dropped at once,
+    // the chunks grown so far are kept for this one
+    xarena_reset(_batch->arena);
+    int borrow = mmsstr_borrow_mode(
+            (_batch->flags & MMS_PARSE_BORROW) != 0);
+    xarena_t *prev = xarena_bind(_batch->arena);
+    int parsed = 0;
+    size_t idx = 0;
+    while (idx < _count) {
+        service_t *service = mms_parse_service(
+                _frames[idx].data, _frames[idx].length,
+                _batch->flags, 0);
+        if (service != NULL) {
+            service->batch = _batch;
+            parsed++;
+        }
+        _out[idx++] = service;
+    }
+    xarena_bind(prev);
+    mmsstr_borrow_mode(borrow);
+    return parsed;
+}
+
+/***************************************stream***************************************/
+
+typedef struct mms_parser_t {
+    mms_option_t option;
+    mms_allocator_t allocator; // copy of the allocator of the options
+    mms_receiver_t receiver;
+    size_t limit;
+    unsigned char *buffer; // bytes of the pending pdu
+    size_t capacity;
+    size_t used;
+    size_t size; // size of the pending pdu, 0 while unknown
+    int code; // error that stopped the stream
+} mms_parser_t;
+
+mms_parser_t *mms_parser_create(
+        const mms_option_t *_option, size_t _limit,
+        const mms_receiver_t *_receiver) {
+    if (_receiver == NULL) {
+        return NULL;
+    }
+    mms_parser_t *parser = (mms_parser_t *) xmem_alloc(sizeof(mms_parser_t));
+    if (parser == NULL) {
+        return NULL;
+    }
+    memset(parser, 0, sizeof(mms_parser_t));
+    if (_option != NULL) {
+        parser->option = (*_option);
+    }
+    if (parser->option.allocator != NULL) {
+        parser->allocator = (*parser->option.allocator);
+        parser->option.allocator = &parser->allocator;
+    }
+    parser->receiver = (*_receiver);
+    parser->limit = _limit == 0 ? MMS_PDU_DEFAULT : _limit;
+    return parser;
+}
+
+void mms_parser_destroy(mms_parser_t *_parser) {
+    if (_parser == NULL) {
+        return;
+    }
+    xmem_free(_parser->buffer);
+    xmem_free(_parser);
+}
+
+void mms_parser_reset(mms_parser_t *_parser) {
+    if (_parser == NULL) {
+        return;
+    }
+    _parser->used = 0;
+    _parser->size = 0;
+    _parser->code = 0;
+}
+
+// size of the pdu starting at _data: 1 when it is known, 0 while
+// more bytes are needed to know it, or the parsing error
+static int mms_pdu_size(
+        const unsigned char *_data, size_t _length,
+        size_t *_size) {
+    if (_length < 2) {
+        return 0;
+    }
+    xtlv_t tlv;
+    xtlv_init(&tlv, _data + 1, _length - 1);
+    unsigned int length = 0;
+    if (xtlv_read_length(&tlv, &length) < 0) {
+        // a long form is cut or too long
+        return _data[1] > 0x84 ? MMS_ERR_LENGTH : 0;
+    }
+    size_t head = (size_t) (tlv.data - _data);
+    if (length == XTLV_INDEFINITE) {
+        // known once the end-of-contents has arrived
+        if (xtlv_indefinite(tlv.data, tlv.end, &length) < 0) {
+            return 0;
         }
-        case MMS_MSG_RESPONSE: {
-            static const service_op_t sop = {
-                    response_destroy,
-                    response_tostring,
-            };
-            service = (service_t *) malloc(sizeof(response_t));
-            if (service == NULL) {
-                break;
-            }
-            memset(service, 0, sizeof(response_t));
-            service->type = MMS_MSG_RESPONSE;
-            service->op = &sop;
-            mms_parse_response(service, _data, _length);
-            break;
+        (*_size) = head + length + 2;
+        return 1;
+    }
+    (*_size) = head + length;
+    return 1;
+}
+
+// hand a complete pdu to the receiver
+static void mms_parser_deliver(
+        const mms_parser_t *_parser,
+        const unsigned char *_data, size_t _size) {
+    const mms_receiver_t *receiver = &_parser->receiver;
+    if (receiver->handler != NULL) {
+        mms_parse_events(
+                _data, _size, receiver->handler, receiver->context);
+        return;
+    }
+    service_t *service = mms_parse_opt(
+            _data, _size, &_parser->option);
+    if (receiver->service != NULL) {
+        receiver->service(receiver->context, service);
+    }
+    mms_destroy(service);
+}
+
+// append _length bytes to the pending pdu
+static int mms_parser_append(
+        mms_parser_t *_parser,
+        const unsigned char *_data, size_t _length) {
+    size_t used = _parser->used + _length;
+    if (used > _parser->limit) {
+        return MMS_ERR_LENGTH;
+    }
+    if (used > _parser->capacity) {
+        size_t capacity = _parser->capacity * 2;
+        if (capacity < MMS_ARENA_CHUNK) {
+            capacity = MMS_ARENA_CHUNK;
         }
-        case MMS_MSG_REPORT: {
-            static const service_op_t sop = {
-                    report_destroy,
-                    report_tostring,
-            };
-            service = (service_t *) malloc(sizeof(report_t));
-            if (service == NULL) {
-                break;
+        if (capacity < _parser->size) {
+            capacity = _parser->size;
+        }
+        if (capacity < used) {
+            capacity = used;
+        }
+        if (capacity > _parser->limit) {
+            capacity = _parser->limit;
+        }
+        unsigned char *buffer = (unsigned char *) xmem_realloc(
+                _parser->buffer, _parser->capacity, capacity);
+        if (buffer == NULL) {
+            return MMS_ERR_MEMALLOC;
+        }
+        _parser->buffer = buffer;
+        _parser->capacity = capacity;
+    }
+    memcpy(_parser->buffer + _parser->used, _data, _length);
+    _parser->used = used;
+    return 0;
+}
+
+int mms_parser_feed(
+        mms_parser_t *_parser,
+        const unsigned char *_data, size_t _length) {
+    if (_parser == NULL || (_data == NULL && _length > 0)) {
+        return MMS_ERR_NULL;
+    }
+    if (_parser->code < 0) {
+        return _parser->code;
+    }
+    int count = 0;
+    while (_length > 0) {
+        size_t size = 0;
+        int ret = 0;
+        if (_parser->used == 0) {
+            // pdus inside the chunk are decoded in place
+            ret = mms_pdu_size(_data, _length, &size);
+            if (ret > 0 && size <= _length) {
+                mms_parser_deliver(_parser, _data, size);
+                _data += size;
+                _length -= size;
+                count++;
+                continue;
             }
-            memset(service, 0, sizeof(report_t));
-            service->type = MMS_MSG_REPORT;
-            service->op = &sop;
-            mms_parse_report(service, _data, _length);
-            break;
         }
-        case MMS_MSG_INIT_REQ:
-        case MMS_MSG_INIT_RESP: {
-            static const service_op_t sop = {
-                    init_destroy,
-                    init_tostring,
-            };
-            service = (service_t *) malloc(sizeof(initdata_t));
-            if (service == NULL) {
-                break;
+        if (ret < 0 || (ret > 0 && size > _parser->limit)) {
+            _parser->code = MMS_ERR_LENGTH;
+            return _parser->code;
+        }
+        // a known size takes only the rest of the pdu, an unknown
+        // one the whole chunk, the surplus is handed back below
+        size_t take = _length;
+        if (_parser->size > 0 &&
+            _parser->size - _parser->used < take) {
+            take = _parser->size - _parser->used;
+        }
+        if (_parser->size == 0 &&
+            _parser->limit - _parser->used < take) {
+            take = _parser->limit - _parser->used;
+        }
+        ret = mms_parser_append(_parser, _data, take);
+        if (ret < 0 || take == 0) {
+            _parser->code = ret < 0 ? ret : MMS_ERR_LENGTH;
+            return _parser->code;
+        }
+        _data += take;
+        _length -= take;
+        if (_parser->size == 0) {
+            ret = mms_pdu_size(
+                    _parser->buffer, _parser->used, &_parser->size);
+            if (ret < 0 || _parser->size > _parser->limit) {
+                _parser->code = MMS_ERR_LENGTH;
+                return _parser->code;
             }
-            memset(service, 0, sizeof(initdata_t));
-            service->type = _data[0];
-            service->op = &sop;
-            mms_parse_initdata(service, _data, _length);
+        }
+        if (_parser->size == 0 || _parser->used < _parser->size) {
+            continue;
+        }
+        // bytes past the pdu still belong to the chunk
+        size_t surplus = _parser->used - _parser->size;
+        _data -= surplus;
+        _length += surplus;
+        mms_parser_deliver(_parser, _parser->buffer, _parser->size);
+        _parser->used = 0;
+        _parser->size = 0;
+        count++;
+    }
+    return count;
+}
+
+/***************************************lazy***************************************/
+
+// decode the members of a lazy structure of the service _ctx,
+// nested structures stay lazy
+static int mms_lazy_decode(
+        const void *_ctx,
+        const unsigned char *_data, unsigned int _length,
+        xlist_t **_list, int _owned) {
+    const service_t *service = (const service_t *) _ctx;
+    (*_list) = NULL;
+    const mms_allocator_t *prev_alloc = NULL;
+    xarena_t *prev = NULL;
+    int borrow = 1;
+    if (_owned) {
+        // the members are released with the rest of the tree
+        xarena_t *arena = service->arena;
+        if (service->batch != NULL) {
+            arena = service->batch->arena;
+        }
+        const mms_allocator_t *alloc = NULL;
+        if (service->allocator.alloc != NULL) {
+            alloc = &service->allocator;
+        }
+        prev_alloc = xmem_bind(alloc);
+        prev = xarena_bind(arena);
+        borrow = (service->flags & MMS_PARSE_BORROW) != 0;
+    }
+    borrow = mmsstr_borrow_mode(borrow);
+    int code = 0;
+    xlist_t *list = mms_list_create(service, &code);
+    xtlv_t tlv;
+    xtlv_init(&tlv, _data, _length);
+    while (list != NULL && xtlv_left(&tlv) > 0) {
+        xvalue_t value;
+        memset(&value, 0, sizeof(xvalue_t));
+        code = mms_data_value(service, &tlv, &value);
+        if (code < 0) {
+            xvalue_clear(&value);
             break;
         }
-        default: {
-            // log::warn unknown message type
-            service = (service_t *) malloc(sizeof(service_t));
-            if (service == NULL) {
-                break;
-            }
-            memset(service, 0, sizeof(service_t));
-            service->code = MMS_ERR_MSGTYPE;
+        code = mms_append_value(service, list, &value);
+        if (code < 0) {
             break;
         }
     }
-    return service;
+    mmsstr_borrow_mode(borrow);
+    if (_owned) {
+        xarena_bind(prev);
+        xmem_bind(prev_alloc);
+    }
+    (*_list) = list;
+    return code;
 }
-
-
-
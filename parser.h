@@ -3,6 +3,7 @@
 #define MMS_PARSER_H
 
 #include "packet.h"
+#include "xmem.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -10,10 +11,189 @@ extern "C" {
 
 typedef struct service_t service_t;
 
+// allocate the whole service tree from one arena,
+// mms_destroy then releases it at once
+#define MMS_PARSE_ARENA (0x01)
+// strings point into the input pdu instead of being copied,
+// the caller keeps the buffer alive until mms_destroy
+#define MMS_PARSE_BORROW (0x02)
+// values of reports and read responses are stored
+// as an array of 16 bytes cells instead of value nodes
+#define MMS_PARSE_COMPACT (0x04)
+// structures keep the slice of their members and decode them
+// on first access (xvalue_struct), the caller keeps the pdu alive.
+// ignored by reports and read responses in compact mode
+#define MMS_PARSE_LAZY (0x08)
+
+// deepest nesting of structures in data values and type specs,
+// by default and at most
+#define MMS_NEST_DEFAULT (15)
+#define MMS_NEST_MAX (64)
+
+// allocator hooks: alloc, realloc (may be NULL), free and context
+typedef xallocator_t mms_allocator_t;
+
+// options of mms_parse_opt
+typedef struct mms_option_t {
+    unsigned int flags; // MMS_PARSE_*
+    // allocator of this parse, NULL for the global one.
+    // the service keeps a copy and releases itself through it
+    const mms_allocator_t *allocator;
+    // deepest structure nesting, usually the structNestLevel
+    // of the initiate pdus, 0 for MMS_NEST_DEFAULT
+    unsigned int nest;
+} mms_option_t;
+
+// replace the global allocator of the library, NULL restores malloc.
+// call it before decoding starts, nodes cached by other threads
+// must have been released with node_pool_trim
+void mms_set_allocator(const mms_allocator_t *_alloc);
+
 const char *error_tostring(int _error);
 
 service_t *mms_parse(const unsigned char *_data, size_t _length);
 
+service_t *mms_parse_ex(
+        const unsigned char *_data,
+        size_t _length, unsigned int _flags);
+
+service_t *mms_parse_opt(
+        const unsigned char *_data, size_t _length,
+        const mms_option_t *_option);
+
+// a pdu of a batch
+typedef struct mms_frame_t {
+    const unsigned char *data;
+    size_t length;
+} mms_frame_t;
+
+// reusable storage of mms_parse_batch
+typedef struct mms_batch_t mms_batch_t;
+
+// create a batch context, _flags accepts MMS_PARSE_BORROW,
+// MMS_PARSE_COMPACT and MMS_PARSE_LAZY
+mms_batch_t *mms_batch_create(unsigned int _flags);
+
+void mms_batch_destroy(mms_batch_t *_batch);
+
+// parse _count frames into _out, the services belong to the batch
+// and stay valid until its next mms_parse_batch or mms_batch_destroy,
+// mms_destroy ignores them. return the number of parsed frames
+int mms_parse_batch(
+        mms_batch_t *_batch,
+        const mms_frame_t *_frames, size_t _count,
+        service_t **_out);
+
+// header fields of a pdu, filled by mms_peek
+typedef struct mms_header_t {
+    int type; // pdu type (0xa0, 0xa1, 0xa2, 0xa3, 0xa8, 0xa9)
+    // announced length of the pdu body,
+    // 0xffffffff for the indefinite form
+    unsigned int length;
+    unsigned int invoke; // request, response and confirmed error only
+    int service; // confirmed service tag, request and response only
+} mms_header_t;
+
+// decode only the pdu header, without allocation,
+// return the size of the header or the parsing error
+int mms_peek(
+        const unsigned char *_data, size_t _length,
+        mms_header_t *_header);
+
+// callbacks of mms_parse_events, any of them may be NULL.
+// strings and values point into the pdu and are only valid
+// during the callback, they are not null terminated.
+typedef struct mms_handler_t {
+    // pdu type (0xa0, 0xa1, ...), invoke id and service tag
+    void (*begin_pdu)(
+            void *_ctx, int _type,
+            unsigned int _invoke, int _service);
+
+    // decoding finished, _code is 0 or the parsing error
+    void (*end_pdu)(
+            void *_ctx, int _code,
+            unsigned int _index);
+
+    void (*begin_struct)(void *_ctx);
+
+    void (*end_struct)(void *_ctx);
+
+    void (*var_spec)(
+            void *_ctx,
+            const char *_domain, unsigned int _domain_len,
+            const char *_item, unsigned int _item_len);
+
+    // names of name lists, type components and file specs
+    void (*identifier)(
+            void *_ctx, const char *_name,
+            unsigned int _length);
+
+    // data values and access results, a failed access or write
+    // arrives as VALUE_TYPE_ERROR, a successful write is empty
+    void (*data_value)(
+            void *_ctx, const xvalue_t *_value);
+
+    // _stamp is the 15 bytes GeneralizedTime of the entry
+    void (*file_entry)(
+            void *_ctx, const char *_name,
+            unsigned int _length, unsigned int _size,
+            const char *_stamp);
+} mms_handler_t;
+
+// decode the pdu without building a service tree,
+// return 0 or the parsing error
+int mms_parse_events(
+        const unsigned char *_data, size_t _length,
+        const mms_handler_t *_handler, void *_ctx);
+
+// incremental parser of a stream of pdus
+typedef struct mms_parser_t mms_parser_t;
+
+// largest pdu an incremental parser buffers by default
+#define MMS_PDU_DEFAULT (1048576)
+
+// receiver of the complete pdus of an incremental parser
+typedef struct mms_receiver_t {
+    // the service tree of a pdu, destroyed when the callback returns
+    void (*service)(void *_ctx, service_t *_service);
+    // when set, the pdus are decoded as events instead
+    const mms_handler_t *handler;
+    void *context;
+} mms_receiver_t;
+
+// create an incremental parser, _option may be NULL and _limit
+// bounds the buffered pdu, 0 for MMS_PDU_DEFAULT
+mms_parser_t *mms_parser_create(
+        const mms_option_t *_option, size_t _limit,
+        const mms_receiver_t *_receiver);
+
+void mms_parser_destroy(mms_parser_t *_parser);
+
+// drop the pending bytes and the error of the stream
+void mms_parser_reset(mms_parser_t *_parser);
+
+// decode the pdus completed by the next _length bytes of the stream.
+// a pdu that lies inside the chunk is decoded in place, only a pdu
+// split across chunks is buffered. return the number of pdus handed
+// to the receiver or the parsing error, which stops the stream until
+// mms_parser_reset
+int mms_parser_feed(
+        mms_parser_t *_parser,
+        const unsigned char *_data, size_t _length);
+
+// return the negotiated structNestLevel of an initiate
+// request or response, or the parsing error
+int mms_nest_level(const service_t *_service);
+
+// decode an association: the presentation cp or cpa pdu of a connect
+// or accept (osi_data_t.ppdu), its aarq or aare and the initiate pdu
+// they carry. the ap titles, ae qualifiers and presentation contexts
+// are set on the initiate node. _option may be NULL, return NULL when
+// the pdu carries no initiate
+service_t *mms_parse_assoc(
+        const unsigned char *_ppdu, size_t _length,
+        const mms_option_t *_option);
+
 int mms_tostring(const service_t *_serice, char *_dest, size_t _size);
 
 int mms_destroy(service_t *_service);
@@ -0,0 +1,317 @@
+#include "pcap.h"
+
+#include <string.h>
+
+// magic numbers of pcap files, microseconds or nanoseconds
+#define PCAP_MAGIC_US (0xa1b2c3d4u)
+#define PCAP_MAGIC_NS (0xa1b23c4du)
+#define PCAP_HEADER (24)
+#define PCAP_RECORD (16)
+
+// pcapng blocks
+#define PCAP_BLOCK_SHB (0x0a0d0d0au)
+#define PCAP_BLOCK_IDB (0x00000001u)
+#define PCAP_BLOCK_PB (0x00000002u)
+#define PCAP_BLOCK_SPB (0x00000003u)
+#define PCAP_BLOCK_EPB (0x00000006u)
+#define PCAP_BYTE_ORDER (0x1a2b3c4du)
+
+// options of an interface description
+#define PCAP_OPT_END (0)
+#define PCAP_OPT_TSRESOL (9)
+#define PCAP_OPT_TSOFFSET (14)
+
+/*********************************byte order*********************************/
+
+// fields of the file in its own byte order
+static unsigned int pcap_u32(
+        const pcap_reader_t *_reader,
+        const unsigned char *_data) {
+    if (_reader->big) {
+        return ((unsigned int) _data[0] << 24) |
+               ((unsigned int) _data[1] << 16) |
+               ((unsigned int) _data[2] << 8) | _data[3];
+    }
+    return ((unsigned int) _data[3] << 24) |
+           ((unsigned int) _data[2] << 16) |
+           ((unsigned int) _data[1] << 8) | _data[0];
+}
+
+static unsigned int pcap_u16(
+        const pcap_reader_t *_reader,
+        const unsigned char *_data) {
+    if (_reader->big) {
+        return ((unsigned int) _data[0] << 8) | _data[1];
+    }
+    return ((unsigned int) _data[1] << 8) | _data[0];
+}
+
+static unsigned long long pcap_u64(
+        const pcap_reader_t *_reader,
+        const unsigned char *_data) {
+    unsigned long long first = pcap_u32(_reader, _data);
+    unsigned long long second = pcap_u32(_reader, _data + 4);
+    return _reader->big ? (first << 32) | second : (second << 32) | first;
+}
+
+// the magic number of a pcap file, read big endian
+static unsigned int pcap_magic(const unsigned char *_data) {
+    return ((unsigned int) _data[0] << 24) |
+           ((unsigned int) _data[1] << 16) |
+           ((unsigned int) _data[2] << 8) | _data[3];
+}
+
+static unsigned int pcap_reverse(unsigned int _value) {
+    return (_value >> 24) | ((_value >> 8) & 0xff00u) |
+           ((_value << 8) & 0xff0000u) | (_value << 24);
+}
+
+/*********************************pcap_reader_t*********************************/
+
+int pcap_probe(const unsigned char *_data, size_t _length) {
+    if (_data == NULL || _length < 4) {
+        return 0;
+    }
+    unsigned int magic = pcap_magic(_data);
+    return magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS ||
+           magic == pcap_reverse(PCAP_MAGIC_US) ||
+           magic == pcap_reverse(PCAP_MAGIC_NS) ||
+           magic == PCAP_BLOCK_SHB;
+}
+
+int pcap_reader_open(
+        pcap_reader_t *_reader,
+        const unsigned char *_data, size_t _length) {
+    if (_reader == NULL || _data == NULL) {
+        return PCAP_ERR_NULL;
+    }
+    if (!pcap_probe(_data, _length)) {
+        return PCAP_ERR_FORMAT;
+    }
+    memset(_reader, 0, sizeof(pcap_reader_t));
+    _reader->data = _data;
+    _reader->end = _data + _length;
+    unsigned int magic = pcap_magic(_data);
+    if (magic == PCAP_BLOCK_SHB) {
+        // the section header block sets the byte order
+        _reader->ng = 1;
+        return 0;
+    }
+    if (_length < PCAP_HEADER) {
+        return PCAP_ERR_TRUNCATED;
+    }
+    _reader->big = magic == PCAP_MAGIC_US || magic == PCAP_MAGIC_NS;
+    magic = pcap_u32(_reader, _data);
+    _reader->iface.resol = magic == PCAP_MAGIC_NS ? 9 : 6;
+    // the upper bits of the link type describe the fcs
+    _reader->iface.link = (int) (pcap_u32(_reader, _data + 20) & 0xffff);
+    _reader->data += PCAP_HEADER;
+    return 0;
+}
+
+// convert a timestamp in the units of _iface to nanoseconds
+static unsigned long long pcap_stamp(
+        const pcap_iface_t *_iface,
+        unsigned long long _stamp) {
+    unsigned long long seconds = 0;
+    unsigned long long nanos = 0;
+    if (_iface->power2) {
+        unsigned int resol = _iface->resol > 63 ? 63 : _iface->resol;
+        seconds = _stamp >> resol;
+        unsigned long long frac = _stamp & ((1ull << resol) - 1);
+        // keep frac * 10^9 within 64 bits
+        while (resol > 32) {
+            frac >>= 1;
+            resol--;
+        }
+        nanos = (frac * 1000000000ull) >> resol;
+    } else {
+        unsigned long long unit = 1;
+        unsigned int idx = 0;
+        while (idx < _iface->resol && idx < 19) {
+            unit *= 10;
+            idx++;
+        }
+        seconds = _stamp / unit;
+        unsigned long long frac = _stamp % unit;
+        while (idx < 9) {
+            frac *= 10;
+            idx++;
+        }
+        while (idx > 9) {
+            frac /= 10;
+            idx--;
+        }
+        nanos = frac;
+    }
+    seconds += (unsigned long long) _iface->offset;
+    return seconds * 1000000000ull + nanos;
+}
+
+static int pcap_next_record(pcap_reader_t *_reader, pcap_packet_t *_packet) {
+    size_t left = (size_t) (_reader->end - _reader->data);
+    if (left == 0) {
+        return 0;
+    }
+    if (left < PCAP_RECORD) {
+        return PCAP_ERR_TRUNCATED;
+    }
+    const unsigned char *record = _reader->data;
+    size_t length = pcap_u32(_reader, record + 8);
+    if (length > left - PCAP_RECORD) {
+        return PCAP_ERR_TRUNCATED;
+    }
+    const pcap_iface_t *iface = &_reader->iface;
+    unsigned long long frac = pcap_u32(_reader, record + 4);
+    unsigned long long unit = iface->resol == 9 ? 1000000000ull : 1000000ull;
+    _packet->stamp = pcap_stamp(
+            iface, pcap_u32(_reader, record) * unit + frac);
+    _packet->link = iface->link;
+    _packet->iface = 0;
+    _packet->data = record + PCAP_RECORD;
+    _packet->length = length;
+    _packet->original = pcap_u32(_reader, record + 12);
+    _reader->data += PCAP_RECORD + length;
+    return 1;
+}
+
+// a section header block, which restarts the interfaces
+static int pcap_section(
+        pcap_reader_t *_reader,
+        const unsigned char *_block, size_t _left) {
+    if (_left < 12) {
+        return PCAP_ERR_TRUNCATED;
+    }
+    unsigned int order = pcap_magic(_block + 8);
+    if (order == PCAP_BYTE_ORDER) {
+        _reader->big = 1;
+    } else if (order == pcap_reverse(PCAP_BYTE_ORDER)) {
+        _reader->big = 0;
+    } else {
+        return PCAP_ERR_FORMAT;
+    }
+    _reader->count = 0;
+    return 0;
+}
+
+// an interface description block and its timestamp options
+static void pcap_interface(
+        pcap_reader_t *_reader,
+        const unsigned char *_body, size_t _length) {
+    if (_length < 8 || _reader->count >= PCAP_IFACE_MAX) {
+        // packets of interfaces that are not kept are skipped
+        _reader->count++;
+        return;
+    }
+    pcap_iface_t *iface = _reader->ifaces + _reader->count++;
+    memset(iface, 0, sizeof(pcap_iface_t));
+    iface->link = (int) pcap_u16(_reader, _body);
+    iface->resol = 6;
+    size_t pos = 8;
+    while (pos + 4 <= _length) {
+        unsigned int code = pcap_u16(_reader, _body + pos);
+        size_t size = pcap_u16(_reader, _body + pos + 2);
+        pos += 4;
+        if (code == PCAP_OPT_END || size > _length - pos) {
+            break;
+        }
+        if (code == PCAP_OPT_TSRESOL && size >= 1) {
+            iface->power2 = (_body[pos] & 0x80) != 0;
+            iface->resol = _body[pos] & 0x7f;
+        } else if (code == PCAP_OPT_TSOFFSET && size >= 8) {
+            iface->offset = (long long) pcap_u64(_reader, _body + pos);
+        }
+        // values are padded to 32 bits
+        pos += (size + 3) & ~(size_t) 3;
+    }
+}
+
+static int pcap_next_block(pcap_reader_t *_reader, pcap_packet_t *_packet) {
+    while (_reader->data < _reader->end) {
+        const unsigned char *block = _reader->data;
+        size_t left = (size_t) (_reader->end - block);
+        if (left < 12) {
+            return PCAP_ERR_TRUNCATED;
+        }
+        // the type of a section header reads the same in both orders
+        unsigned int type = pcap_magic(block);
+        if (type == PCAP_BLOCK_SHB) {
+            int ret = pcap_section(_reader, block, left);
+            if (ret < 0) {
+                return ret;
+            }
+        } else {
+            type = pcap_u32(_reader, block);
+        }
+        size_t total = pcap_u32(_reader, block + 4);
+        if (total < 12 || (total & 3) != 0) {
+            return PCAP_ERR_FORMAT;
+        }
+        if (total > left) {
+            return PCAP_ERR_TRUNCATED;
+        }
+        _reader->data += total;
+        const unsigned char *body = block + 8;
+        size_t length = total - 12;
+        const unsigned char *data = NULL;
+        size_t captured = 0;
+        unsigned int id = 0;
+        unsigned long long stamp = 0;
+        if (type == PCAP_BLOCK_IDB) {
+            pcap_interface(_reader, body, length);
+            continue;
+        } else if (type == PCAP_BLOCK_EPB && length >= 20) {
+            id = pcap_u32(_reader, body);
+            stamp = ((unsigned long long) pcap_u32(_reader, body + 4) << 32) |
+                    pcap_u32(_reader, body + 8);
+            captured = pcap_u32(_reader, body + 12);
+            _packet->original = pcap_u32(_reader, body + 16);
+            data = body + 20;
+        } else if (type == PCAP_BLOCK_PB && length >= 20) {
+            id = pcap_u16(_reader, body);
+            stamp = ((unsigned long long) pcap_u32(_reader, body + 4) << 32) |
+                    pcap_u32(_reader, body + 8);
+            captured = pcap_u32(_reader, body + 12);
+            _packet->original = pcap_u32(_reader, body + 16);
+            data = body + 20;
+        } else if (type == PCAP_BLOCK_SPB && length >= 4) {
+            // no interface nor timestamp, captured up to the block end
+            _packet->original = pcap_u32(_reader, body);
+            data = body + 4;
+            captured = _packet->original;
+            if (captured > length - 4) {
+                captured = length - 4;
+            }
+        } else {
+            // statistics, name resolution and custom blocks
+            continue;
+        }
+        if (captured > length - (size_t) (data - body)) {
+            return PCAP_ERR_FORMAT;
+        }
+        if (id >= _reader->count || id >= PCAP_IFACE_MAX) {
+            continue;
+        }
+        const pcap_iface_t *iface = _reader->ifaces + id;
+        _packet->stamp = stamp == 0 ? 0 : pcap_stamp(iface, stamp);
+        _packet->link = iface->link;
+        _packet->iface = id;
+        _packet->data = data;
+        _packet->length = captured;
+        return 1;
+    }
+    return 0;
+}
+
+int pcap_reader_next(pcap_reader_t *_reader, pcap_packet_t *_packet) {
+    if (_reader == NULL || _packet == NULL) {
+        return PCAP_ERR_NULL;
+    }
+    if (_reader->data == NULL) {
+        return 0;
+    }
+    if (_reader->ng) {
+        return pcap_next_block(_reader, _packet);
+    }
+    return pcap_next_record(_reader, _packet);
+}
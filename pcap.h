@@ -0,0 +1,66 @@
+#ifndef MMS_PCAP_H
+#define MMS_PCAP_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#define PCAP_ERR_NULL (-1)
+// neither a pcap nor a pcapng file
+#define PCAP_ERR_FORMAT (-2)
+// a record or block runs past the end of the file
+#define PCAP_ERR_TRUNCATED (-3)
+
+// interfaces of a pcapng section kept by a reader
+#define PCAP_IFACE_MAX (32)
+
+// a captured packet, a slice of the capture file
+typedef struct pcap_packet_t {
+    unsigned long long stamp; // nanoseconds since the epoch
+    int link; // link type of the interface
+    unsigned int iface; // interface of a pcapng section
+    const unsigned char *data;
+    size_t length; // captured bytes
+    size_t original; // bytes on the wire
+} pcap_packet_t;
+
+// an interface of a pcapng section
+typedef struct pcap_iface_t {
+    int link;
+    // timestamp units: 10^-resol seconds,
+    // or 2^-resol when the power2 flag is set
+    unsigned int resol;
+    int power2;
+    long long offset; // seconds added to the timestamps
+} pcap_iface_t;
+
+// cursor over a capture file held in memory
+typedef struct pcap_reader_t {
+    const unsigned char *data; // next record or block
+    const unsigned char *end;
+    int big; // fields are big endian
+    int ng; // pcapng
+    pcap_iface_t iface; // the interface of a pcap file
+    unsigned int count; // interfaces of the current pcapng section
+    pcap_iface_t ifaces[PCAP_IFACE_MAX];
+} pcap_reader_t;
+
+// return 1 when _data starts like a pcap or pcapng file
+int pcap_probe(const unsigned char *_data, size_t _length);
+
+// start reading the capture file at _data, return 0 or the error
+int pcap_reader_open(
+        pcap_reader_t *_reader,
+        const unsigned char *_data, size_t _length);
+
+// return 1 and fill _packet with the next packet,
+// 0 at the end of the file or the error
+int pcap_reader_next(pcap_reader_t *_reader, pcap_packet_t *_packet);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // !MMS_PCAP_H
@@ -0,0 +1,315 @@
+#include "ring.h"
+
+#include <string.h>
+
+#include "tcp.h"
+#include "xmem.h"
+
+#if defined(__linux__)
+
+#include <arpa/inet.h>
+#include <linux/filter.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <net/if.h>
+#include <net/if_arp.h>
+#include <poll.h>
+#include <sys/ioctl.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+// size of the frame slots the kernel accounts for, blocks of
+// tpacket_v3 hold frames of any size back to back
+#define RING_FRAME_SIZE (2048)
+
+typedef struct ring_t {
+    int fd;
+    unsigned char *map;
+    size_t block_size;
+    size_t block_count;
+    size_t current; // next block handed over by the kernel
+    int link; // link type of the frames
+    int loopback; // frames are seen twice, when sent and received
+} ring_t;
+
+// tcpdump -dd "tcp port 102" for ethernet frames, ipv4 and ipv6
+static struct sock_filter g_filter[] = {
+        {0x28, 0,  0,  0x0000000c},
+        {0x15, 0,  6,  0x000086dd},
+        {0x30, 0,  0,  0x00000014},
+        {0x15, 0,  15, 0x00000006},
+        {0x28, 0,  0,  0x00000036},
+        {0x15, 12, 0,  TCP_PORT_ISO},
+        {0x28, 0,  0,  0x00000038},
+        {0x15, 10, 11, TCP_PORT_ISO},
+        {0x15, 0,  10, 0x00000800},
+        {0x30, 0,  0,  0x00000017},
+        {0x15, 0,  8,  0x00000006},
+        {0x28, 0,  0,  0x00000014},
+        {0x45, 6,  0,  0x00001fff},
+        {0xb1, 0,  0,  0x0000000e},
+        {0x48, 0,  0,  0x0000000e},
+        {0x15, 2,  0,  TCP_PORT_ISO},
+        {0x48, 0,  0,  0x00000010},
+        {0x15, 0,  1,  TCP_PORT_ISO},
+        {0x06, 0,  0,  0x00040000},
+        {0x06, 0,  0,  0x00000000},
+};
+
+// link type and loopback flag of the interface
+static int ring_link(int _fd, const char *_iface, ring_t *_ring) {
+    struct ifreq ifr;
+    memset(&ifr, 0, sizeof(ifr));
+    strncpy(ifr.ifr_name, _iface, IFNAMSIZ - 1);
+    if (ioctl(_fd, SIOCGIFHWADDR, &ifr) != 0) {
+        return RING_ERR_SOCKET;
+    }
+    switch (ifr.ifr_hwaddr.sa_family) {
+        case ARPHRD_LOOPBACK:
+            _ring->loopback = 1;
+            // loopback frames carry an ethernet header
+            // fall through
+        case ARPHRD_ETHER:
+            _ring->link = TCP_LINK_ETHERNET;
+            return 0;
+        case ARPHRD_NONE:
+            _ring->link = TCP_LINK_RAW;
+            return 0;
+        default:
+            return RING_ERR_UNSUPPORTED;
+    }
+}
+
+static int ring_setup(
+        ring_t *_ring, const char *_iface,
+        const ring_option_t *_option) {
+    int fd = _ring->fd;
+    unsigned int ifindex = if_nametoindex(_iface);
+    if (ifindex == 0) {
+        return RING_ERR_SOCKET;
+    }
+    int ret = ring_link(fd, _iface, _ring);
+    if (ret < 0) {
+        return ret;
+    }
+    // filter before binding, no unfiltered frame reaches the ring
+    if (_ring->link == TCP_LINK_ETHERNET) {
+        struct sock_fprog program;
+        program.len = sizeof(g_filter) / sizeof(g_filter[0]);
+        program.filter = g_filter;
+        if (setsockopt(fd, SOL_SOCKET, SO_ATTACH_FILTER,
+                       &program, sizeof(program)) != 0) {
+            return RING_ERR_SOCKET;
+        }
+    }
+    int version = TPACKET_V3;
+    if (setsockopt(fd, SOL_PACKET, PACKET_VERSION,
+                   &version, sizeof(version)) != 0) {
+        return RING_ERR_SOCKET;
+    }
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = (unsigned int) _ring->block_size;
+    req.tp_block_nr = (unsigned int) _ring->block_count;
+    req.tp_frame_size = RING_FRAME_SIZE;
+    req.tp_frame_nr = (unsigned int)
+            (_ring->block_size * _ring->block_count / RING_FRAME_SIZE);
+    req.tp_retire_blk_tov = _option->timeout;
+    if (setsockopt(fd, SOL_PACKET, PACKET_RX_RING,
+                   &req, sizeof(req)) != 0) {
+        return RING_ERR_SOCKET;
+    }
+    size_t size = _ring->block_size * _ring->block_count;
+    void *map = mmap(
+            NULL, size, PROT_READ | PROT_WRITE,
+            MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (map == MAP_FAILED) {
+        return RING_ERR_SOCKET;
+    }
+    _ring->map = (unsigned char *) map;
+    struct sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = (int) ifindex;
+    if (bind(fd, (struct sockaddr *) &addr, sizeof(addr)) != 0) {
+        return RING_ERR_SOCKET;
+    }
+    if (_option->fanout != 0) {
+        // the flow hash keeps both directions on one worker
+        unsigned int mode = PACKET_FANOUT_HASH | PACKET_FANOUT_FLAG_DEFRAG;
+        int fanout = (int) ((_option->fanout & 0xffff) | (mode << 16));
+        if (setsockopt(fd, SOL_PACKET, PACKET_FANOUT,
+                       &fanout, sizeof(fanout)) != 0) {
+            return RING_ERR_SOCKET;
+        }
+    }
+    return 0;
+}
+
+ring_t *ring_open(
+        const char *_iface, const ring_option_t *_option,
+        int *_error) {
+    int error = 0;
+    if (_error == NULL) {
+        _error = &error;
+    }
+    if (_iface == NULL) {
+        (*_error) = RING_ERR_NULL;
+        return NULL;
+    }
+    ring_option_t option;
+    memset(&option, 0, sizeof(ring_option_t));
+    if (_option != NULL) {
+        option = (*_option);
+    }
+    if (option.block_size == 0) {
+        option.block_size = RING_BLOCK_SIZE;
+    }
+    if (option.block_count == 0) {
+        option.block_count = RING_BLOCK_COUNT;
+    }
+    if (option.timeout == 0) {
+        option.timeout = RING_TIMEOUT;
+    }
+    ring_t *ring = (ring_t *) xmem_alloc(sizeof(ring_t));
+    if (ring == NULL) {
+        (*_error) = RING_ERR_SOCKET;
+        return NULL;
+    }
+    memset(ring, 0, sizeof(ring_t));
+    ring->block_size = option.block_size;
+    ring->block_count = option.block_count;
+    ring->fd = socket(AF_PACKET, SOCK_RAW, htons(ETH_P_ALL));
+    if (ring->fd < 0) {
+        xmem_free(ring);
+        (*_error) = RING_ERR_SOCKET;
+        return NULL;
+    }
+    int ret = ring_setup(ring, _iface, &option);
+    if (ret < 0) {
+        ring_close(ring);
+        (*_error) = ret;
+        return NULL;
+    }
+    return ring;
+}
+
+void ring_close(ring_t *_ring) {
+    if (_ring == NULL) {
+        return;
+    }
+    if (_ring->map != NULL) {
+        munmap(_ring->map, _ring->block_size * _ring->block_count);
+    }
+    close(_ring->fd);
+    xmem_free(_ring);
+}
+
+int ring_poll(
+        ring_t *_ring, int _timeout,
+        ring_callback_t _callback, void *_ctx) {
+    if (_ring == NULL || _callback == NULL) {
+        return RING_ERR_NULL;
+    }
+    struct tpacket_block_desc *block = (struct tpacket_block_desc *)
+            (_ring->map + _ring->current * _ring->block_size);
+    if ((block->hdr.bh1.block_status & TP_STATUS_USER) == 0) {
+        struct pollfd pfd;
+        memset(&pfd, 0, sizeof(pfd));
+        pfd.fd = _ring->fd;
+        pfd.events = POLLIN | POLLERR;
+        if (poll(&pfd, 1, _timeout) < 0) {
+            return 0;
+        }
+        if ((block->hdr.bh1.block_status & TP_STATUS_USER) == 0) {
+            return 0;
+        }
+    }
+    // the frames are read after the status
+    __sync_synchronize();
+    unsigned int count = block->hdr.bh1.num_pkts;
+    const unsigned char *frame = (const unsigned char *) block +
+                                 block->hdr.bh1.offset_to_first_pkt;
+    unsigned int idx = 0;
+    while (idx++ < count) {
+        const struct tpacket3_hdr *header =
+                (const struct tpacket3_hdr *) frame;
+        const struct sockaddr_ll *addr = (const struct sockaddr_ll *)
+                (frame + TPACKET_ALIGN(sizeof(struct tpacket3_hdr)));
+        if (!_ring->loopback || addr->sll_pkttype != PACKET_OUTGOING) {
+            pcap_packet_t packet;
+            packet.stamp = (unsigned long long) header->tp_sec *
+                           1000000000ull + header->tp_nsec;
+            packet.link = _ring->link;
+            packet.iface = 0;
+            packet.data = frame + header->tp_mac;
+            packet.length = header->tp_snaplen;
+            packet.original = header->tp_len;
+            _callback(_ctx, &packet);
+        }
+        frame += header->tp_next_offset;
+    }
+    // hand the block back once its frames are consumed
+    __sync_synchronize();
+    block->hdr.bh1.block_status = TP_STATUS_KERNEL;
+    _ring->current = (_ring->current + 1) % _ring->block_count;
+    return (int) count;
+}
+
+int ring_stats(
+        ring_t *_ring,
+        unsigned int *_packets, unsigned int *_drops) {
+    if (_ring == NULL || _packets == NULL || _drops == NULL) {
+        return RING_ERR_NULL;
+    }
+    struct tpacket_stats_v3 stats;
+    socklen_t length = sizeof(stats);
+    memset(&stats, 0, sizeof(stats));
+    if (getsockopt(_ring->fd, SOL_PACKET, PACKET_STATISTICS,
+                   &stats, &length) != 0) {
+        return RING_ERR_SOCKET;
+    }
+    (*_packets) = stats.tp_packets;
+    (*_drops) = stats.tp_drops;
+    return 0;
+}
+
+#else
+
+ring_t *ring_open(
+        const char *_iface, const ring_option_t *_option,
+        int *_error) {
+    (void) _iface;
+    (void) _option;
+    if (_error != NULL) {
+        (*_error) = RING_ERR_UNSUPPORTED;
+    }
+    return NULL;
+}
+
+void ring_close(ring_t *_ring) {
+    (void) _ring;
+}
+
+int ring_poll(
+        ring_t *_ring, int _timeout,
+        ring_callback_t _callback, void *_ctx) {
+    (void) _ring;
+    (void) _timeout;
+    (void) _callback;
+    (void) _ctx;
+    return RING_ERR_UNSUPPORTED;
+}
+
+int ring_stats(
+        ring_t *_ring,
+        unsigned int *_packets, unsigned int *_drops) {
+    (void) _ring;
+    (void) _packets;
+    (void) _drops;
+    return RING_ERR_UNSUPPORTED;
+}
+
+#endif  // __linux__
@@ -0,0 +1,62 @@
+#ifndef MMS_RING_H
+#define MMS_RING_H
+
+#include "pcap.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#define RING_ERR_NULL (-1)
+// live capture needs linux af_packet sockets
+#define RING_ERR_UNSUPPORTED (-2)
+#define RING_ERR_SOCKET (-3)
+
+// defaults of the ring: bytes of a block, blocks, and milliseconds
+// after which the kernel hands over a block that is not full
+#define RING_BLOCK_SIZE (1048576)
+#define RING_BLOCK_COUNT (64)
+#define RING_TIMEOUT (100)
+
+// options of a ring, 0 selects the default
+typedef struct ring_option_t {
+    unsigned int block_size; // a multiple of the page size
+    unsigned int block_count;
+    unsigned int timeout;
+    // fanout group shared by the rings of the workers, the kernel
+    // spreads the flows across them. 0 without fanout
+    unsigned int fanout;
+} ring_option_t;
+
+// a tpacket_v3 receive ring of an interface, filtered to tcp port 102
+typedef struct ring_t ring_t;
+
+// receives a frame of a block, _packet points into the ring
+// and is only valid during the call
+typedef void (*ring_callback_t)(void *_ctx, const pcap_packet_t *_packet);
+
+// capture on the interface _iface, _option may be NULL.
+// return NULL and set _error when the ring cannot be set up
+ring_t *ring_open(
+        const char *_iface, const ring_option_t *_option,
+        int *_error);
+
+void ring_close(ring_t *_ring);
+
+// wait up to _timeout milliseconds for a block, hand its frames to
+// _callback and return the block to the kernel. return the number of
+// frames, 0 when no block was ready or the error
+int ring_poll(
+        ring_t *_ring, int _timeout,
+        ring_callback_t _callback, void *_ctx);
+
+// frames received and dropped by the kernel since the last call
+int ring_stats(
+        ring_t *_ring,
+        unsigned int *_packets, unsigned int *_drops);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // !MMS_RING_H
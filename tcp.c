@@ -0,0 +1,659 @@
+#include "tcp.h"
+
+#include <string.h>
+
+#include "xmem.h"
+
+// ether types
+#define TCP_ETHER_IPV4 (0x0800)
+#define TCP_ETHER_IPV6 (0x86dd)
+#define TCP_ETHER_VLAN (0x8100)
+#define TCP_ETHER_QINQ (0x88a8)
+#define TCP_ETHER_QINQ_OLD (0x9100)
+
+// ip protocols and ipv6 extension headers
+#define TCP_PROTO_TCP (6)
+#define TCP_IPV6_HOPOPTS (0)
+#define TCP_IPV6_ROUTING (43)
+#define TCP_IPV6_FRAGMENT (44)
+#define TCP_IPV6_AH (51)
+#define TCP_IPV6_DSTOPTS (60)
+
+// initial number of flow slots, a power of two
+#define TCP_TABLE_INITIAL (1024)
+
+/*********************************decoding*********************************/
+
+static unsigned int tcp_be16(const unsigned char *_data) {
+    return ((unsigned int) _data[0] << 8) | _data[1];
+}
+
+static unsigned int tcp_be32(const unsigned char *_data) {
+    return ((unsigned int) _data[0] << 24) |
+           ((unsigned int) _data[1] << 16) |
+           ((unsigned int) _data[2] << 8) | _data[3];
+}
+
+// strip the link header, return the ether type of the
+// payload, 0 for other traffic or the error
+static int tcp_link(
+        int _link, const unsigned char **_data,
+        size_t *_length) {
+    const unsigned char *data = *_data;
+    size_t length = *_length;
+    unsigned int proto = 0;
+    switch (_link) {
+        case TCP_LINK_ETHERNET:
+            if (length < 14) {
+                return TCP_ERR_FRAME;
+            }
+            proto = tcp_be16(data + 12);
+            data += 14;
+            length -= 14;
+            // 802.1q tags, stacked for 802.1ad
+            while (proto == TCP_ETHER_VLAN || proto == TCP_ETHER_QINQ ||
+                   proto == TCP_ETHER_QINQ_OLD) {
+                if (length < 4) {
+                    return TCP_ERR_FRAME;
+                }
+                proto = tcp_be16(data + 2);
+                data += 4;
+                length -= 4;
+            }
+            break;
+        case TCP_LINK_LINUX_SLL:
+            if (length < 16) {
+                return TCP_ERR_FRAME;
+            }
+            proto = tcp_be16(data + 14);
+            data += 16;
+            length -= 16;
+            break;
+        case TCP_LINK_NULL:
+            // address family in the byte order of the capturing host
+            if (length < 4) {
+                return TCP_ERR_FRAME;
+            }
+            data += 4;
+            length -= 4;
+            // the version tells the family
+            // fall through
+        case TCP_LINK_RAW:
+        case TCP_LINK_IPV4:
+        case TCP_LINK_IPV6:
+            if (length < 1) {
+                return TCP_ERR_FRAME;
+            }
+            proto = (data[0] >> 4) == 4 ? TCP_ETHER_IPV4 : TCP_ETHER_IPV6;
+            break;
+        default:
+            return TCP_ERR_LINK;
+    }
+    *_data = data;
+    *_length = length;
+    return (int) proto;
+}
+
+// strip an ipv4 header, return 1 for a whole tcp segment
+static int tcp_ipv4(
+        const unsigned char **_data, size_t *_length,
+        tcp_key_t *_key) {
+    const unsigned char *data = *_data;
+    if (*_length < 20 || (data[0] >> 4) != 4) {
+        return TCP_ERR_FRAME;
+    }
+    size_t header = (size_t) (data[0] & 0x0f) * 4;
+    size_t total = tcp_be16(data + 2);
+    // ethernet pads short frames, a capture may cut long ones
+    if (header < 20 || total < header || total > *_length) {
+        return TCP_ERR_FRAME;
+    }
+    // more fragments or a fragment offset
+    if ((tcp_be16(data + 6) & 0x3fff) != 0 ||
+        data[9] != TCP_PROTO_TCP) {
+        return 0;
+    }
+    _key->family = 4;
+    memcpy(_key->src, data + 12, 4);
+    memcpy(_key->dst, data + 16, 4);
+    *_data = data + header;
+    *_length = total - header;
+    return 1;
+}
+
+// strip an ipv6 header and its extensions, return 1 for a tcp segment
+static int tcp_ipv6(
+        const unsigned char **_data, size_t *_length,
+        tcp_key_t *_key) {
+    const unsigned char *data = *_data;
+    if (*_length < 40 || (data[0] >> 4) != 6) {
+        return TCP_ERR_FRAME;
+    }
+    size_t length = tcp_be16(data + 4);
+    if (length > *_length - 40) {
+        return TCP_ERR_FRAME;
+    }
+    int next = data[6];
+    _key->family = 6;
+    memcpy(_key->src, data + 8, 16);
+    memcpy(_key->dst, data + 24, 16);
+    data += 40;
+    while (next == TCP_IPV6_HOPOPTS || next == TCP_IPV6_ROUTING ||
+           next == TCP_IPV6_DSTOPTS || next == TCP_IPV6_AH) {
+        if (length < 8) {
+            return TCP_ERR_FRAME;
+        }
+        size_t size = next == TCP_IPV6_AH ?
+                      ((size_t) data[1] + 2) * 4 :
+                      ((size_t) data[1] + 1) * 8;
+        if (size > length) {
+            return TCP_ERR_FRAME;
+        }
+        next = data[0];
+        data += size;
+        length -= size;
+    }
+    // fragments are not reassembled
+    if (next != TCP_PROTO_TCP) {
+        return 0;
+    }
+    *_data = data;
+    *_length = length;
+    return 1;
+}
+
+int tcp_decode(
+        int _link, const unsigned char *_frame, size_t _length,
+        tcp_segment_t *_segment) {
+    if (_frame == NULL || _segment == NULL) {
+        return TCP_ERR_NULL;
+    }
+    memset(_segment, 0, sizeof(tcp_segment_t));
+    const unsigned char *data = _frame;
+    size_t length = _length;
+    int ret = tcp_link(_link, &data, &length);
+    if (ret == TCP_ETHER_IPV4) {
+        ret = tcp_ipv4(&data, &length, &_segment->key);
+    } else if (ret == TCP_ETHER_IPV6) {
+        ret = tcp_ipv6(&data, &length, &_segment->key);
+    } else if (ret > 0) {
+        ret = 0;
+    }
+    if (ret <= 0) {
+        return ret;
+    }
+    if (length < 20) {
+        return TCP_ERR_FRAME;
+    }
+    size_t header = (size_t) (data[12] >> 4) * 4;
+    if (header < 20 || header > length) {
+        return TCP_ERR_FRAME;
+    }
+    _segment->key.sport = (unsigned short) tcp_be16(data);
+    _segment->key.dport = (unsigned short) tcp_be16(data + 2);
+    _segment->seq = tcp_be32(data + 4);
+    _segment->flags = data[13];
+    _segment->data = data + header;
+    _segment->length = length - header;
+    return 1;
+}
+
+/*********************************tcp_table_t*********************************/
+
+// a segment received ahead of a hole, kept until the hole is filled
+typedef struct tcp_chunk_t {
+    struct tcp_chunk_t *next;
+    unsigned int seq;
+    unsigned long long stamp; // time the segment was seen
+    size_t length;
+    unsigned char data[1];
+} tcp_chunk_t;
+
+// a direction of a connection, slots are probed linearly
+typedef struct tcp_flow_t {
+    tcp_key_t key;
+    unsigned int hash;
+    int used;
+    int synced; // next is known
+    unsigned int next; // sequence number of the next byte
+    int fin; // the fin was seen, at fin_seq
+    unsigned int fin_seq;
+    unsigned long long last; // time of the last segment
+    unsigned long long held; // time the first chunk was kept
+    tcp_chunk_t *chunks; // ordered by sequence number
+    size_t buffered; // payload bytes of the chunks
+    void *stream; // NULL for an ignored direction
+} tcp_flow_t;
+
+typedef struct tcp_table_t {
+    tcp_handler_t handler;
+    tcp_option_t option;
+    tcp_flow_t *flows;
+    size_t capacity; // a power of two
+    size_t count;
+    size_t buffered; // payload bytes of the chunks of all flows
+    size_t sweep; // next slot checked for idleness
+} tcp_table_t;
+
+// a chunk does not fit the limits of its flow or of the table
+#define TCP_FULL (1)
+
+// slots checked for idleness on each segment
+#define TCP_SWEEP_STEP (4)
+
+// fnv-1a of the key
+static unsigned int tcp_hash(const tcp_key_t *_key) {
+    const unsigned char *data = (const unsigned char *) _key;
+    unsigned int hash = 2166136261u;
+    size_t idx = 0;
+    while (idx < sizeof(tcp_key_t)) {
+        hash ^= data[idx++];
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static tcp_flow_t *tcp_table_alloc(size_t _capacity) {
+    tcp_flow_t *flows = (tcp_flow_t *) xmem_alloc(
+            _capacity * sizeof(tcp_flow_t));
+    if (flows != NULL) {
+        memset(flows, 0, _capacity * sizeof(tcp_flow_t));
+    }
+    return flows;
+}
+
+tcp_table_t *tcp_table_create(
+        const tcp_handler_t *_handler,
+        const tcp_option_t *_option) {
+    if (_handler == NULL || _handler->open == NULL ||
+        _handler->data == NULL) {
+        return NULL;
+    }
+    tcp_table_t *table = (tcp_table_t *) xmem_alloc(sizeof(tcp_table_t));
+    if (table == NULL) {
+        return NULL;
+    }
+    memset(table, 0, sizeof(tcp_table_t));
+    table->handler = (*_handler);
+    if (_option != NULL) {
+        table->option = (*_option);
+    }
+    if (table->option.flow_limit == 0) {
+        table->option.flow_limit = TCP_FLOW_DEFAULT;
+    }
+    if (table->option.budget == 0) {
+        table->option.budget = TCP_BUDGET_DEFAULT;
+    }
+    if (table->option.idle == 0) {
+        table->option.idle = TCP_IDLE_DEFAULT;
+    }
+    if (table->option.stall == 0) {
+        table->option.stall = TCP_STALL_DEFAULT;
+    }
+    table->capacity = TCP_TABLE_INITIAL;
+    table->flows = tcp_table_alloc(table->capacity);
+    if (table->flows == NULL) {
+        xmem_free(table);
+        return NULL;
+    }
+    return table;
+}
+
+static void tcp_flow_drop(tcp_table_t *_table, tcp_flow_t *_flow) {
+    tcp_chunk_t *chunk = _flow->chunks;
+    while (chunk != NULL) {
+        tcp_chunk_t *next = chunk->next;
+        xmem_free(chunk);
+        chunk = next;
+    }
+    _flow->chunks = NULL;
+    _table->buffered -= _flow->buffered;
+    _flow->buffered = 0;
+}
+
+// double the slots once half of them are used
+static int tcp_table_grow(tcp_table_t *_table) {
+    size_t capacity = _table->capacity * 2;
+    tcp_flow_t *flows = tcp_table_alloc(capacity);
+    if (flows == NULL) {
+        return TCP_ERR_MEMALLOC;
+    }
+    size_t idx = 0;
+    while (idx < _table->capacity) {
+        const tcp_flow_t *flow = _table->flows + idx++;
+        if (!flow->used) {
+            continue;
+        }
+        size_t slot = flow->hash & (capacity - 1);
+        while (flows[slot].used) {
+            slot = (slot + 1) & (capacity - 1);
+        }
+        flows[slot] = (*flow);
+    }
+    xmem_free(_table->flows);
+    _table->flows = flows;
+    _table->capacity = capacity;
+    _table->sweep &= capacity - 1;
+    return 0;
+}
+
+// find the flow of _key, or the empty slot ending its probe sequence
+static tcp_flow_t *tcp_table_find(
+        tcp_table_t *_table, const tcp_key_t *_key,
+        unsigned int _hash) {
+    size_t mask = _table->capacity - 1;
+    size_t slot = _hash & mask;
+    while (1) {
+        tcp_flow_t *flow = _table->flows + slot;
+        if (!flow->used || (flow->hash == _hash &&
+                            memcmp(&flow->key, _key, sizeof(tcp_key_t)) == 0)) {
+            return flow;
+        }
+        slot = (slot + 1) & mask;
+    }
+}
+
+// empty the slot and shift back the flows probed past it
+static void tcp_table_remove(tcp_table_t *_table, tcp_flow_t *_flow) {
+    size_t mask = _table->capacity - 1;
+    size_t hole = (size_t) (_flow - _table->flows);
+    size_t slot = hole;
+    _table->flows[hole].used = 0;
+    _table->count--;
+    while (1) {
+        slot = (slot + 1) & mask;
+        tcp_flow_t *flow = _table->flows + slot;
+        if (!flow->used) {
+            break;
+        }
+        size_t home = flow->hash & mask;
+        // the flow stays when its home lies cyclically in (hole, slot]
+        int stays = hole <= slot ?
+                    (home > hole && home <= slot) :
+                    (home > hole || home <= slot);
+        if (stays) {
+            continue;
+        }
+        _table->flows[hole] = (*flow);
+        flow->used = 0;
+        hole = slot;
+    }
+}
+
+// hand the bytes from _seq on to the stream, skipping those seen
+static void tcp_flow_deliver(
+        tcp_table_t *_table, tcp_flow_t *_flow, unsigned int _seq,
+        const unsigned char *_data, size_t _length,
+        unsigned long long _stamp) {
+    size_t seen = (size_t) (_flow->next - _seq);
+    if (seen >= _length) {
+        return;
+    }
+    _flow->next += (unsigned int) (_length - seen);
+    _table->handler.data(
+            _table->handler.context, _flow->stream,
+            _data + seen, _length - seen, _stamp);
+}
+
+// deliver the chunks the next byte has reached
+static void tcp_flow_drain(tcp_table_t *_table, tcp_flow_t *_flow) {
+    while (_flow->chunks != NULL &&
+           (int) (_flow->chunks->seq - _flow->next) <= 0) {
+        tcp_chunk_t *chunk = _flow->chunks;
+        _flow->chunks = chunk->next;
+        _flow->buffered -= chunk->length;
+        _table->buffered -= chunk->length;
+        tcp_flow_deliver(
+                _table, _flow, chunk->seq,
+                chunk->data, chunk->length, chunk->stamp);
+        xmem_free(chunk);
+    }
+}
+
+// give up the holes of a flow, its chunks are delivered
+// in order after a gap for each hole
+static void tcp_flow_flush(tcp_table_t *_table, tcp_flow_t *_flow) {
+    const tcp_handler_t *handler = &_table->handler;
+    while (_flow->chunks != NULL) {
+        if (handler->gap != NULL) {
+            handler->gap(handler->context, _flow->stream);
+        }
+        _flow->next = _flow->chunks->seq;
+        tcp_flow_drain(_table, _flow);
+    }
+}
+
+static void tcp_flow_close(tcp_table_t *_table, tcp_flow_t *_flow) {
+    if (_flow->stream != NULL) {
+        tcp_flow_flush(_table, _flow);
+    }
+    tcp_flow_drop(_table, _flow);
+    if (_flow->stream != NULL && _table->handler.close != NULL) {
+        _table->handler.close(_table->handler.context, _flow->stream);
+    }
+    _flow->stream = NULL;
+}
+
+void tcp_table_destroy(tcp_table_t *_table) {
+    if (_table == NULL) {
+        return;
+    }
+    size_t idx = 0;
+    while (idx < _table->capacity) {
+        tcp_flow_t *flow = _table->flows + idx++;
+        if (flow->used) {
+            tcp_flow_close(_table, flow);
+        }
+    }
+    xmem_free(_table->flows);
+    xmem_free(_table);
+}
+
+static int tcp_flow_idle(
+        const tcp_table_t *_table, const tcp_flow_t *_flow,
+        unsigned long long _now) {
+    return _now > _flow->last && _now - _flow->last > _table->option.idle;
+}
+
+// a hole of the flow was waited for longer than the stall time
+static int tcp_flow_stalled(
+        const tcp_table_t *_table, const tcp_flow_t *_flow,
+        unsigned long long _now) {
+    return _flow->chunks != NULL && _now > _flow->held &&
+           _now - _flow->held > _table->option.stall;
+}
+
+// every byte up to the fin arrived
+static int tcp_flow_done(const tcp_flow_t *_flow) {
+    return _flow->fin && (int) (_flow->next - _flow->fin_seq) >= 0;
+}
+
+// close an idle flow, deliver the chunks of a stalled one.
+// return 1 when the flow was closed and removed
+static int tcp_flow_check(
+        tcp_table_t *_table, tcp_flow_t *_flow,
+        unsigned long long _now) {
+    if (tcp_flow_stalled(_table, _flow, _now)) {
+        tcp_flow_flush(_table, _flow);
+    }
+    if (tcp_flow_idle(_table, _flow, _now) || tcp_flow_done(_flow)) {
+        tcp_flow_close(_table, _flow);
+        tcp_table_remove(_table, _flow);
+        return 1;
+    }
+    return 0;
+}
+
+// check a few slots for idle and stalled flows, every slot is
+// visited once the table has seen half its capacity of segments
+static void tcp_table_sweep(tcp_table_t *_table, unsigned long long _now) {
+    size_t step = 0;
+    while (step++ < TCP_SWEEP_STEP) {
+        tcp_flow_t *flow = _table->flows + _table->sweep;
+        // a flow may shift back into the slot, check it again
+        if (flow->used && tcp_flow_check(_table, flow, _now)) {
+            continue;
+        }
+        _table->sweep = (_table->sweep + 1) & (_table->capacity - 1);
+    }
+}
+
+int tcp_table_expire(tcp_table_t *_table, unsigned long long _now) {
+    if (_table == NULL) {
+        return TCP_ERR_NULL;
+    }
+    int count = 0;
+    size_t idx = 0;
+    while (idx < _table->capacity) {
+        tcp_flow_t *flow = _table->flows + idx;
+        if (flow->used && tcp_flow_check(_table, flow, _now)) {
+            count++;
+            continue;
+        }
+        idx++;
+    }
+    return count;
+}
+
+// copy a segment received ahead of a hole into the ordered chunks,
+// return 0, TCP_FULL or the error
+static int tcp_flow_store(
+        tcp_table_t *_table, tcp_flow_t *_flow, unsigned int _seq,
+        const unsigned char *_data, size_t _length,
+        unsigned long long _now) {
+    tcp_chunk_t **link = &_flow->chunks;
+    while ((*link) != NULL && (int) ((*link)->seq - _seq) < 0) {
+        link = &(*link)->next;
+    }
+    // a retransmission of a chunk already kept
+    if ((*link) != NULL && (*link)->seq == _seq &&
+        (*link)->length >= _length) {
+        return 0;
+    }
+    if (_flow->buffered + _length > _table->option.flow_limit ||
+        _table->buffered + _length > _table->option.budget) {
+        return TCP_FULL;
+    }
+    tcp_chunk_t *chunk = (tcp_chunk_t *) xmem_alloc(
+            sizeof(tcp_chunk_t) + _length);
+    if (chunk == NULL) {
+        return TCP_ERR_MEMALLOC;
+    }
+    chunk->seq = _seq;
+    chunk->stamp = _now;
+    chunk->length = _length;
+    memcpy(chunk->data, _data, _length);
+    chunk->next = (*link);
+    (*link) = chunk;
+    _flow->buffered += _length;
+    _table->buffered += _length;
+    return 0;
+}
+
+// the payload of a segment: delivered in place when it continues the
+// stream, kept while a hole precedes it. when the limits are reached
+// the hole is given up and the stream resumes after it
+static int tcp_flow_segment(
+        tcp_table_t *_table, tcp_flow_t *_flow, unsigned int _seq,
+        const unsigned char *_data, size_t _length,
+        unsigned long long _now) {
+    const tcp_handler_t *handler = &_table->handler;
+    while (1) {
+        if ((int) (_seq - _flow->next) <= 0) {
+            tcp_flow_deliver(_table, _flow, _seq, _data, _length, _now);
+            tcp_flow_drain(_table, _flow);
+            return 0;
+        }
+        int ret = tcp_flow_store(
+                _table, _flow, _seq, _data, _length, _now);
+        if (ret != TCP_FULL) {
+            return ret;
+        }
+        if (handler->gap != NULL) {
+            handler->gap(handler->context, _flow->stream);
+        }
+        tcp_chunk_t *chunk = _flow->chunks;
+        if (chunk == NULL || (int) (_seq - chunk->seq) < 0) {
+            _flow->next = _seq;
+        } else {
+            _flow->next = chunk->seq;
+            tcp_flow_drain(_table, _flow);
+        }
+    }
+}
+
+int tcp_table_feed(
+        tcp_table_t *_table, const tcp_segment_t *_segment,
+        unsigned long long _now) {
+    if (_table == NULL || _segment == NULL) {
+        return TCP_ERR_NULL;
+    }
+    tcp_table_sweep(_table, _now);
+    if ((_table->count + 1) * 2 > _table->capacity &&
+        tcp_table_grow(_table) < 0) {
+        return TCP_ERR_MEMALLOC;
+    }
+    unsigned int hash = tcp_hash(&_segment->key);
+    tcp_flow_t *flow = tcp_table_find(_table, &_segment->key, hash);
+    const tcp_handler_t *handler = &_table->handler;
+    if (!flow->used) {
+        memset(flow, 0, sizeof(tcp_flow_t));
+        flow->key = _segment->key;
+        flow->hash = hash;
+        flow->used = 1;
+        flow->stream = handler->open(handler->context, &flow->key);
+        _table->count++;
+    }
+    flow->last = _now;
+    if (flow->stream == NULL || (_segment->flags & TCP_RST)) {
+        if (_segment->flags & (TCP_FIN | TCP_RST)) {
+            tcp_flow_close(_table, flow);
+            tcp_table_remove(_table, flow);
+        }
+        return 0;
+    }
+    // the syn takes one sequence number before the data,
+    // a new syn reuses the direction for another connection
+    unsigned int seq = _segment->seq;
+    if (_segment->flags & TCP_SYN) {
+        seq++;
+        if (flow->synced && seq != flow->next) {
+            // the bytes of the earlier connection are delivered first
+            tcp_flow_flush(_table, flow);
+            flow->fin = 0;
+            if (handler->gap != NULL) {
+                handler->gap(handler->context, flow->stream);
+            }
+        }
+        flow->synced = 0;
+    }
+    int held = flow->chunks != NULL;
+    unsigned int next = flow->next;
+    if (!flow->synced) {
+        // a capture may start in the middle of a connection
+        flow->next = seq;
+        flow->synced = 1;
+    }
+    int ret = 0;
+    if (_segment->length > 0) {
+        ret = tcp_flow_segment(
+                _table, flow, seq,
+                _segment->data, _segment->length, _now);
+    }
+    if (_segment->flags & TCP_FIN) {
+        flow->fin = 1;
+        flow->fin_seq = seq + (unsigned int) _segment->length;
+    }
+    // the wait starts again when the stream moves past a hole
+    if (flow->chunks != NULL && (!held || flow->next != next)) {
+        flow->held = _now;
+    }
+    if (tcp_flow_stalled(_table, flow, _now)) {
+        tcp_flow_flush(_table, flow);
+    }
+    if (tcp_flow_done(flow)) {
+        tcp_flow_close(_table, flow);
+        tcp_table_remove(_table, flow);
+    }
+    return ret;
+}
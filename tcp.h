@@ -0,0 +1,134 @@
+#ifndef MMS_TCP_H
+#define MMS_TCP_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#define TCP_ERR_NULL (-1)
+// a link type without decoder
+#define TCP_ERR_LINK (-2)
+// truncated or malformed headers
+#define TCP_ERR_FRAME (-3)
+#define TCP_ERR_MEMALLOC (-4)
+
+// link types of capture files
+#define TCP_LINK_NULL (0)
+#define TCP_LINK_ETHERNET (1)
+#define TCP_LINK_RAW (101)
+#define TCP_LINK_LINUX_SLL (113)
+#define TCP_LINK_IPV4 (228)
+#define TCP_LINK_IPV6 (229)
+
+// iso transport over tcp, rfc 1006
+#define TCP_PORT_ISO (102)
+
+// tcp flags
+#define TCP_FIN (0x01)
+#define TCP_SYN (0x02)
+#define TCP_RST (0x04)
+#define TCP_ACK (0x10)
+
+// one direction of a connection, ipv4 addresses
+// take the first 4 bytes and the rest is zero
+typedef struct tcp_key_t {
+    unsigned char src[16];
+    unsigned char dst[16];
+    unsigned short sport;
+    unsigned short dport;
+    int family; // 4 or 6
+} tcp_key_t;
+
+// a tcp segment, the payload is a slice of the frame
+typedef struct tcp_segment_t {
+    tcp_key_t key;
+    unsigned int seq;
+    int flags; // TCP_*
+    const unsigned char *data;
+    size_t length;
+} tcp_segment_t;
+
+// decode the link, vlan, ip and tcp headers of a frame, return 1
+// and fill _segment for an unfragmented tcp segment, 0 for other
+// traffic or the error
+int tcp_decode(
+        int _link, const unsigned char *_frame, size_t _length,
+        tcp_segment_t *_segment);
+
+/*********************************tcp_table_t*********************************/
+
+// the flows of a capture: the byte stream of each direction
+typedef struct tcp_table_t tcp_table_t;
+
+// receivers of the flows, _stream is the state returned by open
+typedef struct tcp_handler_t {
+    // a new direction, return its state or NULL to ignore it
+    void *(*open)(void *_ctx, const tcp_key_t *_key);
+
+    // the next contiguous bytes of the direction, _stamp is the
+    // time their segment was seen
+    void (*data)(
+            void *_ctx, void *_stream,
+            const unsigned char *_data, size_t _length,
+            unsigned long long _stamp);
+
+    // bytes of the direction were lost, the stream resumes later
+    void (*gap)(void *_ctx, void *_stream);
+
+    // the direction ended or the table is destroyed, the bytes
+    // kept behind a hole were delivered after a gap
+    void (*close)(void *_ctx, void *_stream);
+
+    void *context;
+} tcp_handler_t;
+
+// defaults of the limits of a table: bytes kept ahead of a hole
+// by a direction and by the whole table, nanoseconds a direction
+// stays without traffic before it is evicted, and nanoseconds a
+// hole is waited for before the bytes after it are delivered
+#define TCP_FLOW_DEFAULT (262144)
+#define TCP_BUDGET_DEFAULT (67108864)
+#define TCP_IDLE_DEFAULT (120000000000ull)
+#define TCP_STALL_DEFAULT (10000000000ull)
+
+// limits of a table, 0 selects the default
+typedef struct tcp_option_t {
+    size_t flow_limit;
+    size_t budget;
+    unsigned long long idle;
+    unsigned long long stall;
+} tcp_option_t;
+
+// create a table, _option may be NULL
+tcp_table_t *tcp_table_create(
+        const tcp_handler_t *_handler,
+        const tcp_option_t *_option);
+
+// close the flows left and release the table
+void tcp_table_destroy(tcp_table_t *_table);
+
+// track the segment seen at _now (nanoseconds) and hand the bytes it
+// completes to the handler. a payload continuing its stream is passed
+// without a copy, one ahead of a hole is kept until the hole is
+// filled or a limit or the stall time gives it up. a few slots are
+// checked for idle and stalled directions on each call.
+// return 0 or the error
+int tcp_table_feed(
+        tcp_table_t *_table, const tcp_segment_t *_segment,
+        unsigned long long _now);
+
+// a time every direction is idle at
+#define TCP_TIME_END (0xffffffffffffffffull)
+
+// close every direction idle at _now and give up the holes stalled
+// at _now, return the number of closed directions. TCP_TIME_END
+// closes them all, the table stays usable
+int tcp_table_expire(tcp_table_t *_table, unsigned long long _now);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // !MMS_TCP_H
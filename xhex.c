@@ -0,0 +1,313 @@
+#include "xhex.h"
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define XHEX_X86 (1)
+#define XHEX_TARGET(_isa) __attribute__((target(_isa)))
+#include <immintrin.h>
+#elif defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#define XHEX_X86 (1)
+#define XHEX_TARGET(_isa)
+#include <intrin.h>
+#include <immintrin.h>
+#endif
+
+// value of a hex digit, 0x10 for a separator, 0xff otherwise
+static const unsigned char g_hexval[256] = {
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x10, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0x10, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0x00, 0x01, 0x02, 0x03, 0x04, 0x05, 0x06, 0x07,
+        0x08, 0x09, 0x10, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0x0a, 0x0b, 0x0c, 0x0d, 0x0e, 0x0f, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+        0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff, 0xff,
+};
+
+#define XHEX_SEPARATOR (0x10)
+
+// characters the scalar loop takes after a block the kernel refused,
+// before handing back to the kernel
+#define XHEX_SCALAR_RUN (64)
+
+// decode whole blocks of hex digits without separators, stop at the
+// first block holding another character. return the digits consumed
+typedef size_t (*xhex_kernel_t)(
+        const unsigned char *_text, size_t _length,
+        unsigned char *_out);
+
+/*********************************x86*********************************/
+
+#if defined(XHEX_X86)
+
+// 16 digits into 8 bytes per step, signed comparisons
+// are enough since other bytes fail both ranges
+XHEX_TARGET("sse2")
+static size_t xhex_sse2(
+        const unsigned char *_text, size_t _length,
+        unsigned char *_out) {
+    const __m128i zero = _mm_set1_epi8('0' - 1);
+    const __m128i nine = _mm_set1_epi8('9' + 1);
+    const __m128i lower_a = _mm_set1_epi8('a' - 1);
+    const __m128i lower_f = _mm_set1_epi8('f' + 1);
+    const __m128i lower = _mm_set1_epi8(0x20);
+    const __m128i digit0 = _mm_set1_epi8('0');
+    const __m128i alpha0 = _mm_set1_epi8('a' - 10);
+    const __m128i low = _mm_set1_epi16(0x00ff);
+    size_t done = 0;
+    while (_length - done >= 16) {
+        __m128i text = _mm_loadu_si128((const __m128i *) (_text + done));
+        __m128i folded = _mm_or_si128(text, lower);
+        __m128i digit = _mm_and_si128(
+                _mm_cmpgt_epi8(text, zero),
+                _mm_cmpgt_epi8(nine, text));
+        __m128i alpha = _mm_and_si128(
+                _mm_cmpgt_epi8(folded, lower_a),
+                _mm_cmpgt_epi8(lower_f, folded));
+        if (_mm_movemask_epi8(_mm_or_si128(digit, alpha)) != 0xffff) {
+            break;
+        }
+        __m128i nibble = _mm_or_si128(
+                _mm_and_si128(digit, _mm_sub_epi8(text, digit0)),
+                _mm_and_si128(alpha, _mm_sub_epi8(folded, alpha0)));
+        // each 16 bits lane holds the high digit in its low byte
+        __m128i bytes = _mm_or_si128(
+                _mm_slli_epi16(_mm_and_si128(nibble, low), 4),
+                _mm_srli_epi16(nibble, 8));
+        _mm_storel_epi64(
+                (__m128i *) (_out + done / 2),
+                _mm_packus_epi16(bytes, bytes));
+        done += 16;
+    }
+    return done;
+}
+
+// 32 digits into 16 bytes per step
+XHEX_TARGET("avx2")
+static size_t xhex_avx2(
+        const unsigned char *_text, size_t _length,
+        unsigned char *_out) {
+    const __m256i zero = _mm256_set1_epi8('0' - 1);
+    const __m256i nine = _mm256_set1_epi8('9' + 1);
+    const __m256i lower_a = _mm256_set1_epi8('a' - 1);
+    const __m256i lower_f = _mm256_set1_epi8('f' + 1);
+    const __m256i lower = _mm256_set1_epi8(0x20);
+    const __m256i digit0 = _mm256_set1_epi8('0');
+    const __m256i alpha0 = _mm256_set1_epi8('a' - 10);
+    // high digit times 16 plus the low one
+    const __m256i weight = _mm256_set1_epi16(0x0110);
+    size_t done = 0;
+    while (_length - done >= 32) {
+        __m256i text = _mm256_loadu_si256(
+                (const __m256i *) (_text + done));
+        __m256i folded = _mm256_or_si256(text, lower);
+        __m256i digit = _mm256_and_si256(
+                _mm256_cmpgt_epi8(text, zero),
+                _mm256_cmpgt_epi8(nine, text));
+        __m256i alpha = _mm256_and_si256(
+                _mm256_cmpgt_epi8(folded, lower_a),
+                _mm256_cmpgt_epi8(lower_f, folded));
+        if (_mm256_movemask_epi8(_mm256_or_si256(digit, alpha)) != -1) {
+            break;
+        }
+        __m256i nibble = _mm256_or_si256(
+                _mm256_and_si256(digit, _mm256_sub_epi8(text, digit0)),
+                _mm256_and_si256(alpha, _mm256_sub_epi8(folded, alpha0)));
+        __m256i words = _mm256_maddubs_epi16(nibble, weight);
+        // packing works per 128 bits lane, gather both halves
+        __m256i bytes = _mm256_permute4x64_epi64(
+                _mm256_packus_epi16(words, words), 0x08);
+        _mm_storeu_si128(
+                (__m128i *) (_out + done / 2),
+                _mm256_castsi256_si128(bytes));
+        done += 32;
+    }
+    return done;
+}
+
+// 64 digits into 32 bytes per step
+XHEX_TARGET("avx512f,avx512bw")
+static size_t xhex_avx512(
+        const unsigned char *_text, size_t _length,
+        unsigned char *_out) {
+    const __m512i digit0 = _mm512_set1_epi8('0');
+    const __m512i alpha0 = _mm512_set1_epi8('a');
+    const __m512i nine = _mm512_set1_epi8(9);
+    const __m512i five = _mm512_set1_epi8(5);
+    const __m512i ten = _mm512_set1_epi8(10);
+    const __m512i lower = _mm512_set1_epi8(0x20);
+    const __m512i weight = _mm512_set1_epi16(0x0110);
+    size_t done = 0;
+    while (_length - done >= 64) {
+        __m512i text = _mm512_loadu_si512(
+                (const void *) (_text + done));
+        __m512i digit = _mm512_sub_epi8(text, digit0);
+        __m512i alpha = _mm512_sub_epi8(
+                _mm512_or_si512(text, lower), alpha0);
+        __mmask64 is_digit = _mm512_cmple_epu8_mask(digit, nine);
+        __mmask64 is_alpha = _mm512_cmple_epu8_mask(alpha, five);
+        if ((is_digit | is_alpha) != ~(__mmask64) 0) {
+            break;
+        }
+        __m512i nibble = _mm512_mask_blend_epi8(
+                is_digit, _mm512_add_epi8(alpha, ten), digit);
+        __m512i words = _mm512_maddubs_epi16(nibble, weight);
+        _mm256_storeu_si256(
+                (__m256i *) (_out + done / 2),
+                _mm512_cvtepi16_epi8(words));
+        done += 64;
+    }
+    return done;
+}
+
+// the best kernel the processor and the os support
+static int xhex_detect() {
+#if defined(__GNUC__)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512bw")) {
+        return XHEX_KERNEL_AVX512;
+    }
+    if (__builtin_cpu_supports("avx2")) {
+        return XHEX_KERNEL_AVX2;
+    }
+    if (__builtin_cpu_supports("sse2")) {
+        return XHEX_KERNEL_SSE2;
+    }
+    return XHEX_KERNEL_SCALAR;
+#else
+    int info[4];
+    __cpuid(info, 0);
+    if (info[0] < 1) {
+        return XHEX_KERNEL_SCALAR;
+    }
+    __cpuid(info, 1);
+    int sse2 = (info[3] & (1 << 26)) != 0;
+    // the os saves the vector registers
+    int osxsave = (info[2] & (1 << 27)) != 0;
+    unsigned long long xcr0 = osxsave ? _xgetbv(0) : 0;
+    __cpuidex(info, 7, 0);
+    if ((xcr0 & 0xe6) == 0xe6 &&
+        (info[1] & (1 << 16)) && (info[1] & (1 << 30))) {
+        return XHEX_KERNEL_AVX512;
+    }
+    if ((xcr0 & 0x06) == 0x06 && (info[1] & (1 << 5))) {
+        return XHEX_KERNEL_AVX2;
+    }
+    return sse2 ? XHEX_KERNEL_SSE2 : XHEX_KERNEL_SCALAR;
+#endif
+}
+
+#else
+
+static int xhex_detect() {
+    return XHEX_KERNEL_SCALAR;
+}
+
+#endif  // XHEX_X86
+
+/*********************************xhex*********************************/
+
+// the scalar loop decodes everything without a kernel
+static const xhex_kernel_t g_kernels[] = {
+        NULL,
+#if defined(XHEX_X86)
+        xhex_sse2,
+        xhex_avx2,
+        xhex_avx512,
+#endif
+};
+
+// selected on first use, -1 before. the selection is idempotent,
+// so threads racing on it store the same value
+static volatile int g_kernel = -1;
+static volatile int g_supported = -1;
+
+int xhex_select(int _kernel) {
+    if (g_supported < 0) {
+        g_supported = xhex_detect();
+    }
+    int kernel = _kernel < g_supported ? _kernel : g_supported;
+    if (kernel < XHEX_KERNEL_SCALAR) {
+        kernel = XHEX_KERNEL_SCALAR;
+    }
+    g_kernel = kernel;
+    return kernel;
+}
+
+int xhex_kernel() {
+    if (g_kernel < 0) {
+        return xhex_select(XHEX_KERNEL_AVX512);
+    }
+    return g_kernel;
+}
+
+int xhex_decode(
+        const char *_text, size_t _length,
+        unsigned char *_out, size_t *_written) {
+    if (_text == NULL || _out == NULL || _written == NULL) {
+        return XHEX_ERR_NULL;
+    }
+    xhex_kernel_t kernel = g_kernels[xhex_kernel()];
+    const unsigned char *text = (const unsigned char *) _text;
+    size_t read = 0;
+    size_t writ = 0;
+    (*_written) = 0;
+    while (read < _length) {
+        size_t stop = _length;
+        if (kernel != NULL) {
+            // every block is loaded before its bytes are stored,
+            // which keeps decoding in place safe
+            size_t done = kernel(text + read, _length - read, _out + writ);
+            read += done;
+            writ += done / 2;
+            // separators, invalid characters or the tail
+            if (_length - read > XHEX_SCALAR_RUN) {
+                stop = read + XHEX_SCALAR_RUN;
+            }
+        }
+        while (read < stop) {
+            unsigned char high = g_hexval[text[read]];
+            if (high == XHEX_SEPARATOR) {
+                read++;
+                continue;
+            }
+            if (high > 0x0f) {
+                return XHEX_ERR_CHAR;
+            }
+            if (read + 1 == _length) {
+                return XHEX_ERR_ODD;
+            }
+            unsigned char low = g_hexval[text[read + 1]];
+            if (low > 0x0f) {
+                return XHEX_ERR_CHAR;
+            }
+            _out[writ++] = (unsigned char) ((high << 4) | low);
+            read += 2;
+        }
+    }
+    (*_written) = writ;
+    return 0;
+}
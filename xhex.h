@@ -0,0 +1,42 @@
+#ifndef X_HEX_H
+#define X_HEX_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#define XHEX_ERR_NULL (-1)
+// a character is neither a hex digit nor a separator
+#define XHEX_ERR_CHAR (-2)
+// the last byte misses its low digit
+#define XHEX_ERR_ODD (-3)
+
+// decoding kernels, from the slowest
+#define XHEX_KERNEL_SCALAR (0)
+#define XHEX_KERNEL_SSE2 (1)
+#define XHEX_KERNEL_AVX2 (2)
+#define XHEX_KERNEL_AVX512 (3)
+
+/*********************************xhex*********************************/
+
+// decode the hex digits of _text into _out, which may be _text
+// itself. spaces, tabs and colons are accepted between bytes, a
+// byte is two adjacent digits of either case. _out receives up to
+// _length / 2 bytes, _written their number. return 0 or the error
+int xhex_decode(
+        const char *_text, size_t _length,
+        unsigned char *_out, size_t *_written);
+
+// the kernel in use, by default the fastest the processor supports
+int xhex_kernel();
+
+// use the fastest supported kernel up to _kernel, return it
+int xhex_select(int _kernel);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // !X_HEX_H
@@ -2,28 +2,30 @@
 #include "xlist.h"
 
 #include <stdlib.h>
+#include <string.h>
 
 #include "node.h"
+#include "xmem.h"
+
+// elements stored inside the list before it grows onto the heap
+#define XLIST_INLINE (8)
 
 typedef struct xlist_t {
-  node_t *head;
-  node_t *tail;
-  node_t *it;
+  node_t **items;
   size_t count;
+  size_t capacity;
+  node_t *inline_items[XLIST_INLINE];
 } xlist_t;
 
 // create a list instance
 xlist_t *xlist_create() {
-  const size_t size = sizeof(xlist_t) + sizeof(node_t);
-  xlist_t *list = (xlist_t *)malloc(size);
+  xlist_t *list = (xlist_t *)xmem_alloc(sizeof(xlist_t));
   if (list == NULL) {
     return list;
   }
-  list->head = (node_t *)(list + 1);
-  list->head->next = NULL;
-  list->tail = list->head;
-  list->it = list->head;
+  list->items = list->inline_items;
   list->count = 0;
+  list->capacity = XLIST_INLINE;
   return list;
 }
 
@@ -32,40 +34,70 @@ void xlist_destroy(xlist_t *_list) {
   if (_list == NULL) {
     return;
   }
-  node_t *it = xlist_remove_head(_list);
-  while (it != NULL) {
-    node_destroy(it);
-    it = xlist_remove_head(_list);
+  size_t idx = 0;
+  while (idx < _list->count) {
+    node_destroy(_list->items[idx++]);
+  }
+  if (_list->items != _list->inline_items) {
+    xmem_free(_list->items);
   }
-  free(_list);
+  xmem_free(_list);
   _list = NULL;
 }
 
-// return the first element
-// and reset the iterator to head
-node_t *xlist_begin(xlist_t *_list) {
-  if (_list == NULL) {
-    return NULL;
+// double the capacity of the element array
+static int xlist_grow(xlist_t *_list) {
+  size_t capacity = _list->capacity * 2;
+  size_t used = _list->count * sizeof(node_t *);
+  node_t **items = NULL;
+  if (_list->items == _list->inline_items) {
+    items = (node_t **)xmem_alloc(capacity * sizeof(node_t *));
+    if (items != NULL) {
+      memcpy(items, _list->items, used);
+    }
+  } else {
+    items = (node_t **)xmem_realloc(
+        _list->items, used, capacity * sizeof(node_t *));
+  }
+  if (items == NULL) {
+    return -2;
   }
-  _list->it = _list->head;
-  return _list->it->next;
+  _list->items = items;
+  _list->capacity = capacity;
+  return 0;
 }
 
-// return the next element
+// start a walk at the first element
+void xlist_iter_init(xlist_iter_t *_iter, const xlist_t *_list) {
+  if (_iter == NULL) {
+    return;
+  }
+  _iter->list = _list;
+  _iter->index = 0;
+}
+
+// return the current element
 // and move the iterator to next
-node_t *xlist_next(xlist_t *_list) {
-  if (_list == NULL) {
+const node_t *xlist_iter_next(xlist_iter_t *_iter) {
+  if (_iter == NULL || _iter->list == NULL) {
     return NULL;
   }
-  if (_list->it == NULL) {
+  if (_iter->index >= _iter->list->count) {
     return NULL;
   }
-  _list->it = _list->it->next;
-  return _list->it->next;
+  return _iter->list->items[_iter->index++];
+}
+
+// return the element at _index
+node_t *xlist_at(const xlist_t *_list, size_t _index) {
+  if (_list == NULL || _index >= _list->count) {
+    return NULL;
+  }
+  return _list->items[_index];
 }
 
 // return the number of elements
-size_t xlist_count(xlist_t *_list) {
+size_t xlist_count(const xlist_t *_list) {
   if (_list == NULL) {
     return 0;
   }
@@ -77,10 +109,11 @@ int xlist_append(xlist_t *_list, node_t *_node) {
   if (_list == NULL || _node == NULL) {
     return -1;
   }
-  _list->tail->next = _node;
-
-  _list->tail = _list->tail->next;
-  _list->count++;
+  if (_list->count == _list->capacity &&
+      xlist_grow(_list) < 0) {
+    return -2;
+  }
+  _list->items[_list->count++] = _node;
   return 0;
 }
 
@@ -89,22 +122,25 @@ int xlist_insert(xlist_t *_list, node_t *_node) {
   if (_list == NULL || _node == NULL) {
     return -1;
   }
-  _node->next = _list->head->next;
-  _list->head->next = _node;
-
+  if (_list->count == _list->capacity &&
+      xlist_grow(_list) < 0) {
+    return -2;
+  }
+  memmove(_list->items + 1, _list->items,
+          _list->count * sizeof(node_t *));
+  _list->items[0] = _node;
   _list->count++;
   return 0;
 }
 
 // remove the first element and return it
 node_t *xlist_remove_head(xlist_t *_list) {
-  if (_list == NULL) {
+  if (_list == NULL || _list->count == 0) {
     return NULL;
   }
-  node_t *node = _list->head->next;
-  if (node != NULL) {
-    _list->head->next = node->next;
-    _list->count--;
-  }
+  node_t *node = _list->items[0];
+  _list->count--;
+  memmove(_list->items, _list->items + 1,
+          _list->count * sizeof(node_t *));
   return node;
 }
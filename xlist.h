@@ -12,22 +12,31 @@ typedef struct node_t node_t;
 
 typedef struct xlist_t xlist_t;
 
+// cursor of a walk over a list, lives on the stack of the walker
+// so any number of walks may run over one list at the same time
+typedef struct xlist_iter_t {
+    const xlist_t *list;
+    size_t index;
+} xlist_iter_t;
+
 // create a list instance
 xlist_t *xlist_create();
 
 // destroy the xlist instance
 void xlist_destroy(xlist_t *_list);
 
-// return the first element
-// and reset the iterator to head
-node_t *xlist_begin(xlist_t *_list);
+// start a walk at the first element
+void xlist_iter_init(xlist_iter_t *_iter, const xlist_t *_list);
 
-// return the next element
+// return the current element
 // and move the iterator to next
-node_t *xlist_next(xlist_t *_list);
+const node_t *xlist_iter_next(xlist_iter_t *_iter);
+
+// return the element at _index, NULL when out of range
+node_t *xlist_at(const xlist_t *_list, size_t _index);
 
 // return the number of elements
-size_t xlist_count(xlist_t *_list);
+size_t xlist_count(const xlist_t *_list);
 
 // insert the new element to head
 int xlist_insert(xlist_t *_list, node_t *_node);
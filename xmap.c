@@ -0,0 +1,114 @@
+#include "xmap.h"
+
+#include <stdlib.h>
+
+#include "xmem.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+/*********************************xmap_t*********************************/
+
+typedef struct xmap_t {
+    const unsigned char *data;
+    size_t size;
+} xmap_t;
+
+xmap_t *xmap_open(const char *_path) {
+    if (_path == NULL) {
+        return NULL;
+    }
+    xmap_t *map = (xmap_t *) xmem_alloc(sizeof(xmap_t));
+    if (map == NULL) {
+        return NULL;
+    }
+    map->data = NULL;
+    map->size = 0;
+#if defined(_WIN32)
+    HANDLE file = CreateFileA(
+            _path, GENERIC_READ, FILE_SHARE_READ, NULL,
+            OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, NULL);
+    if (file == INVALID_HANDLE_VALUE) {
+        xmem_free(map);
+        return NULL;
+    }
+    LARGE_INTEGER size;
+    if (GetFileType(file) != FILE_TYPE_DISK ||
+        !GetFileSizeEx(file, &size) ||
+        (unsigned long long) size.QuadPart > (size_t) -1) {
+        CloseHandle(file);
+        xmem_free(map);
+        return NULL;
+    }
+    map->size = (size_t) size.QuadPart;
+    if (map->size > 0) {
+        HANDLE mapping = CreateFileMappingA(
+                file, NULL, PAGE_READONLY, 0, 0, NULL);
+        if (mapping != NULL) {
+            map->data = (const unsigned char *) MapViewOfFile(
+                    mapping, FILE_MAP_READ, 0, 0, 0);
+            // the view keeps the mapping alive
+            CloseHandle(mapping);
+        }
+    }
+    CloseHandle(file);
+#else
+    int fd = open(_path, O_RDONLY);
+    if (fd < 0) {
+        xmem_free(map);
+        return NULL;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || !S_ISREG(st.st_mode) ||
+        (unsigned long long) st.st_size > (size_t) -1) {
+        close(fd);
+        xmem_free(map);
+        return NULL;
+    }
+    map->size = (size_t) st.st_size;
+    if (map->size > 0) {
+        void *data = mmap(
+                NULL, map->size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (data != MAP_FAILED) {
+            // read ahead aggressively, pages are visited once
+            madvise(data, map->size, MADV_SEQUENTIAL);
+            map->data = (const unsigned char *) data;
+        }
+    }
+    // the mapping stays valid once the descriptor is closed
+    close(fd);
+#endif
+    if (map->size > 0 && map->data == NULL) {
+        xmem_free(map);
+        return NULL;
+    }
+    return map;
+}
+
+void xmap_close(xmap_t *_map) {
+    if (_map == NULL) {
+        return;
+    }
+    if (_map->data != NULL) {
+#if defined(_WIN32)
+        UnmapViewOfFile(_map->data);
+#else
+        munmap((void *) _map->data, _map->size);
+#endif
+    }
+    xmem_free(_map);
+}
+
+const unsigned char *xmap_data(const xmap_t *_map) {
+    return _map == NULL ? NULL : _map->data;
+}
+
+size_t xmap_size(const xmap_t *_map) {
+    return _map == NULL ? 0 : _map->size;
+}
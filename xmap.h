@@ -0,0 +1,31 @@
+#ifndef X_MAP_H
+#define X_MAP_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+/*********************************xmap_t*********************************/
+
+// read only mapping of a whole file,
+// thin wrapper of win32 file mappings and mmap
+typedef struct xmap_t xmap_t;
+
+// map the file at _path, NULL when it cannot be mapped
+// (pipes, devices) and must be read instead
+xmap_t *xmap_open(const char *_path);
+
+void xmap_close(xmap_t *_map);
+
+// contents of the mapping, NULL for an empty file
+const unsigned char *xmap_data(const xmap_t *_map);
+
+size_t xmap_size(const xmap_t *_map);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // !X_MAP_H
@@ -0,0 +1,252 @@
+#include "xmem.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#define XARENA_ALIGN (2 * sizeof(void *))
+#define XARENA_ROUND(size) \
+        (((size) + XARENA_ALIGN - 1) & ~(XARENA_ALIGN - 1))
+
+/*********************************xallocator_t*********************************/
+
+static void *xheap_alloc(void *_ctx, size_t _size) {
+    return malloc(_size);
+}
+
+static void *xheap_realloc(void *_ctx, void *_ptr, size_t _size) {
+    return realloc(_ptr, _size);
+}
+
+static void xheap_free(void *_ctx, void *_ptr) {
+    free(_ptr);
+}
+
+static xallocator_t g_global = {
+        xheap_alloc,
+        xheap_realloc,
+        xheap_free,
+        NULL,
+};
+
+static X_THREAD_LOCAL const xallocator_t *g_alloc = NULL;
+
+// replace the process wide allocator, NULL restores malloc.
+// call it before any allocation is made through xmem
+void xmem_set_allocator(const xallocator_t *_alloc) {
+    if (_alloc == NULL || _alloc->alloc == NULL ||
+        _alloc->free == NULL) {
+        g_global.alloc = xheap_alloc;
+        g_global.realloc = xheap_realloc;
+        g_global.free = xheap_free;
+        g_global.context = NULL;
+        return;
+    }
+    g_global = (*_alloc);
+}
+
+// return the process wide allocator
+const xallocator_t *xmem_global() {
+    return &g_global;
+}
+
+// bind the allocator to the calling thread, NULL for the
+// process wide one, and return the previously bound one
+const xallocator_t *xmem_bind(const xallocator_t *_alloc) {
+    const xallocator_t *prev = g_alloc;
+    g_alloc = _alloc;
+    return prev;
+}
+
+// the allocator serving the calling thread
+static const xallocator_t *xmem_current() {
+    if (g_alloc != NULL) {
+        return g_alloc;
+    }
+    return &g_global;
+}
+
+/*********************************xarena_t*********************************/
+
+typedef struct xchunk_t {
+    struct xchunk_t *next;
+    size_t size;
+    size_t used;
+} xchunk_t;
+
+typedef struct xarena_t {
+    xchunk_t *head;
+    xchunk_t *curr;
+    size_t chunk;
+    xallocator_t alloc; // owner of the chunks
+} xarena_t;
+
+static X_THREAD_LOCAL xarena_t *g_arena = NULL;
+
+static xchunk_t *xchunk_create(
+        const xallocator_t *_alloc, size_t _size) {
+    size_t head = XARENA_ROUND(sizeof(xchunk_t));
+    xchunk_t *chunk = (xchunk_t *) _alloc->alloc(
+            _alloc->context, head + _size);
+    if (chunk == NULL) {
+        return chunk;
+    }
+    chunk->next = NULL;
+    chunk->size = _size;
+    chunk->used = 0;
+    return chunk;
+}
+
+static void *xchunk_bump(xchunk_t *_chunk, size_t _size) {
+    if (_chunk->size - _chunk->used < _size) {
+        return NULL;
+    }
+    size_t head = XARENA_ROUND(sizeof(xchunk_t));
+    unsigned char *data = (unsigned char *) _chunk + head;
+    void *block = data + _chunk->used;
+    _chunk->used += _size;
+    return block;
+}
+
+// create an arena, _chunk is the minimum size of each chunk
+xarena_t *xarena_create(size_t _chunk) {
+    if (_chunk < 256) {
+        _chunk = 256;
+    }
+    _chunk = XARENA_ROUND(_chunk);
+    const xallocator_t *alloc = xmem_current();
+    xchunk_t *chunk = xchunk_create(alloc, _chunk);
+    if (chunk == NULL) {
+        return NULL;
+    }
+    // the arena itself is the first block of its first chunk
+    xarena_t *arena = (xarena_t *) xchunk_bump(
+            chunk, XARENA_ROUND(sizeof(xarena_t)));
+    arena->head = chunk;
+    arena->curr = chunk;
+    arena->chunk = _chunk;
+    arena->alloc = (*alloc);
+    return arena;
+}
+
+// destroy the arena and all blocks allocated from it
+void xarena_destroy(xarena_t *_arena) {
+    if (_arena == NULL) {
+        return;
+    }
+    if (g_arena == _arena) {
+        g_arena = NULL;
+    }
+    // the arena lives in its first chunk
+    xallocator_t alloc = _arena->alloc;
+    xchunk_t *chunk = _arena->head;
+    while (chunk != NULL) {
+        xchunk_t *next = chunk->next;
+        alloc.free(alloc.context, chunk);
+        chunk = next;
+    }
+}
+
+// allocate a block by bumping the current chunk
+void *xarena_alloc(xarena_t *_arena, size_t _size) {
+    if (_arena == NULL) {
+        return NULL;
+    }
+    if (_size == 0) {
+        _size = 1;
+    }
+    _size = XARENA_ROUND(_size);
+    xchunk_t *chunk = _arena->curr;
+    void *block = xchunk_bump(chunk, _size);
+    while (block == NULL && chunk->next != NULL) {
+        // chunks kept by xarena_reset
+        chunk = chunk->next;
+        block = xchunk_bump(chunk, _size);
+    }
+    if (block != NULL) {
+        _arena->curr = chunk;
+        return block;
+    }
+    size_t size = _arena->chunk;
+    if (size < _size) {
+        size = _size;
+    }
+    xchunk_t *fresh = xchunk_create(&_arena->alloc, size);
+    if (fresh == NULL) {
+        return NULL;
+    }
+    chunk->next = fresh;
+    _arena->curr = fresh;
+    return xchunk_bump(fresh, _size);
+}
+
+// drop all blocks but keep the chunks for reuse
+void xarena_reset(xarena_t *_arena) {
+    if (_arena == NULL) {
+        return;
+    }
+    xchunk_t *chunk = _arena->head;
+    while (chunk != NULL) {
+        chunk->used = 0;
+        chunk = chunk->next;
+    }
+    // keep the arena header alive
+    xchunk_bump(_arena->head, XARENA_ROUND(sizeof(xarena_t)));
+    _arena->curr = _arena->head;
+}
+
+// bind the arena to the calling thread
+// and return the previously bound one
+xarena_t *xarena_bind(xarena_t *_arena) {
+    xarena_t *prev = g_arena;
+    g_arena = _arena;
+    return prev;
+}
+
+// return the arena bound to the calling thread
+xarena_t *xarena_current() {
+    return g_arena;
+}
+
+/*********************************xmem*********************************/
+
+// return 1 when blocks come from the process wide allocator,
+// neither an arena nor an allocator is bound
+int xmem_is_global() {
+    return g_arena == NULL && g_alloc == NULL;
+}
+
+// allocate from the bound arena, or from the bound allocator
+void *xmem_alloc(size_t _size) {
+    if (g_arena != NULL) {
+        return xarena_alloc(g_arena, _size);
+    }
+    const xallocator_t *alloc = xmem_current();
+    return alloc->alloc(alloc->context, _size);
+}
+
+// resize a block of _old bytes to _size bytes
+void *xmem_realloc(void *_ptr, size_t _old, size_t _size) {
+    if (_ptr == NULL) {
+        return xmem_alloc(_size);
+    }
+    const xallocator_t *alloc = xmem_current();
+    if (g_arena == NULL && alloc->realloc != NULL) {
+        return alloc->realloc(alloc->context, _ptr, _size);
+    }
+    void *block = xmem_alloc(_size);
+    if (block == NULL) {
+        return NULL;
+    }
+    memcpy(block, _ptr, _old < _size ? _old : _size);
+    xmem_free(_ptr);
+    return block;
+}
+
+// release a block, nothing to do while an arena is bound
+void xmem_free(void *_ptr) {
+    if (g_arena != NULL || _ptr == NULL) {
+        return;
+    }
+    const xallocator_t *alloc = xmem_current();
+    alloc->free(alloc->context, _ptr);
+}
@@ -0,0 +1,85 @@
+#ifndef X_MEM_H
+#define X_MEM_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#if defined(_MSC_VER)
+#define X_THREAD_LOCAL __declspec(thread)
+#else
+#define X_THREAD_LOCAL _Thread_local
+#endif
+
+/*********************************xallocator_t*********************************/
+
+// allocator hooks, _ctx is the context of the allocator.
+// realloc may be NULL, it is then done by alloc, copy and free
+typedef struct xallocator_t {
+    void *(*alloc)(void *_ctx, size_t _size);
+
+    void *(*realloc)(void *_ctx, void *_ptr, size_t _size);
+
+    void (*free)(void *_ctx, void *_ptr);
+
+    void *context;
+} xallocator_t;
+
+// replace the process wide allocator, NULL restores malloc.
+// call it before any allocation is made through xmem
+void xmem_set_allocator(const xallocator_t *_alloc);
+
+// return the process wide allocator
+const xallocator_t *xmem_global();
+
+// bind the allocator to the calling thread, NULL for the
+// process wide one, and return the previously bound one
+const xallocator_t *xmem_bind(const xallocator_t *_alloc);
+
+// return 1 when blocks come from the process wide allocator,
+// neither an arena nor an allocator is bound
+int xmem_is_global();
+
+/*********************************xarena_t*********************************/
+
+// bump allocator, every block lives until reset or destroy
+typedef struct xarena_t xarena_t;
+
+// create an arena, _chunk is the minimum size of each chunk,
+// the chunks come from the allocator bound at creation
+xarena_t *xarena_create(size_t _chunk);
+
+// destroy the arena and all blocks allocated from it
+void xarena_destroy(xarena_t *_arena);
+
+// allocate a block by bumping the current chunk
+void *xarena_alloc(xarena_t *_arena, size_t _size);
+
+// drop all blocks but keep the chunks for reuse
+void xarena_reset(xarena_t *_arena);
+
+// bind the arena to the calling thread
+// and return the previously bound one
+xarena_t *xarena_bind(xarena_t *_arena);
+
+// return the arena bound to the calling thread
+xarena_t *xarena_current();
+
+/*********************************xmem*********************************/
+
+// allocate from the bound arena, or from the bound allocator
+void *xmem_alloc(size_t _size);
+
+// resize a block of _old bytes to _size bytes
+void *xmem_realloc(void *_ptr, size_t _old, size_t _size);
+
+// release a block, nothing to do while an arena is bound
+void xmem_free(void *_ptr);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // !X_MEM_H
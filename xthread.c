@@ -0,0 +1,212 @@
+#include "xthread.h"
+
+#include <stdlib.h>
+
+#include "xmem.h"
+
+#if defined(_WIN32)
+#include <windows.h>
+#else
+#include <pthread.h>
+#include <unistd.h>
+#endif
+
+/*********************************xthread_t*********************************/
+
+typedef struct xthread_t {
+#if defined(_WIN32)
+    HANDLE handle;
+#else
+    pthread_t handle;
+#endif
+    void (*func)(void *);
+    void *arg;
+} xthread_t;
+
+#if defined(_WIN32)
+static DWORD WINAPI xthread_entry(LPVOID _thread) {
+    xthread_t *thread = (xthread_t *) _thread;
+    thread->func(thread->arg);
+    return 0;
+}
+#else
+static void *xthread_entry(void *_thread) {
+    xthread_t *thread = (xthread_t *) _thread;
+    thread->func(thread->arg);
+    return NULL;
+}
+#endif
+
+// start _func(_arg) on a new thread
+xthread_t *xthread_create(void (*_func)(void *), void *_arg) {
+    if (_func == NULL) {
+        return NULL;
+    }
+    xthread_t *thread = (xthread_t *) xmem_alloc(sizeof(xthread_t));
+    if (thread == NULL) {
+        return NULL;
+    }
+    thread->func = _func;
+    thread->arg = _arg;
+#if defined(_WIN32)
+    thread->handle = CreateThread(
+            NULL, 0, xthread_entry, thread, 0, NULL);
+    if (thread->handle == NULL) {
+        xmem_free(thread);
+        return NULL;
+    }
+#else
+    if (pthread_create(&thread->handle, NULL,
+                       xthread_entry, thread) != 0) {
+        xmem_free(thread);
+        return NULL;
+    }
+#endif
+    return thread;
+}
+
+// wait for the thread to finish and release it
+int xthread_join(xthread_t *_thread) {
+    if (_thread == NULL) {
+        return -1;
+    }
+#if defined(_WIN32)
+    WaitForSingleObject(_thread->handle, INFINITE);
+    CloseHandle(_thread->handle);
+#else
+    pthread_join(_thread->handle, NULL);
+#endif
+    xmem_free(_thread);
+    return 0;
+}
+
+// return the number of online processors
+unsigned int xthread_cpus() {
+#if defined(_WIN32)
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return (unsigned int) info.dwNumberOfProcessors;
+#else
+    long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+    if (cpus < 1) {
+        return 1;
+    }
+    return (unsigned int) cpus;
+#endif
+}
+
+/*********************************xmutex_t*********************************/
+
+typedef struct xmutex_t {
+#if defined(_WIN32)
+    CRITICAL_SECTION handle;
+#else
+    pthread_mutex_t handle;
+#endif
+} xmutex_t;
+
+xmutex_t *xmutex_create() {
+    xmutex_t *mutex = (xmutex_t *) xmem_alloc(sizeof(xmutex_t));
+    if (mutex == NULL) {
+        return NULL;
+    }
+#if defined(_WIN32)
+    InitializeCriticalSection(&mutex->handle);
+#else
+    if (pthread_mutex_init(&mutex->handle, NULL) != 0) {
+        xmem_free(mutex);
+        return NULL;
+    }
+#endif
+    return mutex;
+}
+
+void xmutex_destroy(xmutex_t *_mutex) {
+    if (_mutex == NULL) {
+        return;
+    }
+#if defined(_WIN32)
+    DeleteCriticalSection(&_mutex->handle);
+#else
+    pthread_mutex_destroy(&_mutex->handle);
+#endif
+    xmem_free(_mutex);
+}
+
+void xmutex_lock(xmutex_t *_mutex) {
+#if defined(_WIN32)
+    EnterCriticalSection(&_mutex->handle);
+#else
+    pthread_mutex_lock(&_mutex->handle);
+#endif
+}
+
+void xmutex_unlock(xmutex_t *_mutex) {
+#if defined(_WIN32)
+    LeaveCriticalSection(&_mutex->handle);
+#else
+    pthread_mutex_unlock(&_mutex->handle);
+#endif
+}
+
+/*********************************xcond_t*********************************/
+
+typedef struct xcond_t {
+#if defined(_WIN32)
+    CONDITION_VARIABLE handle;
+#else
+    pthread_cond_t handle;
+#endif
+} xcond_t;
+
+xcond_t *xcond_create() {
+    xcond_t *cond = (xcond_t *) xmem_alloc(sizeof(xcond_t));
+    if (cond == NULL) {
+        return NULL;
+    }
+#if defined(_WIN32)
+    InitializeConditionVariable(&cond->handle);
+#else
+    if (pthread_cond_init(&cond->handle, NULL) != 0) {
+        xmem_free(cond);
+        return NULL;
+    }
+#endif
+    return cond;
+}
+
+void xcond_destroy(xcond_t *_cond) {
+    if (_cond == NULL) {
+        return;
+    }
+#if !defined(_WIN32)
+    pthread_cond_destroy(&_cond->handle);
+#endif
+    xmem_free(_cond);
+}
+
+// release _mutex, sleep until signaled and lock it again
+void xcond_wait(xcond_t *_cond, xmutex_t *_mutex) {
+#if defined(_WIN32)
+    SleepConditionVariableCS(
+            &_cond->handle, &_mutex->handle, INFINITE);
+#else
+    pthread_cond_wait(&_cond->handle, &_mutex->handle);
+#endif
+}
+
+void xcond_signal(xcond_t *_cond) {
+#if defined(_WIN32)
+    WakeConditionVariable(&_cond->handle);
+#else
+    pthread_cond_signal(&_cond->handle);
+#endif
+}
+
+void xcond_broadcast(xcond_t *_cond) {
+#if defined(_WIN32)
+    WakeAllConditionVariable(&_cond->handle);
+#else
+    pthread_cond_broadcast(&_cond->handle);
+#endif
+}
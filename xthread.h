@@ -0,0 +1,53 @@
+#ifndef X_THREAD_H
+#define X_THREAD_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+/*********************************xthread_t*********************************/
+
+// thin wrapper of win32 threads and pthreads
+typedef struct xthread_t xthread_t;
+
+// start _func(_arg) on a new thread
+xthread_t *xthread_create(void (*_func)(void *), void *_arg);
+
+// wait for the thread to finish and release it
+int xthread_join(xthread_t *_thread);
+
+// return the number of online processors
+unsigned int xthread_cpus();
+
+/*********************************xmutex_t*********************************/
+
+typedef struct xmutex_t xmutex_t;
+
+xmutex_t *xmutex_create();
+
+void xmutex_destroy(xmutex_t *_mutex);
+
+void xmutex_lock(xmutex_t *_mutex);
+
+void xmutex_unlock(xmutex_t *_mutex);
+
+/*********************************xcond_t*********************************/
+
+typedef struct xcond_t xcond_t;
+
+xcond_t *xcond_create();
+
+void xcond_destroy(xcond_t *_cond);
+
+// release _mutex, sleep until signaled and lock it again
+void xcond_wait(xcond_t *_cond, xmutex_t *_mutex);
+
+void xcond_signal(xcond_t *_cond);
+
+void xcond_broadcast(xcond_t *_cond);
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // !X_THREAD_H
@@ -0,0 +1,55 @@
+#include "xtlv.h"
+
+/*********************************xtlv_t*********************************/
+
+int xtlv_indefinite(
+        const unsigned char *_data, const unsigned char *_end,
+        unsigned int *_length) {
+    const unsigned char *data = _data;
+    // indefinite encodings opened inside the contents
+    size_t open = 0;
+    while (data < _end) {
+        if (data[0] == 0x00) {
+            // end-of-contents
+            if (_end - data < 2 || data[1] != 0x00) {
+                return XTLV_ERR_LENGTH;
+            }
+            if (open == 0) {
+                (*_length) = (unsigned int) (data - _data);
+                return 0;
+            }
+            open--;
+            data += 2;
+            continue;
+        }
+        int constructed = (data[0] & 0x20) != 0;
+        if ((data[0] & 0x1f) == 0x1f) {
+            data++;
+            while (data < _end && (data[0] & 0x80)) {
+                data++;
+            }
+            if (data == _end) {
+                return XTLV_ERR_LENGTH;
+            }
+        }
+        data++;
+        xtlv_t tlv;
+        xtlv_init(&tlv, data, _end - data);
+        unsigned int length = 0;
+        if (xtlv_read_length(&tlv, &length) < 0) {
+            return XTLV_ERR_LENGTH;
+        }
+        if (length == XTLV_INDEFINITE) {
+            if (!constructed) {
+                return XTLV_ERR_LENGTH;
+            }
+            open++;
+        } else if (length > xtlv_left(&tlv)) {
+            return XTLV_ERR_LENGTH;
+        } else {
+            tlv.data += length;
+        }
+        data = tlv.data;
+    }
+    return XTLV_ERR_LENGTH;
+}
@@ -0,0 +1,241 @@
+#ifndef X_TLV_H
+#define X_TLV_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif  // __cplusplus
+
+#if defined(_MSC_VER)
+#define X_INLINE static __inline
+#else
+#define X_INLINE static inline
+#endif
+
+// the tlv does not fit into the bytes left
+#define XTLV_ERR_LENGTH (-1)
+// the tag differs from the expected one
+#define XTLV_ERR_TAG (-2)
+
+// length of the indefinite form, the contents
+// end at the end-of-contents octets 00 00
+#define XTLV_INDEFINITE (0xffffffffu)
+
+/*********************************xtlv_t*********************************/
+
+// cursor over BER encoded data. every read is checked against
+// end once, so a decoder can not run past its slice
+typedef struct xtlv_t {
+    const unsigned char *data; // next byte
+    const unsigned char *end; // past the last byte
+} xtlv_t;
+
+X_INLINE void xtlv_init(
+        xtlv_t *_tlv, const unsigned char *_data,
+        size_t _length) {
+    _tlv->data = _data;
+    _tlv->end = _data + _length;
+}
+
+// number of bytes left
+X_INLINE size_t xtlv_left(const xtlv_t *_tlv) {
+    return (size_t) (_tlv->end - _tlv->data);
+}
+
+// next tag without consuming it, XTLV_ERR_LENGTH at the end
+X_INLINE int xtlv_peek(const xtlv_t *_tlv) {
+    if (_tlv->data >= _tlv->end) {
+        return XTLV_ERR_LENGTH;
+    }
+    return _tlv->data[0];
+}
+
+// consume one byte
+X_INLINE int xtlv_byte(xtlv_t *_tlv) {
+    if (_tlv->data >= _tlv->end) {
+        return XTLV_ERR_LENGTH;
+    }
+    return *_tlv->data++;
+}
+
+// consume _tag, the cursor stays in place on a mismatch
+X_INLINE int xtlv_tag(xtlv_t *_tlv, int _tag) {
+    if (_tlv->data >= _tlv->end) {
+        return XTLV_ERR_LENGTH;
+    }
+    if (_tlv->data[0] != _tag) {
+        return XTLV_ERR_TAG;
+    }
+    _tlv->data++;
+    return 0;
+}
+
+// consume a length: short form, long form of up to four bytes
+// or XTLV_INDEFINITE. the announced contents may exceed the bytes left
+X_INLINE int xtlv_read_length(
+        xtlv_t *_tlv, unsigned int *_length) {
+    if (_tlv->data >= _tlv->end) {
+        return XTLV_ERR_LENGTH;
+    }
+    unsigned int length = _tlv->data[0];
+    if (length < 0x80) {
+        _tlv->data++;
+        (*_length) = length;
+        return 0;
+    }
+    size_t size = length - 0x80;
+    if (size == 0) {
+        _tlv->data++;
+        (*_length) = XTLV_INDEFINITE;
+        return 0;
+    }
+    if (size > sizeof(unsigned int) ||
+        size >= xtlv_left(_tlv)) {
+        return XTLV_ERR_LENGTH;
+    }
+    length = 0;
+    size_t idx = 1;
+    while (idx <= size) {
+        length <<= 8;
+        length += _tlv->data[idx++];
+    }
+    if (length == XTLV_INDEFINITE) {
+        return XTLV_ERR_LENGTH;
+    }
+    _tlv->data += idx;
+    (*_length) = length;
+    return 0;
+}
+
+// consume a definite length whose contents fit into the bytes left,
+// the form of primitive encodings
+X_INLINE int xtlv_length(xtlv_t *_tlv, unsigned int *_length) {
+    const unsigned char *data = _tlv->data;
+    int ret = xtlv_read_length(_tlv, _length);
+    if (ret < 0) {
+        return ret;
+    }
+    if ((*_length) > xtlv_left(_tlv)) {
+        _tlv->data = data;
+        return XTLV_ERR_LENGTH;
+    }
+    return 0;
+}
+
+// consume _tag and its definite length
+X_INLINE int xtlv_expect(
+        xtlv_t *_tlv, int _tag, unsigned int *_length) {
+    int ret = xtlv_tag(_tlv, _tag);
+    if (ret < 0) {
+        return ret;
+    }
+    return xtlv_length(_tlv, _length);
+}
+
+// length of indefinite contents starting at _data, walked up to
+// their end-of-contents octets. nested indefinite encodings are
+// counted instead of recursed into
+int xtlv_indefinite(
+        const unsigned char *_data, const unsigned char *_end,
+        unsigned int *_length);
+
+// consume a length and the contents it announces, _inner covers
+// them. the end-of-contents octets of the indefinite form are
+// consumed but not covered
+X_INLINE int xtlv_contents(xtlv_t *_tlv, xtlv_t *_inner) {
+    const unsigned char *data = _tlv->data;
+    unsigned int length = 0;
+    int ret = xtlv_read_length(_tlv, &length);
+    if (ret < 0) {
+        return ret;
+    }
+    size_t eoc = 0;
+    if (length == XTLV_INDEFINITE) {
+        ret = xtlv_indefinite(_tlv->data, _tlv->end, &length);
+        eoc = 2;
+    }
+    if (ret < 0 || length > xtlv_left(_tlv)) {
+        _tlv->data = data;
+        return XTLV_ERR_LENGTH;
+    }
+    _inner->data = _tlv->data;
+    _inner->end = _tlv->data + length;
+    _tlv->data += length + eoc;
+    return 0;
+}
+
+// consume a whole tlv tagged _tag, _inner covers its contents
+X_INLINE int xtlv_enter(xtlv_t *_tlv, int _tag, xtlv_t *_inner) {
+    int ret = xtlv_tag(_tlv, _tag);
+    if (ret < 0) {
+        return ret;
+    }
+    ret = xtlv_contents(_tlv, _inner);
+    if (ret < 0) {
+        _tlv->data--;
+    }
+    return ret;
+}
+
+// consume _length bytes and return them, NULL if they are missing
+X_INLINE const unsigned char *xtlv_bytes(
+        xtlv_t *_tlv, unsigned int _length) {
+    if (_length > xtlv_left(_tlv)) {
+        return NULL;
+    }
+    const unsigned char *data = _tlv->data;
+    _tlv->data += _length;
+    return data;
+}
+
+// consume a big endian unsigned integer of _length bytes
+X_INLINE int xtlv_uint(
+        xtlv_t *_tlv, unsigned int _length,
+        unsigned int *_value) {
+    if (_length > sizeof(unsigned int) ||
+        _length > xtlv_left(_tlv)) {
+        return XTLV_ERR_LENGTH;
+    }
+    unsigned int value = 0;
+    unsigned int idx = 0;
+    while (idx < _length) {
+        value <<= 8;
+        value += _tlv->data[idx++];
+    }
+    _tlv->data += _length;
+    (*_value) = value;
+    return 0;
+}
+
+// consume a whole tlv of any tag
+X_INLINE int xtlv_skip(xtlv_t *_tlv) {
+    if (_tlv->data >= _tlv->end) {
+        return XTLV_ERR_LENGTH;
+    }
+    const unsigned char *data = _tlv->data++;
+    // tag numbers above 30 follow in base 128
+    if ((data[0] & 0x1f) == 0x1f) {
+        while (_tlv->data < _tlv->end && (_tlv->data[0] & 0x80)) {
+            _tlv->data++;
+        }
+        if (_tlv->data < _tlv->end) {
+            _tlv->data++;
+        }
+    }
+    xtlv_t inner;
+    int ret = XTLV_ERR_LENGTH;
+    if (_tlv->data < _tlv->end) {
+        ret = xtlv_contents(_tlv, &inner);
+    }
+    if (ret < 0) {
+        _tlv->data = data;
+    }
+    return ret;
+}
+
+#ifdef __cplusplus
+}
+#endif  // __cplusplus
+
+#endif  // !X_TLV_H
@@ -8,6 +8,7 @@
 #include <time.h>
 
 #include "node.h"
+#include "xmem.h"
 
 const char *mmsstr_set_data_auto(mmsstr_t *_str, const char *_data) {
     if (_str == NULL || _data == NULL) {
@@ -17,36 +18,72 @@ const char *mmsstr_set_data_auto(mmsstr_t *_str, const char *_data) {
     return mmsstr_set_data(_str, _data, length);
 }
 
+static X_THREAD_LOCAL int g_borrow = 0;
+
+// release the long string if the instance owns it
+static void mmsstr_release(mmsstr_t *_str) {
+    if (_str->borrow) {
+        _str->borrow = 0;
+        _str->data.long_str = NULL;
+        return;
+    }
+    if (_str->length >= STRING_SHORT_SIZE) {
+        xmem_free(_str->data.long_str);
+        _str->data.long_str = NULL;
+    }
+}
+
 const char *mmsstr_set_data(mmsstr_t *_str, const char *_data,
                             unsigned int _length) {
     if (_str == NULL || _data == NULL || _length == 0) {
         return NULL;
     }
+    if (g_borrow) {
+        return mmsstr_set_view(_str, _data, _length);
+    }
     char *dest = _str->data.short_str;
     if (_length >= STRING_SHORT_SIZE) {
-        dest = (char *) malloc(_length + 1);
+        dest = (char *) xmem_alloc(_length + 1);
         if (dest == NULL) {
             return NULL;
         }
+    } else {
+        mmsstr_release(_str);
     }
     memcpy(dest, _data, _length);
     dest[_length] = 0;
-    if (_str->length >= STRING_SHORT_SIZE) {
-        free(_str->data.long_str);
-        _str->data.long_str = NULL;
-    }
     if (_length >= STRING_SHORT_SIZE) {
+        mmsstr_release(_str);
         _str->data.long_str = dest;
     }
     _str->length = _length;
     return dest;
 }
 
+const char *mmsstr_set_view(mmsstr_t *_str, const char *_data,
+                            unsigned int _length) {
+    if (_str == NULL || _data == NULL || _length == 0) {
+        return NULL;
+    }
+    mmsstr_release(_str);
+    _str->borrow = 1;
+    _str->data.long_str = (char *) _data;
+    _str->length = _length;
+    return _data;
+}
+
+int mmsstr_borrow_mode(int _borrow) {
+    int prev = g_borrow;
+    g_borrow = _borrow;
+    return prev;
+}
+
 const char *mmsstr_data(const mmsstr_t *_str) {
     if (_str == NULL) {
         return NULL;
     }
-    if (_str->length >= STRING_SHORT_SIZE) {
+    if (_str->borrow ||
+        _str->length >= STRING_SHORT_SIZE) {
         return _str->data.long_str;
     }
     return _str->data.short_str;
@@ -56,10 +93,7 @@ void mmsstr_clear(mmsstr_t *_str) {
     if (_str == NULL) {
         return;
     }
-    if (_str->length >= STRING_SHORT_SIZE) {
-        free(_str->data.long_str);
-        _str->data.long_str = NULL;
-    }
+    mmsstr_release(_str);
     _str->length = 0;
 }
 
@@ -68,6 +102,8 @@ int xvalue_clear(xvalue_t *_value) {
         return -1;
     }
     switch (_value->type) {
+        case VALUE_TYPE_BITS:
+        case VALUE_TYPE_OCTSTR:
         case VALUE_TYPE_STRING: {
             mmsstr_clear(&_value->value._string);
             break;
@@ -95,8 +131,9 @@ int xvalue_to_string(
     switch (_value->type) {
         case VALUE_TYPE_STRUCT: {
             length = snprintf(_dest, _size - 1, "structure:{");
-            xlist_t *list = _value->value._struct;
-            node_t *node = xlist_begin(list);
+            xlist_iter_t iter;
+            xlist_iter_init(&iter, _value->value._struct);
+            const node_t *node = xlist_iter_next(&iter);
             while (node && length < (_size - 1)) {
                 _dest[length++] = ' ';
                 int ret = node_tostring(
@@ -106,7 +143,7 @@ int xvalue_to_string(
                     break;
                 }
                 length += ret;
-                node = xlist_next(list);
+                node = xlist_iter_next(&iter);
             }
             if (length < (_size - 1)) {
                 _dest[length++] = '}';
@@ -117,6 +154,26 @@ int xvalue_to_string(
             _dest[length] = 0;
             break;
         }
+        case VALUE_TYPE_LAZY: {
+            // render a temporary copy from the heap,
+            // the value itself stays lazy
+            const xlazy_t *lazy = &_value->value._lazy;
+            xvalue_t value;
+            memset(&value, 0, sizeof(xvalue_t));
+            value.type = VALUE_TYPE_STRUCT;
+            xarena_t *arena = xarena_bind(NULL);
+            const xallocator_t *alloc = xmem_bind(NULL);
+            lazy->decoder->decode(
+                    lazy->context, lazy->data, lazy->length,
+                    &value.value._struct, 0);
+            if (value.value._struct != NULL) {
+                length = xvalue_to_string(&value, _dest, _size);
+            }
+            xvalue_clear(&value);
+            xmem_bind(alloc);
+            xarena_bind(arena);
+            break;
+        }
         case VALUE_TYPE_BOOL: {
             if (_value->value._bool) {
                 length = snprintf(_dest, _size - 1, "boolean:{true}");
@@ -134,7 +191,8 @@ int xvalue_to_string(
             }
             size--;
             size <<= 3; // *8
-            size -= data[0];
+            // more unused bits than bits is malformed, render none
+            size = data[0] > size ? 0 : size - data[0];
             const char *header = "bit-string:{length:%u, data:";
             length = snprintf(_dest, _size - 1, header, size);
             if (length >= (_size - 1)) {
@@ -225,8 +283,9 @@ int xvalue_to_string(
         }
         case VALUE_TYPE_STRING: {
             length = snprintf(
-                    _dest, _size - 1, "string:{length:%u, data:%s}",
+                    _dest, _size - 1, "string:{length:%u, data:%.*s}",
                     _value->value._string.length,
+                    (int) _value->value._string.length,
                     mmsstr_data(&_value->value._string));
             break;
         }
@@ -455,3 +514,252 @@ int xvalue_set_struct(
     _value->value._struct = _struct;
     return 0;
 }
+
+int xvalue_set_lazy(
+        xvalue_t *_value, const xlazy_t *_lazy) {
+    if (_value == NULL || _lazy == NULL ||
+        _lazy->decoder == NULL) {
+        return -1;
+    }
+    if (_value->type == VALUE_TYPE_INVALID) {
+        _value->type = VALUE_TYPE_LAZY;
+    }
+    if (_value->type != VALUE_TYPE_LAZY) {
+        return -2;
+    }
+    _value->value._lazy = (*_lazy);
+    return 0;
+}
+
+xlist_t *xvalue_struct(xvalue_t *_value) {
+    if (_value == NULL) {
+        return NULL;
+    }
+    if (_value->type == VALUE_TYPE_LAZY) {
+        const xlazy_t lazy = _value->value._lazy;
+        xlist_t *list = NULL;
+        lazy.decoder->decode(
+                lazy.context, lazy.data, lazy.length,
+                &list, 1);
+        if (list == NULL) {
+            return NULL;
+        }
+        _value->type = VALUE_TYPE_STRUCT;
+        _value->value._struct = list;
+    }
+    if (_value->type != VALUE_TYPE_STRUCT) {
+        return NULL;
+    }
+    return _value->value._struct;
+}
+
+unsigned int xvalue_members(const xvalue_t *_value) {
+    if (_value == NULL) {
+        return 0;
+    }
+    if (_value->type == VALUE_TYPE_LAZY) {
+        return _value->value._lazy.count;
+    }
+    if (_value->type != VALUE_TYPE_STRUCT) {
+        return 0;
+    }
+    return (unsigned int) xlist_count(_value->value._struct);
+}
+
+/*********************************xcell_t*********************************/
+
+// cells of the first growth of an array
+#define XCELLS_CAPACITY (16)
+
+static int xcell_is_string(int _type) {
+    return _type == VALUE_TYPE_BITS ||
+           _type == VALUE_TYPE_OCTSTR ||
+           _type == VALUE_TYPE_STRING;
+}
+
+static const char *xcell_payload(const xcell_t *_cell) {
+    if (_cell->length > XCELL_INLINE_SIZE) {
+        return _cell->value._extern;
+    }
+    return _cell->value._inline;
+}
+
+xcells_t *xcells_create() {
+    xcells_t *cells = (xcells_t *) xmem_alloc(sizeof(xcells_t));
+    if (cells == NULL) {
+        return cells;
+    }
+    memset(cells, 0, sizeof(xcells_t));
+    return cells;
+}
+
+void xcells_destroy(xcells_t *_cells) {
+    if (_cells == NULL) {
+        return;
+    }
+    unsigned int idx = 0;
+    while (idx < _cells->count) {
+        const xcell_t *cell = _cells->cells + idx++;
+        if (xcell_is_string(cell->type) && !cell->borrow &&
+            cell->length > XCELL_INLINE_SIZE) {
+            xmem_free((void *) cell->value._extern);
+        }
+    }
+    xmem_free(_cells->cells);
+    xmem_free(_cells);
+}
+
+// reserve the next cell
+static xcell_t *xcells_push(xcells_t *_cells) {
+    if (_cells->count == _cells->capacity) {
+        unsigned int capacity = _cells->capacity * 2;
+        if (capacity == 0) {
+            capacity = XCELLS_CAPACITY;
+        }
+        xcell_t *cells = (xcell_t *) xmem_realloc(
+                _cells->cells, _cells->count * sizeof(xcell_t),
+                capacity * sizeof(xcell_t));
+        if (cells == NULL) {
+            return NULL;
+        }
+        _cells->cells = cells;
+        _cells->capacity = capacity;
+    }
+    xcell_t *cell = _cells->cells + _cells->count++;
+    memset(cell, 0, sizeof(xcell_t));
+    return cell;
+}
+
+// append a scalar value, a payload longer than XCELL_INLINE_SIZE
+// is copied out of line, or kept as a view when _borrow is set
+int xcells_append(
+        xcells_t *_cells, const xvalue_t *_value,
+        int _borrow) {
+    if (_cells == NULL || _value == NULL ||
+        _value->type == VALUE_TYPE_STRUCT) {
+        return -1;
+    }
+    xcell_t *cell = xcells_push(_cells);
+    if (cell == NULL) {
+        return -2;
+    }
+    cell->type = (unsigned char) _value->type;
+    if (!xcell_is_string(_value->type)) {
+        // every scalar of the union fits in 8 bytes
+        memcpy(&cell->value, &_value->value,
+               sizeof(cell->value));
+        return 0;
+    }
+    const mmsstr_t *str = &_value->value._string;
+    const char *data = mmsstr_data(str);
+    cell->length = str->length;
+    if (str->length <= XCELL_INLINE_SIZE) {
+        memcpy(cell->value._inline, data, str->length);
+        return 0;
+    }
+    if (_borrow) {
+        cell->borrow = 1;
+        cell->value._extern = data;
+        return 0;
+    }
+    char *payload = (char *) xmem_alloc(str->length);
+    if (payload == NULL) {
+        _cells->count--;
+        return -2;
+    }
+    memcpy(payload, data, str->length);
+    cell->value._extern = payload;
+    return 0;
+}
+
+// append a structure and return the index of its cell
+int xcells_open(xcells_t *_cells) {
+    if (_cells == NULL) {
+        return -1;
+    }
+    xcell_t *cell = xcells_push(_cells);
+    if (cell == NULL) {
+        return -2;
+    }
+    cell->type = VALUE_TYPE_STRUCT;
+    return (int) (_cells->count - 1);
+}
+
+// close the structure at _index after its members
+int xcells_close(xcells_t *_cells, int _index) {
+    if (_cells == NULL || _index < 0 ||
+        _index >= (int) _cells->count) {
+        return -1;
+    }
+    xcell_t *cell = _cells->cells + _index;
+    cell->length = _cells->count - _index - 1;
+    unsigned int count = 0;
+    const xcell_t *member = cell + 1;
+    const xcell_t *end = _cells->cells + _cells->count;
+    while (member < end) {
+        member = xcell_skip(member);
+        count++;
+    }
+    if (count > 0xffff) {
+        count = 0xffff;
+    }
+    cell->count = (unsigned short) count;
+    return 0;
+}
+
+// return the cell following _cell and its members
+const xcell_t *xcell_skip(const xcell_t *_cell) {
+    if (_cell == NULL) {
+        return NULL;
+    }
+    if (_cell->type == VALUE_TYPE_STRUCT) {
+        return _cell + 1 + _cell->length;
+    }
+    return _cell + 1;
+}
+
+// render the cell like xvalue_to_string
+int xcell_to_string(
+        const xcell_t *_cell,
+        char *_dest, size_t _size) {
+    if (_cell == NULL || _dest == NULL) {
+        return -1;
+    }
+    if (_cell->type != VALUE_TYPE_STRUCT) {
+        // a scalar renders through a value that only views the cell
+        xvalue_t value;
+        memset(&value, 0, sizeof(xvalue_t));
+        value.type = _cell->type;
+        if (xcell_is_string(_cell->type)) {
+            mmsstr_set_view(
+                    &value.value._string,
+                    xcell_payload(_cell), _cell->length);
+        } else {
+            memcpy(&value.value, &_cell->value,
+                   sizeof(_cell->value));
+        }
+        return xvalue_to_string(&value, _dest, _size);
+    }
+    int length = snprintf(_dest, _size - 1, "structure:{");
+    const xcell_t *member = _cell + 1;
+    const xcell_t *end = xcell_skip(_cell);
+    while (member < end && length < (_size - 1)) {
+        _dest[length++] = ' ';
+        int ret = xcell_to_string(
+                member, _dest + length,
+                _size - length);
+        if (ret < 0) {
+            break;
+        }
+        length += ret;
+        member = xcell_skip(member);
+    }
+    if (length < (_size - 1)) {
+        _dest[length++] = '}';
+    }
+    if (length >= (_size - 1)) {
+        length = (int) _size - 1;
+    }
+    _dest[length] = 0;
+    return length;
+}
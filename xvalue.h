@@ -10,6 +10,9 @@ extern "C" {
 #define STRING_SHORT_SIZE (32)
 typedef struct mmsstr_t {
     unsigned int length;
+    // long_str is a view into a buffer owned by the caller,
+    // it is not copied, freed or null terminated
+    unsigned int borrow;
     union data {
         char short_str[STRING_SHORT_SIZE];
         char *long_str;
@@ -23,6 +26,16 @@ const char *mmsstr_set_data(
         mmsstr_t *_str, const char *_data,
         unsigned int _length);
 
+// keep pointer and length, the data must outlive the string
+const char *mmsstr_set_view(
+        mmsstr_t *_str, const char *_data,
+        unsigned int _length);
+
+// make mmsstr_set_data keep views on the calling thread,
+// return the previous mode
+int mmsstr_borrow_mode(int _borrow);
+
+// a borrowed string is not null terminated, use the length
 const char *mmsstr_data(const mmsstr_t *_str);
 
 void mmsstr_clear(mmsstr_t *_str);
@@ -50,6 +63,26 @@ typedef struct binary_time_t
 #define VALUE_TYPE_STRING (0x8a)   // Visiable String
 #define VALUE_TYPE_BINTIME (0x8c)  // Binary Time
 #define VALUE_TYPE_UTCTIME (0x91)  // UTC Time
+#define VALUE_TYPE_LAZY (0x1a2)    // Struct, decoded on first access
+
+// decoder of lazy structures, provided by the parser.
+// with _owned the members join the tree of _ctx,
+// otherwise they come from the calling thread's allocator
+typedef struct xdecoder_t {
+    int (*decode)(
+            const void *_ctx,
+            const unsigned char *_data, unsigned int _length,
+            xlist_t **_list, int _owned);
+} xdecoder_t;
+
+// structure kept as the slice of its members
+typedef struct xlazy_t {
+    const unsigned char *data;
+    unsigned int length;
+    unsigned int count; // number of members
+    const xdecoder_t *decoder;
+    const void *context;
+} xlazy_t;
 
 typedef struct xvalue_t xvalue_t;
 
@@ -64,6 +97,7 @@ typedef struct xvalue_t {
         float _float;
         mmsstr_t _string;
         xlist_t *_struct;
+        xlazy_t _lazy;
     } value;
 } xvalue_t;
 
@@ -109,6 +143,74 @@ int xvalue_set_struct(
         xvalue_t *_value,
         xlist_t *_struct);
 
+// keep a structure undecoded, the slice must outlive the value
+int xvalue_set_lazy(
+        xvalue_t *_value,
+        const xlazy_t *_lazy);
+
+// return the members of a structure, a lazy one is decoded
+// and replaced by them. decoding changes the value, so a lazy
+// value must not be shared between threads before
+xlist_t *xvalue_struct(xvalue_t *_value);
+
+// return the number of members without decoding them
+unsigned int xvalue_members(const xvalue_t *_value);
+
+/*********************************xcell_t*********************************/
+
+// payloads up to this size are stored inside the cell
+#define XCELL_INLINE_SIZE (8)
+
+// compact value of 16 bytes, cells of the members
+// of a structure follow the cell of the structure
+typedef struct xcell_t {
+    unsigned char type; // VALUE_TYPE_*
+    unsigned char borrow; // the out of line payload is a view
+    unsigned short count; // members of a structure
+    unsigned int length; // payload bytes, cells below a structure
+    union cell_data {
+        unsigned char _bool;
+        int _int;
+        unsigned int _uint;
+        float _float;
+        binary_time_t _btime;
+        utc_time_t _utc;
+        char _inline[XCELL_INLINE_SIZE];
+        const char *_extern;
+    } value;
+} xcell_t;
+
+// growing array of cells
+typedef struct xcells_t {
+    xcell_t *cells;
+    unsigned int count;
+    unsigned int capacity;
+} xcells_t;
+
+xcells_t *xcells_create();
+
+void xcells_destroy(xcells_t *_cells);
+
+// append a scalar value, a payload longer than XCELL_INLINE_SIZE
+// is copied out of line, or kept as a view when _borrow is set
+int xcells_append(
+        xcells_t *_cells, const xvalue_t *_value,
+        int _borrow);
+
+// append a structure and return the index of its cell
+int xcells_open(xcells_t *_cells);
+
+// close the structure at _index after its members
+int xcells_close(xcells_t *_cells, int _index);
+
+// return the cell following _cell and its members
+const xcell_t *xcell_skip(const xcell_t *_cell);
+
+// render the cell like xvalue_to_string
+int xcell_to_string(
+        const xcell_t *_cell,
+        char *_dest, size_t _size);
+
 #ifdef __cplusplus
 }
 #endif  // !__cplusplus